@@ -1,50 +1,103 @@
 #!/usr/bin/env perl
+# Throughput of the generated corpora of hoedown/test/benchmark.c, at the C
+# level and through the XS, as JSON: one row with the default extensions
+# and one with HOEDOWN_EXT_BOUNDED added. Run after ./Build:
+#
+#   perl -Mblib author/benchmark.pl [--level=c|xs|both] [--corpus=NAME] [--time=SECONDS]
 use strict;
 use warnings;
+use utf8;
+use 5.010000;
+
+use File::Basename qw(dirname);
+use File::Spec;
+use File::Temp qw(tempdir);
+use Getopt::Long;
+use JSON::PP;
+use Time::HiRes qw(clock);
 
-use Text::Markdown;
-use Text::Markdown::Discount;
 use Text::Markdown::Hoedown;
 
-use Benchmark qw(cmpthese);
+# the extensions of hoedown/test/benchmark.c, which --bounded extends
+use constant EXTENSIONS => HOEDOWN_EXT_NO_INTRA_EMPHASIS | HOEDOWN_EXT_TABLES | HOEDOWN_EXT_FENCED_CODE
+    | HOEDOWN_EXT_AUTOLINK | HOEDOWN_EXT_STRIKETHROUGH | HOEDOWN_EXT_SUPERSCRIPT
+    | HOEDOWN_EXT_FOOTNOTES;
+
+GetOptions(
+    'level=s'  => \(my $level = 'both'),
+    'corpus=s' => \(my $only),
+    'time=f'   => \(my $min_time = 0.5),
+) or die "Usage: $0 [--level=c|xs|both] [--corpus=NAME] [--time=SECONDS]\n";
 
-my $markdown_text = <<'...';
-[test]: http://google.com/ "Google"
+my $hoedown = File::Spec->catdir(dirname(__FILE__), '..', 'hoedown');
+system('make', '-s', '-C', $hoedown, 'test/benchmark') == 0
+    or die "Cannot build hoedown/test/benchmark\n";
+my $bench = File::Spec->catfile($hoedown, 'test', 'benchmark');
+my @args = (($only ? "--corpus=$only" : ()), "--time=$min_time");
 
-# A heading
+my $dir = tempdir(CLEANUP => 1);
+system($bench, "--write=$dir", ($only ? "--corpus=$only" : ())) == 0
+    or die "Cannot write the corpora\n";
 
-Just a note, I've found that I can't test my markdown parser vs others.
-For example, both markdown.js and showdown code blocks in lists wrong. They're
-also completely [inconsistent][test] with regards to paragraphs in list items.
+my @results;
+for my $bounded (0, 1) {
+    if ($level ne 'xs') {
+        my @run = (@args, $bounded ? '--bounded' : ());
+        my $json = `$bench @run`;
+        die "$bench failed\n" if $?;
+        push @results, decode_json($json);
+    }
+    push @results, bench_xs($bounded) if $level ne 'c';
+}
 
-A link. Not anymore.
+print JSON::PP->new->canonical->pretty->encode(\@results);
 
-<aside>This will make me fail the test because
-markdown.js doesnt acknowledge arbitrary html blocks =/</aside>
+sub bench_xs {
+    my ($bounded) = @_;
+    my $extensions = EXTENSIONS | ($bounded ? HOEDOWN_EXT_BOUNDED : 0);
 
-* List Item 1
+    my (%docs, @names);
+    for my $file (sort glob "$dir/*.md") {
+        my ($name) = $file =~ m{([^/\\]+)-\d+\.md$};
+        push @names, $name unless $docs{$name};
+        open my $fh, '<:raw', $file or die "$file: $!";
+        push @{$docs{$name}}, do { local $/; <$fh> };
+    }
 
-* List Item 2
-  * New List Item 1
-    Hi, this is a list item.
-  * New List Item 2
-    Another item
-        Code goes here.
-        Lots of it...
-  * New List Item 3
-    The last item
+    my @corpora;
+    for my $name (@names) {
+        my @docs = @{$docs{$name}};
+        my $bytes = 0;
+        $bytes += length for @docs;
 
-* List Item 3
-The final item.
+        # a long lived parser, warmed up as at the C level
+        my $md = Text::Markdown::Hoedown::Markdown->new($extensions, 16,
+            Text::Markdown::Hoedown::Renderer::HTML->new(0, 0));
+        $md->render($_) for @docs;
+        my ($reallocs, $allocated) = (0, 0);
+        for (@docs) {
+            $md->render($_);
+            $reallocs += $md->memory->{reallocs};
+            $allocated += $md->memory->{allocated};
+        }
 
-* List Item 4
-The real final item.
+        my ($rounds, $elapsed, $start) = (0, 0, clock());
+        do {
+            $md->render($_) for @docs;
+            $rounds++;
+            $elapsed = clock() - $start;
+        } while ($elapsed < $min_time);
 
-Paragraph.
-...
+        push @corpora, {
+            name                => $name,
+            docs                => scalar @docs,
+            bytes               => $bytes,
+            mb_per_s            => sprintf('%.2f', $bytes * $rounds / $elapsed / 1e6) + 0,
+            ns_per_doc          => sprintf('%.0f', $elapsed * 1e9 / ($rounds * @docs)) + 0,
+            reallocs_per_doc    => sprintf('%.2f', $reallocs / @docs) + 0,
+            alloc_bytes_per_doc => sprintf('%.0f', $allocated / @docs) + 0,
+        };
+    }
 
-cmpthese(-5, {
-    markdown => sub { Text::Markdown::markdown($markdown_text); },
-    discount => sub { Text::Markdown::Discount::markdown($markdown_text); },
-    hoedown  => sub { Text::Markdown::Hoedown::markdown($markdown_text); },
-});
+    return { level => 'xs', extensions => $extensions, bounded => $bounded, corpora => \@corpora };
+}
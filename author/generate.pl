@@ -10,16 +10,42 @@ use Text::MicroTemplate::File;
 my $CB_C = <<'...';
 ? my @callbacks = @_;
 
+enum tmh_callback_index {
+? for my $cb (@callbacks) {
+    TMH_CB_<?= $cb->{name} ?>,
+? }
+    TMH_CB_COUNT
+};
+
+static const char* tmh_callback_names[] = {
+? for my $cb (@callbacks) {
+    "<?= $cb->{name} ?>",
+? }
+};
+
+/* Perl callbacks of a renderer, an SV* code ref per callback or NULL.
+ * the renderer's opaque starts with a pointer to it: the Callback
+ * renderer's opaque is this struct, pointing to itself, and the HTML
+ * renderers keep it in hoedown_html_renderer_state.opaque */
+struct tmh_callbacks {
+    struct tmh_callbacks* self;
+    const hoedown_renderer* native;  /* callbacks to restore, or NULL */
+    SV* cb[TMH_CB_COUNT];
+};
+
+#define TMH_CALLBACKS(opaque) (*(struct tmh_callbacks**)(opaque))
+
 ? for my $cb (@callbacks) {
 <?= $cb->{type} ?> tmh_cb_<?= $cb->{name} ?>(<?= $cb->{params} ?>) {
     dTHX; dSP; bool is_null = 0;
-    SV** rcb = hv_fetchs((HV*)opaque, "<?= $cb->{name} ?>", 0);
+    SV* cb = TMH_CALLBACKS(opaque)->cb[TMH_CB_<?= $cb->{name} ?>];
     <? if ($cb->{type} eq 'void') { ?>
-    if (!rcb) { return; }
+    if (!cb) { return; }
     <? } else { ?>
-    if (!rcb) { return 0; }
+    if (!cb) { return 0; }
     <? } ?>
-    CB_HEADER("<?= $cb->{name} ?>");
+    TMH_FLUSH_TEXT(opaque);
+    CB_HEADER;
     <? for my $a (@{$cb->{args}}) { ?>
         <?= $a ?>;
     <? } ?>
@@ -39,8 +65,8 @@ void
 <?= $cb->{name} ?>(SV* self, SV *code)
 CODE:
     hoedown_renderer* renderer = XS_STATE(hoedown_renderer*, self);
-    renderer-><?= $cb->{name} ?> = tmh_cb_<?= $cb->{name} ?>;
-    hv_stores(renderer->opaque, "<?= $cb->{name} ?>", newSVsv(code));
+    renderer-><?= $cb->{name} ?> = tmh_set_callback(aTHX_ renderer, TMH_CB_<?= $cb->{name} ?>, code)
+        ? tmh_cb_<?= $cb->{name} ?> : TMH_NATIVE(renderer, <?= $cb->{name} ?>);
 
 ? }
 ...
@@ -100,6 +126,8 @@ sub scan_callbacks {
     for my $line (split /\n/, $1) {
         if ($line =~ /\A\s*(.*?)\s+\(\*(\w+)\)\((.*)\);/) {
             my ($type, $name, $opts) = ($1, $2, $3);
+            # in-place callbacks write around output that Perl never sees
+            next if $opts =~ /enum hoedown_container/;
             my @opts = split /,/, $opts;
             shift @opts;
             pop @opts;
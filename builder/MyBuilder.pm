@@ -6,16 +6,42 @@ use 5.008_001;
 
 use parent qw(Module::Build);
 use File::pushd;
+use File::Spec;
 
 sub new {
     my $class = shift;
+    my (@flags, @link_flags);
+    push @flags, '-D__USE_MINGW_ANSI_STDIO=1' if $^O eq 'MSWin32';
+    # HOEDOWN_STATS=1 perl Build.PL enables Text::Markdown::Hoedown::Markdown#stats
+    push @flags, '-DHOEDOWN_STATS' if $ENV{HOEDOWN_STATS};
+    # HOEDOWN_LTO=1 and HOEDOWN_PGO=generate|use, as LTO and PGO of hoedown/Makefile
+    my @optimize = optimize_flags(%ENV);
+    push @flags, @optimize;
+    push @link_flags, @optimize;
     $class->SUPER::new(
         @_,
         c_source => [qw(hoedown/src/)],
-        ($^O eq 'MSWin32' ? (extra_compiler_flags => ['-D__USE_MINGW_ANSI_STDIO=1']) : ()),
+        (@flags ? (extra_compiler_flags => \@flags) : ()),
+        (@link_flags ? (extra_linker_flags => \@link_flags) : ()),
     );
 }
 
+# the flags shared by the compiler and the linker
+sub optimize_flags {
+    my %env = @_;
+    my $dir = File::Spec->rel2abs($env{HOEDOWN_PGO_DIR} || 'pgo-data');
+    my @flags;
+    push @flags, '-O3', '-flto' if $env{HOEDOWN_LTO};
+    if (($env{HOEDOWN_PGO} || '') eq 'generate') {
+        push @flags, "-fprofile-generate=$dir";
+    } elsif (($env{HOEDOWN_PGO} || '') eq 'use') {
+        push @flags, "-fprofile-use=$dir", '-fprofile-correction', '-Wno-missing-profile';
+    } elsif ($env{HOEDOWN_PGO}) {
+        die "HOEDOWN_PGO must be generate or use\n";
+    }
+    return @flags;
+}
+
 sub ACTION_code {
     my $self = shift;
 
@@ -0,0 +1,956 @@
+#include "ast.h"
+
+#include <string.h>
+#include <stdlib.h>
+
+#include "stack.h"
+
+/*
+ * While parsing, a callback stores its node and writes a token with the
+ * node index to ob, so the content a parent receives lists its children.
+ * Text from normal_text goes to ob as is, with NUL doubled, so that the
+ * parser can still trim it (autolink rewinds, the '!' of images, spaces
+ * before a linebreak); the parent turns each run of it into a text node.
+ */
+
+#define AST_TOKEN 0x00		/* followed by AST_ID_BYTES bytes >= 0x80 */
+#define AST_ID_BYTES 5
+
+hoedown_ast *
+hoedown_ast_new(void)
+{
+	hoedown_ast *ast = malloc(sizeof(hoedown_ast));
+	if (!ast)
+		return NULL;
+
+	ast->nodes = hoedown_buffer_new(64 * sizeof(hoedown_ast_node));
+	ast->kids = hoedown_buffer_new(64 * sizeof(uint32_t));
+	ast->text = hoedown_buffer_new(1024);
+	ast->work = hoedown_buffer_new(1024);
+	return ast;
+}
+
+void
+hoedown_ast_free(hoedown_ast *ast)
+{
+	if (!ast)
+		return;
+
+	hoedown_buffer_free(ast->nodes);
+	hoedown_buffer_free(ast->kids);
+	hoedown_buffer_free(ast->text);
+	hoedown_buffer_free(ast->work);
+	free(ast);
+}
+
+/********************
+ * RECORDING        *
+ ********************/
+
+static void
+node_begin(hoedown_ast *ast, hoedown_ast_node *node, int type, int flags)
+{
+	node->type = type;
+	node->flags = flags;
+	node->kids = (uint32_t)(ast->kids->size / sizeof(uint32_t));
+	node->nkids = 0;
+	node->str[0][0] = node->str[1][0] = node->str[2][0] = HOEDOWN_AST_NONE;
+	node->str[0][1] = node->str[1][1] = node->str[2][1] = 0;
+}
+
+static uint32_t
+node_push(hoedown_ast *ast, const hoedown_ast_node *node)
+{
+	uint32_t id = (uint32_t)(ast->nodes->size / sizeof(hoedown_ast_node));
+	hoedown_buffer_put(ast->nodes, node, sizeof(hoedown_ast_node));
+	return id;
+}
+
+static void
+node_str(hoedown_ast *ast, hoedown_ast_node *node, int n, const hoedown_buffer *buf)
+{
+	if (buf) {
+		node->str[n][0] = (uint32_t)ast->text->size;
+		node->str[n][1] = (uint32_t)buf->size;
+		hoedown_buffer_put(ast->text, buf->data, buf->size);
+	}
+}
+
+static void
+node_kid(hoedown_ast *ast, hoedown_ast_node *node, uint32_t id)
+{
+	hoedown_buffer_put(ast->kids, &id, sizeof(uint32_t));
+	node->nkids++;
+}
+
+/* node_kids • reads the tokens and text runs of content into children */
+static void
+node_kids(hoedown_ast *ast, hoedown_ast_node *node, const hoedown_buffer *content)
+{
+	size_t i = 0, end, org;
+	const uint8_t *nul;
+	uint32_t id;
+	int k;
+
+	if (!content)
+		return;
+
+	while (i < content->size) {
+		org = ast->text->size;
+		while (i < content->size) {
+			nul = memchr(content->data + i, AST_TOKEN, content->size - i);
+			end = nul ? (size_t)(nul - content->data) : content->size;
+			hoedown_buffer_put(ast->text, content->data + i, end - i);
+			i = end;
+			if (i + 1 >= content->size || content->data[i + 1] != AST_TOKEN)
+				break;
+			hoedown_buffer_putc(ast->text, 0);
+			i += 2;
+		}
+
+		if (ast->text->size > org) {
+			hoedown_ast_node text;
+			node_begin(ast, &text, HOEDOWN_AST_NORMAL_TEXT, 0);
+			text.str[0][0] = (uint32_t)org;
+			text.str[0][1] = (uint32_t)(ast->text->size - org);
+			node_kid(ast, node, node_push(ast, &text));
+		}
+
+		if (i + AST_ID_BYTES < content->size) {
+			id = 0;
+			for (k = 1; k <= AST_ID_BYTES; k++)
+				id = (id << 7) | (content->data[i + k] & 0x7f);
+			node_kid(ast, node, id);
+		}
+		i += AST_ID_BYTES + 1;
+	}
+}
+
+/* node_end • stores the node and writes its token to ob */
+static void
+node_end(hoedown_buffer *ob, hoedown_ast *ast, hoedown_ast_node *node)
+{
+	uint8_t token[AST_ID_BYTES + 1];
+	uint32_t id = node_push(ast, node);
+	int k;
+
+	token[0] = AST_TOKEN;
+	for (k = AST_ID_BYTES; k >= 1; k--) {
+		token[k] = 0x80 | (id & 0x7f);
+		id >>= 7;
+	}
+	hoedown_buffer_put(ob, token, sizeof(token));
+}
+
+static void
+node_add(hoedown_buffer *ob, void *opaque, int type, int flags, const hoedown_buffer *content,
+	const hoedown_buffer *s0, const hoedown_buffer *s1, const hoedown_buffer *s2)
+{
+	hoedown_ast *ast = opaque;
+	hoedown_ast_node node;
+
+	node_begin(ast, &node, type, flags);
+	node_kids(ast, &node, content);
+	node_str(ast, &node, 0, s0);
+	node_str(ast, &node, 1, s1);
+	node_str(ast, &node, 2, s2);
+	node_end(ob, ast, &node);
+}
+
+/* callbacks whose text is either content (children) or a raw string */
+#define AST_BLOCK(name, type, is_content) \
+	static void ast_##name(hoedown_buffer *ob, const hoedown_buffer *text, void *opaque) { \
+		node_add(ob, opaque, type, 0, is_content ? text : NULL, is_content ? NULL : text, NULL, NULL); \
+	}
+
+/* spans that would be empty are declined, as the HTML renderer does, and
+ * the parser keeps their source as text: the content of a span is empty
+ * when parse_inline stops at max_nesting */
+#define AST_SPAN(name, type, is_content, keeps_empty) \
+	static int ast_##name(hoedown_buffer *ob, const hoedown_buffer *text, void *opaque) { \
+		if (!keeps_empty && (!text || !text->size)) \
+			return 0; \
+		node_add(ob, opaque, type, 0, is_content ? text : NULL, is_content ? NULL : text, NULL, NULL); \
+		return 1; \
+	}
+
+#define AST_FLAGS(name, type, flags_type) \
+	static void ast_##name(hoedown_buffer *ob, const hoedown_buffer *text, flags_type flags, void *opaque) { \
+		node_add(ob, opaque, type, (int)flags, text, NULL, NULL, NULL); \
+	}
+
+AST_BLOCK(blockquote, HOEDOWN_AST_BLOCKQUOTE, 1)
+AST_BLOCK(blockhtml, HOEDOWN_AST_BLOCKHTML, 0)
+AST_BLOCK(paragraph, HOEDOWN_AST_PARAGRAPH, 1)
+AST_BLOCK(table_row, HOEDOWN_AST_TABLE_ROW, 1)
+AST_BLOCK(footnotes, HOEDOWN_AST_FOOTNOTES, 1)
+AST_FLAGS(header, HOEDOWN_AST_HEADER, int)
+AST_FLAGS(list, HOEDOWN_AST_LIST, int)
+AST_FLAGS(listitem, HOEDOWN_AST_LISTITEM, int)
+AST_FLAGS(table_cell, HOEDOWN_AST_TABLE_CELL, int)
+AST_FLAGS(footnote_def, HOEDOWN_AST_FOOTNOTE_DEF, unsigned int)
+
+AST_SPAN(codespan, HOEDOWN_AST_CODESPAN, 0, 1)
+AST_SPAN(quote, HOEDOWN_AST_QUOTE, 0, 0)
+AST_SPAN(raw_html_tag, HOEDOWN_AST_RAW_HTML_TAG, 0, 1)
+AST_SPAN(double_emphasis, HOEDOWN_AST_DOUBLE_EMPHASIS, 1, 0)
+AST_SPAN(emphasis, HOEDOWN_AST_EMPHASIS, 1, 0)
+AST_SPAN(underline, HOEDOWN_AST_UNDERLINE, 1, 0)
+AST_SPAN(highlight, HOEDOWN_AST_HIGHLIGHT, 1, 0)
+AST_SPAN(triple_emphasis, HOEDOWN_AST_TRIPLE_EMPHASIS, 1, 0)
+AST_SPAN(strikethrough, HOEDOWN_AST_STRIKETHROUGH, 1, 0)
+AST_SPAN(superscript, HOEDOWN_AST_SUPERSCRIPT, 1, 0)
+
+static void
+ast_blockcode(hoedown_buffer *ob, const hoedown_buffer *text, const hoedown_buffer *lang, void *opaque)
+{
+	node_add(ob, opaque, HOEDOWN_AST_BLOCKCODE, 0, NULL, text, lang, NULL);
+}
+
+static void
+ast_hrule(hoedown_buffer *ob, void *opaque)
+{
+	node_add(ob, opaque, HOEDOWN_AST_HRULE, 0, NULL, NULL, NULL, NULL);
+}
+
+/* ast_table • the children are the header rows then the body rows */
+static void
+ast_table(hoedown_buffer *ob, const hoedown_buffer *header, const hoedown_buffer *body, void *opaque)
+{
+	hoedown_ast *ast = opaque;
+	hoedown_ast_node node;
+
+	node_begin(ast, &node, HOEDOWN_AST_TABLE, 0);
+	node_kids(ast, &node, header);
+	node.flags = (int32_t)node.nkids;
+	node_kids(ast, &node, body);
+	node_end(ob, ast, &node);
+}
+
+static int
+ast_autolink(hoedown_buffer *ob, const hoedown_buffer *link, enum hoedown_autolink type, void *opaque)
+{
+	node_add(ob, opaque, HOEDOWN_AST_AUTOLINK, (int)type, NULL, link, NULL, NULL);
+	return 1;
+}
+
+static int
+ast_image(hoedown_buffer *ob, const hoedown_buffer *link, const hoedown_buffer *title, const hoedown_buffer *alt, void *opaque)
+{
+	if (!link || !link->size)
+		return 0;
+
+	node_add(ob, opaque, HOEDOWN_AST_IMAGE, 0, NULL, link, title, alt);
+	return 1;
+}
+
+static int
+ast_linebreak(hoedown_buffer *ob, void *opaque)
+{
+	node_add(ob, opaque, HOEDOWN_AST_LINEBREAK, 0, NULL, NULL, NULL, NULL);
+	return 1;
+}
+
+static int
+ast_link(hoedown_buffer *ob, const hoedown_buffer *link, const hoedown_buffer *title, const hoedown_buffer *content, void *opaque)
+{
+	node_add(ob, opaque, HOEDOWN_AST_LINK, 0, content, link, title, NULL);
+	return 1;
+}
+
+static int
+ast_footnote_ref(hoedown_buffer *ob, unsigned int num, void *opaque)
+{
+	node_add(ob, opaque, HOEDOWN_AST_FOOTNOTE_REF, (int)num, NULL, NULL, NULL, NULL);
+	return 1;
+}
+
+static void
+ast_entity(hoedown_buffer *ob, const hoedown_buffer *entity, void *opaque)
+{
+	node_add(ob, opaque, HOEDOWN_AST_ENTITY, 0, NULL, entity, NULL, NULL);
+}
+
+static void
+ast_normal_text(hoedown_buffer *ob, const hoedown_buffer *text, void *opaque)
+{
+	size_t i = 0, end;
+	const uint8_t *nul;
+
+	while (i < text->size) {
+		nul = memchr(text->data + i, AST_TOKEN, text->size - i);
+		end = nul ? (size_t)(nul - text->data) + 1 : text->size;
+		hoedown_buffer_put(ob, text->data + i, end - i);
+		if (nul)
+			hoedown_buffer_putc(ob, AST_TOKEN);
+		i = end;
+	}
+}
+
+hoedown_renderer *
+hoedown_ast_renderer_new(hoedown_ast *ast)
+{
+	static const hoedown_renderer cb_default = {
+		ast_blockcode,
+		ast_blockquote,
+		ast_blockhtml,
+		ast_header,
+		ast_hrule,
+		ast_list,
+		ast_listitem,
+		ast_paragraph,
+		ast_table,
+		ast_table_row,
+		ast_table_cell,
+		ast_footnotes,
+		ast_footnote_def,
+
+		ast_autolink,
+		ast_codespan,
+		ast_double_emphasis,
+		ast_emphasis,
+		ast_underline,
+		ast_highlight,
+		ast_quote,
+		ast_image,
+		ast_linebreak,
+		ast_link,
+		ast_raw_html_tag,
+		ast_triple_emphasis,
+		ast_strikethrough,
+		ast_superscript,
+		ast_footnote_ref,
+
+		ast_entity,
+		ast_normal_text,
+
+		NULL,
+		NULL,
+
+		NULL,
+
+		NULL,
+		NULL
+	};
+
+	hoedown_renderer *renderer;
+
+	renderer = malloc(sizeof(hoedown_renderer));
+	if (!renderer)
+		return NULL;
+
+	memcpy(renderer, &cb_default, sizeof(hoedown_renderer));
+	renderer->opaque = ast;
+	return renderer;
+}
+
+void
+hoedown_ast_renderer_free(hoedown_renderer *renderer)
+{
+	free(renderer);
+}
+
+void
+hoedown_ast_reset(hoedown_ast *ast)
+{
+	ast->nodes->size = 0;
+	ast->kids->size = 0;
+	ast->text->size = 0;
+}
+
+void
+hoedown_ast_leaf(hoedown_ast *ast, hoedown_buffer *ob, unsigned int type, int flags)
+{
+	node_add(ob, ast, type, flags, NULL, NULL, NULL, NULL);
+}
+
+void
+hoedown_ast_finish_as(hoedown_ast *ast, hoedown_buffer *ob, unsigned int type)
+{
+	hoedown_ast_node root;
+
+	node_begin(ast, &root, type, 0);
+	node_kids(ast, &root, ob);
+	node_push(ast, &root);
+	ob->size = 0;
+}
+
+void
+hoedown_ast_finish(hoedown_ast *ast, hoedown_buffer *ob)
+{
+	hoedown_ast_finish_as(ast, ob, HOEDOWN_AST_DOCUMENT);
+}
+
+int
+hoedown_ast_parse(hoedown_ast *ast, const uint8_t *document, size_t doc_size, hoedown_markdown *md)
+{
+	int status;
+
+	hoedown_ast_reset(ast);
+	ast->work->size = 0;
+
+	status = hoedown_markdown_render(ast->work, document, doc_size, md);
+	hoedown_ast_finish(ast, ast->work);
+	return status;
+}
+
+const hoedown_ast_node *
+hoedown_ast_root(const hoedown_ast *ast)
+{
+	if (ast->nodes->size < sizeof(hoedown_ast_node))
+		return NULL;
+
+	return (const hoedown_ast_node *)(ast->nodes->data + ast->nodes->size) - 1;
+}
+
+/********************
+ * RENDERING        *
+ ********************/
+
+struct ast_render {
+	const hoedown_ast_node *nodes;
+	const uint32_t *kids;
+	const uint8_t *text;
+	const hoedown_renderer *rndr;
+	hoedown_stack *bufs;	/* work buffers, one per depth */
+	size_t depth;
+};
+
+static void render_node(hoedown_buffer *ob, struct ast_render *r, const hoedown_ast_node *node);
+
+static hoedown_buffer *
+newbuf(struct ast_render *r)
+{
+	hoedown_buffer *work;
+
+	if (r->depth < r->bufs->size) {
+		work = r->bufs->item[r->depth];
+		work->size = 0;
+	} else {
+		work = hoedown_buffer_new(64);
+		hoedown_stack_push(r->bufs, work);
+	}
+
+	r->depth++;
+	return work;
+}
+
+static void
+popbuf(struct ast_render *r)
+{
+	r->depth--;
+}
+
+/* node_string • a view of the n-th string of node, NULL when it has none */
+static const hoedown_buffer *
+node_string(struct ast_render *r, const hoedown_ast_node *node, int n, hoedown_buffer *view)
+{
+	if (node->str[n][0] == HOEDOWN_AST_NONE)
+		return NULL;
+
+	view->data = (uint8_t *)r->text + node->str[n][0];
+	view->size = node->str[n][1];
+	view->asize = 0;
+	view->unit = 1; /* hoedown_buffer_prefix asserts a unit */
+	return view;
+}
+
+static void
+render_kids(hoedown_buffer *ob, struct ast_render *r, const hoedown_ast_node *node, uint32_t from, uint32_t to)
+{
+	const uint32_t *kids = r->kids + node->kids;
+	uint32_t i;
+
+	for (i = from; i < to; ++i)
+		render_node(ob, r, r->nodes + kids[i]);
+}
+
+/* kids_buf • renders children into a new work buffer, popped by the caller */
+static hoedown_buffer *
+kids_buf(struct ast_render *r, const hoedown_ast_node *node, uint32_t from, uint32_t to)
+{
+	hoedown_buffer *work = newbuf(r);
+	render_kids(work, r, node, from, to);
+	return work;
+}
+
+/* enter_container • opens a container in place unless it has a callback */
+static int
+enter_container(hoedown_buffer *ob, struct ast_render *r, int has_callback, enum hoedown_container type, int flags, size_t *content)
+{
+	*content = 0;
+	if (has_callback || !r->rndr->container_enter || !r->rndr->container_leave)
+		return 0;
+
+	r->rndr->container_enter(ob, type, flags, r->rndr->opaque);
+	*content = ob->size;
+	return 1;
+}
+
+static void
+render_text(hoedown_buffer *ob, struct ast_render *r, const hoedown_buffer *text)
+{
+	if (!text)
+		return;
+
+	if (r->rndr->normal_text)
+		r->rndr->normal_text(ob, text, r->rndr->opaque);
+	else
+		hoedown_buffer_put(ob, text->data, text->size);
+}
+
+/* render_html_text • an html block of a renderer without blockhtml, which
+ * hoedown would have parsed as a paragraph */
+static void
+render_html_text(hoedown_buffer *ob, struct ast_render *r, const hoedown_buffer *html)
+{
+	hoedown_buffer text, *work;
+
+	if (!html || !r->rndr->paragraph)
+		return;
+
+	text = *html;
+	while (text.size && text.data[0] == '\n') {
+		text.data++;
+		text.size--;
+	}
+	while (text.size && text.data[text.size - 1] == '\n')
+		text.size--;
+
+	if (!text.size)
+		return;
+
+	work = newbuf(r);
+	render_text(work, r, &text);
+	r->rndr->paragraph(ob, work, r->rndr->opaque);
+	popbuf(r);
+}
+
+static void
+render_container(hoedown_buffer *ob, struct ast_render *r, const hoedown_ast_node *node, enum hoedown_container type)
+{
+	const hoedown_renderer *rndr = r->rndr;
+	hoedown_buffer *work;
+	size_t content;
+	int has_callback = 0;
+
+	switch (type) {
+	case HOEDOWN_CONTAINER_BLOCKQUOTE: has_callback = rndr->blockquote != NULL; break;
+	case HOEDOWN_CONTAINER_LIST: has_callback = rndr->list != NULL; break;
+	case HOEDOWN_CONTAINER_LISTITEM: has_callback = rndr->listitem != NULL; break;
+	case HOEDOWN_CONTAINER_TABLE_ROW: has_callback = rndr->table_row != NULL; break;
+	case HOEDOWN_CONTAINER_FOOTNOTES: has_callback = rndr->footnotes != NULL; break;
+	case HOEDOWN_CONTAINER_TABLE_CELL: has_callback = rndr->table_cell != NULL; break;
+	default: break;
+	}
+
+	if (enter_container(ob, r, has_callback, type, node->flags, &content)) {
+		render_kids(ob, r, node, 0, node->nkids);
+		rndr->container_leave(ob, type, node->flags, content, rndr->opaque);
+		return;
+	}
+
+	work = kids_buf(r, node, 0, node->nkids);
+
+	switch (type) {
+	case HOEDOWN_CONTAINER_BLOCKQUOTE:
+		if (rndr->blockquote) rndr->blockquote(ob, work, rndr->opaque);
+		break;
+	case HOEDOWN_CONTAINER_LIST:
+		if (rndr->list) rndr->list(ob, work, node->flags, rndr->opaque);
+		break;
+	case HOEDOWN_CONTAINER_LISTITEM:
+		if (rndr->listitem) rndr->listitem(ob, work, node->flags, rndr->opaque);
+		break;
+	case HOEDOWN_CONTAINER_TABLE_ROW:
+		if (rndr->table_row) rndr->table_row(ob, work, rndr->opaque);
+		break;
+	case HOEDOWN_CONTAINER_FOOTNOTES:
+		if (rndr->footnotes) rndr->footnotes(ob, work, rndr->opaque);
+		break;
+	case HOEDOWN_CONTAINER_TABLE_CELL:
+		if (rndr->table_cell) rndr->table_cell(ob, work, node->flags, rndr->opaque);
+		break;
+	default:
+		break;
+	}
+
+	popbuf(r);
+}
+
+static void
+render_table(hoedown_buffer *ob, struct ast_render *r, const hoedown_ast_node *node)
+{
+	const hoedown_renderer *rndr = r->rndr;
+	hoedown_buffer *header, *body;
+	uint32_t rows = (uint32_t)node->flags;
+	size_t content, section;
+
+	if (enter_container(ob, r, rndr->table != NULL, HOEDOWN_CONTAINER_TABLE, 0, &content)) {
+		enter_container(ob, r, 0, HOEDOWN_CONTAINER_TABLE_HEADER, 0, &section);
+		render_kids(ob, r, node, 0, rows);
+		rndr->container_leave(ob, HOEDOWN_CONTAINER_TABLE_HEADER, 0, section, rndr->opaque);
+		enter_container(ob, r, 0, HOEDOWN_CONTAINER_TABLE_BODY, 0, &section);
+		render_kids(ob, r, node, rows, node->nkids);
+		rndr->container_leave(ob, HOEDOWN_CONTAINER_TABLE_BODY, 0, section, rndr->opaque);
+		rndr->container_leave(ob, HOEDOWN_CONTAINER_TABLE, 0, content, rndr->opaque);
+		return;
+	}
+
+	header = kids_buf(r, node, 0, rows);
+	body = kids_buf(r, node, rows, node->nkids);
+	if (rndr->table)
+		rndr->table(ob, header, body, rndr->opaque);
+	popbuf(r);
+	popbuf(r);
+}
+
+/* render_span • a span with content, rendered as its content when declined */
+static void
+render_span(hoedown_buffer *ob, struct ast_render *r, const hoedown_ast_node *node,
+	int (*callback)(hoedown_buffer *, const hoedown_buffer *, void *))
+{
+	hoedown_buffer *work = kids_buf(r, node, 0, node->nkids);
+
+	if (!callback || !callback(ob, work, r->rndr->opaque))
+		hoedown_buffer_put(ob, work->data, work->size);
+	popbuf(r);
+}
+
+static void
+render_node(hoedown_buffer *ob, struct ast_render *r, const hoedown_ast_node *node)
+{
+	const hoedown_renderer *rndr = r->rndr;
+	void *opaque = rndr->opaque;
+	hoedown_buffer view[3], *work;
+	const hoedown_buffer *s0 = node_string(r, node, 0, &view[0]);
+	const hoedown_buffer *s1 = node_string(r, node, 1, &view[1]);
+	const hoedown_buffer *s2 = node_string(r, node, 2, &view[2]);
+
+	switch (node->type) {
+	case HOEDOWN_AST_BLOCKCODE:
+		if (rndr->blockcode)
+			rndr->blockcode(ob, s0, s1, opaque);
+		break;
+
+	case HOEDOWN_AST_BLOCKHTML:
+		if (rndr->blockhtml)
+			rndr->blockhtml(ob, s0, opaque);
+		else
+			render_html_text(ob, r, s0);
+		break;
+
+	case HOEDOWN_AST_HRULE:
+		if (rndr->hrule)
+			rndr->hrule(ob, opaque);
+		break;
+
+	case HOEDOWN_AST_HEADER:
+		work = kids_buf(r, node, 0, node->nkids);
+		if (rndr->header)
+			rndr->header(ob, work, node->flags, opaque);
+		popbuf(r);
+		break;
+
+	case HOEDOWN_AST_PARAGRAPH:
+		work = kids_buf(r, node, 0, node->nkids);
+		if (rndr->paragraph)
+			rndr->paragraph(ob, work, opaque);
+		popbuf(r);
+		break;
+
+	case HOEDOWN_AST_TABLE_CELL:
+		render_container(ob, r, node, HOEDOWN_CONTAINER_TABLE_CELL);
+		break;
+
+	case HOEDOWN_AST_FOOTNOTE_DEF:
+		work = kids_buf(r, node, 0, node->nkids);
+		if (rndr->footnote_def)
+			rndr->footnote_def(ob, work, (unsigned int)node->flags, opaque);
+		popbuf(r);
+		break;
+
+	case HOEDOWN_AST_BLOCKQUOTE:
+		render_container(ob, r, node, HOEDOWN_CONTAINER_BLOCKQUOTE);
+		break;
+
+	case HOEDOWN_AST_LIST:
+		render_container(ob, r, node, HOEDOWN_CONTAINER_LIST);
+		break;
+
+	case HOEDOWN_AST_LISTITEM:
+		render_container(ob, r, node, HOEDOWN_CONTAINER_LISTITEM);
+		break;
+
+	case HOEDOWN_AST_TABLE_ROW:
+		render_container(ob, r, node, HOEDOWN_CONTAINER_TABLE_ROW);
+		break;
+
+	case HOEDOWN_AST_FOOTNOTES:
+		render_container(ob, r, node, HOEDOWN_CONTAINER_FOOTNOTES);
+		break;
+
+	case HOEDOWN_AST_TABLE:
+		render_table(ob, r, node);
+		break;
+
+	case HOEDOWN_AST_DOUBLE_EMPHASIS: render_span(ob, r, node, rndr->double_emphasis); break;
+	case HOEDOWN_AST_EMPHASIS: render_span(ob, r, node, rndr->emphasis); break;
+	case HOEDOWN_AST_UNDERLINE: render_span(ob, r, node, rndr->underline); break;
+	case HOEDOWN_AST_HIGHLIGHT: render_span(ob, r, node, rndr->highlight); break;
+	case HOEDOWN_AST_TRIPLE_EMPHASIS: render_span(ob, r, node, rndr->triple_emphasis); break;
+	case HOEDOWN_AST_STRIKETHROUGH: render_span(ob, r, node, rndr->strikethrough); break;
+	case HOEDOWN_AST_SUPERSCRIPT: render_span(ob, r, node, rndr->superscript); break;
+
+	case HOEDOWN_AST_LINK:
+		work = kids_buf(r, node, 0, node->nkids);
+		if (!rndr->link || !rndr->link(ob, s0, s1, work, opaque))
+			hoedown_buffer_put(ob, work->data, work->size);
+		popbuf(r);
+		break;
+
+	case HOEDOWN_AST_CODESPAN:
+		if (!rndr->codespan || !rndr->codespan(ob, s0, opaque))
+			render_text(ob, r, s0);
+		break;
+
+	case HOEDOWN_AST_QUOTE:
+		if (!rndr->quote || !rndr->quote(ob, s0, opaque))
+			render_text(ob, r, s0);
+		break;
+
+	case HOEDOWN_AST_RAW_HTML_TAG:
+		if (!rndr->raw_html_tag || !rndr->raw_html_tag(ob, s0, opaque))
+			render_text(ob, r, s0);
+		break;
+
+	case HOEDOWN_AST_AUTOLINK:
+		if (!rndr->autolink || !rndr->autolink(ob, s0, (enum hoedown_autolink)node->flags, opaque))
+			render_text(ob, r, s0);
+		break;
+
+	case HOEDOWN_AST_IMAGE:
+		if (!rndr->image || !rndr->image(ob, s0, s1, s2, opaque))
+			render_text(ob, r, s2);
+		break;
+
+	case HOEDOWN_AST_LINEBREAK:
+		if (rndr->linebreak)
+			rndr->linebreak(ob, opaque);
+		break;
+
+	case HOEDOWN_AST_FOOTNOTE_REF:
+		if (rndr->footnote_ref)
+			rndr->footnote_ref(ob, (unsigned int)node->flags, opaque);
+		break;
+
+	case HOEDOWN_AST_ENTITY:
+		if (rndr->entity)
+			rndr->entity(ob, s0, opaque);
+		else if (s0)
+			hoedown_buffer_put(ob, s0->data, s0->size);
+		break;
+
+	case HOEDOWN_AST_NORMAL_TEXT:
+		render_text(ob, r, s0);
+		break;
+
+	case HOEDOWN_AST_DOCUMENT:
+		render_kids(ob, r, node, 0, node->nkids);
+		break;
+	}
+}
+
+/* render_tree • renders the arrays set in r, the root being the last node,
+ * with the work buffers of work or, when it is NULL, its own */
+static void
+render_tree(hoedown_buffer *ob, struct ast_render *r, uint32_t nodes, hoedown_stack *work)
+{
+	const hoedown_renderer *renderer = r->rndr;
+	hoedown_stack own;
+
+	r->depth = 0;
+	if (work) {
+		r->bufs = work;
+	} else {
+		hoedown_stack_new(&own, 8);
+		r->bufs = &own;
+	}
+
+	if (renderer->doc_header)
+		renderer->doc_header(ob, renderer->opaque);
+
+	if (nodes)
+		render_node(ob, r, r->nodes + nodes - 1);
+
+	if (renderer->doc_footer)
+		renderer->doc_footer(ob, renderer->opaque);
+
+	if (!work)
+		hoedown_ast_work_free(&own);
+}
+
+void
+hoedown_ast_render(hoedown_buffer *ob, const hoedown_ast *ast, const hoedown_renderer *renderer, hoedown_stack *work)
+{
+	struct ast_render r;
+
+	r.nodes = (const hoedown_ast_node *)ast->nodes->data;
+	r.kids = (const uint32_t *)ast->kids->data;
+	r.text = ast->text->data;
+	r.rndr = renderer;
+	render_tree(ob, &r, (uint32_t)(ast->nodes->size / sizeof(hoedown_ast_node)), work);
+}
+
+void
+hoedown_ast_work_free(hoedown_stack *work)
+{
+	size_t i;
+
+	for (i = 0; i < work->size; ++i)
+		hoedown_buffer_free(work->item[i]);
+	hoedown_stack_free(work);
+}
+
+/********************
+ * IMAGES           *
+ ********************/
+
+static const uint8_t image_magic[4] = { 'H', 'D', 'A', 'T' };
+
+#define IMAGE_ORDER 0x01020304
+#define IMAGE_UNREACHED 0xffff	/* depth of the children of a node the root does not reach */
+
+void
+hoedown_ast_serialize(hoedown_buffer *ob, const hoedown_ast *ast, uint32_t flags)
+{
+	struct hoedown_ast_image header;
+
+	memcpy(header.magic, image_magic, sizeof(header.magic));
+	header.version = HOEDOWN_AST_IMAGE_VERSION;
+	header.order = IMAGE_ORDER;
+	header.flags = flags;
+	header.nodes = (uint32_t)(ast->nodes->size / sizeof(hoedown_ast_node));
+	header.kids = (uint32_t)(ast->kids->size / sizeof(uint32_t));
+	header.text = (uint32_t)ast->text->size;
+
+	hoedown_buffer_grow(ob, ob->size + sizeof(header) + ast->nodes->size + ast->kids->size + ast->text->size);
+	hoedown_buffer_put(ob, &header, sizeof(header));
+	hoedown_buffer_put(ob, ast->nodes->data, ast->nodes->size);
+	hoedown_buffer_put(ob, ast->kids->data, ast->kids->size);
+	hoedown_buffer_put(ob, ast->text->data, ast->text->size);
+}
+
+/* node_valid • fields of node the renderers trust, as the parser sets them */
+static int
+node_valid(const hoedown_ast_node *node)
+{
+	switch (node->type) {
+	case HOEDOWN_AST_BLOCKCODE:
+	case HOEDOWN_AST_BLOCKHTML:
+	case HOEDOWN_AST_RAW_HTML_TAG:
+	case HOEDOWN_AST_AUTOLINK:
+	case HOEDOWN_AST_ENTITY:
+		return node->str[0][0] != HOEDOWN_AST_NONE;
+
+	case HOEDOWN_AST_HEADER:
+		return node->flags >= 1 && node->flags <= 6;
+
+	case HOEDOWN_AST_TABLE:
+		return node->flags >= 0 && (uint32_t)node->flags <= node->nkids;
+
+	default:
+		return node->type <= HOEDOWN_AST_DOCUMENT;
+	}
+}
+
+/* image_arrays • points r at the arrays following the header */
+static void
+image_arrays(struct ast_render *r, const struct hoedown_ast_image *header)
+{
+	r->nodes = (const hoedown_ast_node *)(header + 1);
+	r->kids = (const uint32_t *)(r->nodes + header->nodes);
+	r->text = (const uint8_t *)(r->kids + header->kids);
+}
+
+size_t
+hoedown_ast_image_check(const uint8_t *data, size_t size)
+{
+	const struct hoedown_ast_image *header = (const struct hoedown_ast_image *)data;
+	struct ast_render r;
+	uint16_t *depth;
+	uint64_t total;
+	uint32_t i, k, kid;
+	int n;
+
+	if ((uintptr_t)data % sizeof(uint32_t) != 0 || size < sizeof(*header) ||
+		memcmp(header->magic, image_magic, sizeof(header->magic)) != 0 ||
+		header->version != HOEDOWN_AST_IMAGE_VERSION || header->order != IMAGE_ORDER)
+		return 0;
+
+	total = sizeof(*header) + (uint64_t)header->nodes * sizeof(hoedown_ast_node) +
+		(uint64_t)header->kids * sizeof(uint32_t) + header->text;
+	if (total > size)
+		return 0;
+
+	image_arrays(&r, header);
+
+	for (i = 0; i < header->nodes; ++i) {
+		const hoedown_ast_node *node = r.nodes + i;
+
+		if (!node_valid(node) ||
+			node->kids > header->kids || node->nkids > header->kids - node->kids)
+			return 0;
+
+		for (n = 0; n < 3; ++n)
+			if (node->str[n][0] != HOEDOWN_AST_NONE &&
+				(node->str[n][0] > header->text || node->str[n][1] > header->text - node->str[n][0]))
+				return 0;
+	}
+
+	if (!header->nodes)
+		return (size_t)total;
+
+	/* children come before their parent and have no other parent, so the
+	 * walk from the root is finite and visits each node once; the depth of
+	 * each node, filled from the root down, bounds the render recursion.
+	 * nodes the parse dropped are not reached, their children are marked */
+	depth = calloc(header->nodes, sizeof(uint16_t));
+	if (!depth)
+		return 0;
+
+	depth[header->nodes - 1] = 1;
+	for (i = header->nodes; i-- > 0; ) {
+		const hoedown_ast_node *node = r.nodes + i;
+		uint16_t d = depth[i];
+
+		for (k = 0; k < node->nkids; ++k) {
+			kid = r.kids[node->kids + k];
+			if (kid >= i || depth[kid] || (d != IMAGE_UNREACHED && d >= HOEDOWN_AST_MAX_DEPTH)) {
+				free(depth);
+				return 0;
+			}
+			depth[kid] = d && d != IMAGE_UNREACHED ? d + 1 : IMAGE_UNREACHED;
+		}
+	}
+
+	free(depth);
+	return (size_t)total;
+}
+
+uint32_t
+hoedown_ast_image_flags(const uint8_t *image)
+{
+	return ((const struct hoedown_ast_image *)image)->flags;
+}
+
+void
+hoedown_ast_render_image(hoedown_buffer *ob, const uint8_t *image, const hoedown_renderer *renderer, hoedown_stack *work)
+{
+	const struct hoedown_ast_image *header = (const struct hoedown_ast_image *)image;
+	struct ast_render r;
+
+	image_arrays(&r, header);
+	r.rndr = renderer;
+	render_tree(ob, &r, header->nodes, work);
+}
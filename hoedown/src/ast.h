@@ -0,0 +1,186 @@
+/* ast.h - documents parsed once into a tree, rendered many times */
+
+#ifndef HOEDOWN_AST_H
+#define HOEDOWN_AST_H
+
+#include <stdint.h>
+
+#include "markdown.h"
+#include "buffer.h"
+#include "stack.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* hoedown_ast_type - one per renderer callback, in the same order */
+enum hoedown_ast_type {
+	HOEDOWN_AST_BLOCKCODE,
+	HOEDOWN_AST_BLOCKQUOTE,
+	HOEDOWN_AST_BLOCKHTML,
+	HOEDOWN_AST_HEADER,
+	HOEDOWN_AST_HRULE,
+	HOEDOWN_AST_LIST,
+	HOEDOWN_AST_LISTITEM,
+	HOEDOWN_AST_PARAGRAPH,
+	HOEDOWN_AST_TABLE,
+	HOEDOWN_AST_TABLE_ROW,
+	HOEDOWN_AST_TABLE_CELL,
+	HOEDOWN_AST_FOOTNOTES,
+	HOEDOWN_AST_FOOTNOTE_DEF,
+
+	HOEDOWN_AST_AUTOLINK,
+	HOEDOWN_AST_CODESPAN,
+	HOEDOWN_AST_DOUBLE_EMPHASIS,
+	HOEDOWN_AST_EMPHASIS,
+	HOEDOWN_AST_UNDERLINE,
+	HOEDOWN_AST_HIGHLIGHT,
+	HOEDOWN_AST_QUOTE,
+	HOEDOWN_AST_IMAGE,
+	HOEDOWN_AST_LINEBREAK,
+	HOEDOWN_AST_LINK,
+	HOEDOWN_AST_RAW_HTML_TAG,
+	HOEDOWN_AST_TRIPLE_EMPHASIS,
+	HOEDOWN_AST_STRIKETHROUGH,
+	HOEDOWN_AST_SUPERSCRIPT,
+	HOEDOWN_AST_FOOTNOTE_REF,
+
+	HOEDOWN_AST_ENTITY,
+	HOEDOWN_AST_NORMAL_TEXT,
+
+	HOEDOWN_AST_DOCUMENT		/* the root, holding the top level blocks */
+};
+
+/* HOEDOWN_AST_NONE: offset of a string the callback gets as NULL */
+#define HOEDOWN_AST_NONE ((uint32_t)-1)
+
+/* hoedown_ast_node - one callback of the parse */
+struct hoedown_ast_node {
+	uint32_t type;		/* hoedown_ast_type */
+	int32_t flags;		/* level, list or cell flags, autolink type, footnote
+						 * number; header rows for a table */
+	uint32_t kids;		/* first child in the kids array */
+	uint32_t nkids;
+	uint32_t str[3][2];	/* offset and size of the strings in the text pool,
+						 * in callback order: blockcode text and lang,
+						 * link and title of links and images, image alt */
+};
+
+typedef struct hoedown_ast_node hoedown_ast_node;
+
+/* hoedown_ast - a parsed document, held in three arrays */
+/*	children are stored before their parent, the document node last */
+struct hoedown_ast {
+	hoedown_buffer *nodes;	/* hoedown_ast_node */
+	hoedown_buffer *kids;	/* uint32_t node indexes */
+	hoedown_buffer *text;	/* strings of the nodes */
+	hoedown_buffer *work;	/* output of the parse, tokens for the top level */
+};
+
+typedef struct hoedown_ast hoedown_ast;
+
+/* hoedown_ast_new: allocation of an empty tree */
+extern hoedown_ast *
+hoedown_ast_new(void);
+
+extern void
+hoedown_ast_free(hoedown_ast *ast);
+
+/* hoedown_ast_renderer_new: a renderer recording the parse into ast */
+/*	to be given to hoedown_markdown_new, which sets the extensions */
+extern hoedown_renderer *
+hoedown_ast_renderer_new(hoedown_ast *ast);
+
+extern void
+hoedown_ast_renderer_free(hoedown_renderer *renderer);
+
+/* hoedown_ast_reset: empties ast, before a parse through its renderer */
+extern void
+hoedown_ast_reset(hoedown_ast *ast);
+
+/* hoedown_ast_finish: adds the document node over the parse output in ob */
+/*	ob holds the tokens of the top level blocks and is emptied; for a
+ *	renderer built on the callbacks of hoedown_ast_renderer_new, called
+ *	from its doc_footer */
+extern void
+hoedown_ast_finish(hoedown_ast *ast, hoedown_buffer *ob);
+
+/* hoedown_ast_finish_as: hoedown_ast_finish with a root of the given type */
+extern void
+hoedown_ast_finish_as(hoedown_ast *ast, hoedown_buffer *ob, unsigned int type);
+
+/* hoedown_ast_leaf: records a node without children or strings */
+/*	and writes its token to ob, as the recording callbacks do; a type past
+ *	HOEDOWN_AST_DOCUMENT is left to the caller: hoedown_ast_render skips
+ *	it, and hoedown_ast_image_check refuses images holding it */
+extern void
+hoedown_ast_leaf(hoedown_ast *ast, hoedown_buffer *ob, unsigned int type, int flags);
+
+/* hoedown_ast_parse: replaces the content of ast with a parsed document */
+/*	md must be built on the renderer of ast; returns a hoedown_render_status */
+extern int
+hoedown_ast_parse(hoedown_ast *ast, const uint8_t *document, size_t doc_size, hoedown_markdown *md);
+
+/* hoedown_ast_root: the document node, NULL if nothing was parsed */
+extern const hoedown_ast_node *
+hoedown_ast_root(const hoedown_ast *ast);
+
+/* hoedown_ast_render: walks the tree, calling the renderer as a parse would */
+/*	a NULL block callback skips the block, and containers use the in-place
+ *	callbacks when they are set; a span callback that is NULL or returns 0
+ *	renders the content of the span instead of its markdown source. work,
+ *	when not NULL, keeps the work buffers of the render for the next one,
+ *	also when a callback leaves it with a longjmp */
+extern void
+hoedown_ast_render(hoedown_buffer *ob, const hoedown_ast *ast, const hoedown_renderer *renderer, hoedown_stack *work);
+
+/* hoedown_ast_work_free: frees the work buffers kept by renders, and work */
+extern void
+hoedown_ast_work_free(hoedown_stack *work);
+
+/* HOEDOWN_AST_IMAGE_VERSION: changes with the layout of nodes and their types */
+#define HOEDOWN_AST_IMAGE_VERSION 1
+
+/* HOEDOWN_AST_MAX_DEPTH: depth of the deepest tree an image may hold */
+/*	rendering recurses once per level; a parse with a max_nesting up to
+ *	1000 stays below it */
+#define HOEDOWN_AST_MAX_DEPTH 1024
+
+/* hoedown_ast_image - header of a serialized tree */
+/*	followed by the nodes, the kids and the text of the tree, in the byte
+ *	order of the writer; all links are array offsets, so an image can be
+ *	stored and read or mapped back at any 4 byte aligned address */
+struct hoedown_ast_image {
+	uint8_t magic[4];	/* "HDAT" */
+	uint32_t version;	/* HOEDOWN_AST_IMAGE_VERSION */
+	uint32_t order;		/* 0x01020304, checks the byte order */
+	uint32_t flags;		/* left to the caller */
+	uint32_t nodes;		/* number of nodes */
+	uint32_t kids;		/* number of kids */
+	uint32_t text;		/* bytes of text */
+};
+
+/* hoedown_ast_serialize: appends the image of ast to ob */
+extern void
+hoedown_ast_serialize(hoedown_buffer *ob, const hoedown_ast *ast, uint32_t flags);
+
+/* hoedown_ast_image_check: size of the image at data, 0 if it is not valid */
+/*	checks the header and every link of the tree: each node is the child
+ *	of at most one node stored after it, and the tree is no deeper than
+ *	HOEDOWN_AST_MAX_DEPTH; trusted images can be rendered without it */
+extern size_t
+hoedown_ast_image_check(const uint8_t *data, size_t size);
+
+/* hoedown_ast_image_flags: flags given to hoedown_ast_serialize */
+extern uint32_t
+hoedown_ast_image_flags(const uint8_t *image);
+
+/* hoedown_ast_render_image: hoedown_ast_render on an image, in place */
+extern void
+hoedown_ast_render_image(hoedown_buffer *ob, const uint8_t *image, const hoedown_renderer *renderer, hoedown_stack *work);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /** HOEDOWN_AST_H **/
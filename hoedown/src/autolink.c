@@ -12,18 +12,21 @@
 int
 hoedown_autolink_is_safe(const uint8_t *link, size_t link_len)
 {
-	static const size_t valid_uris_count = 5;
-	static const char *valid_uris[] = {
-		"/", "http://", "https://", "ftp://", "mailto:"
+	static const struct {
+		const char *uri;
+		size_t len;
+	} valid_uris[] = {
+		{ "/", 1 }, { "http://", 7 }, { "https://", 8 }, { "ftp://", 6 }, { "mailto:", 7 }
 	};
+	static const size_t valid_uris_count = sizeof(valid_uris) / sizeof(valid_uris[0]);
 
 	size_t i;
 
 	for (i = 0; i < valid_uris_count; ++i) {
-		size_t len = strlen(valid_uris[i]);
+		size_t len = valid_uris[i].len;
 
 		if (link_len > len &&
-			strncasecmp((char *)link, valid_uris[i], len) == 0 &&
+			strncasecmp((char *)link, valid_uris[i].uri, len) == 0 &&
 			isalnum(link[len]))
 			return 1;
 	}
@@ -124,7 +127,7 @@ check_domain(uint8_t *data, size_t size, int allow_short)
 		return 0;
 
 	for (i = 1; i < size - 1; ++i) {
-		if (strchr(".:", data[i]) != NULL) np++;
+		if (data[i] == '.' || data[i] == ':') np++;
 		else if (!isalnum(data[i]) && data[i] != '-') break;
 	}
 
@@ -155,7 +158,7 @@ hoedown_autolink__www(
 	if (max_rewind > 0 && !ispunct(data[-1]) && !isspace(data[-1]))
 		return 0;
 
-	if (size < 4 || memcmp(data, "www.", strlen("www.")) != 0)
+	if (size < 4 || memcmp(data, "www.", 4) != 0)
 		return 0;
 
 	link_end = check_domain(data, size, 0);
@@ -195,7 +198,7 @@ hoedown_autolink__email(
 		if (isalnum(c))
 			continue;
 
-		if (strchr(".+-_", c) != NULL)
+		if (c == '.' || c == '+' || c == '-' || c == '_')
 			continue;
 
 		break;
@@ -210,8 +213,11 @@ hoedown_autolink__email(
 		if (isalnum(c))
 			continue;
 
-		if (c == '@')
-			nb++;
+		if (c == '@') {
+			/* a second '@' can never make a valid address */
+			if (++nb > 1)
+				return 0;
+		}
 		else if (c == '.' && link_end < size - 1)
 			np++;
 		else if (c != '-' && c != '_')
@@ -253,7 +259,7 @@ hoedown_autolink__url(
 	if (!hoedown_autolink_is_safe(data - rewind, size + rewind))
 		return 0;
 
-	link_end = strlen("://");
+	link_end = 3;	/* :// */
 
 	domain_len = check_domain(
 		data + link_end,
@@ -0,0 +1,199 @@
+#include "block_cache.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/* fixed cost of an entry besides its data: the entry and its bucket slot */
+#define ENTRY_COST (sizeof(hoedown_block_cache_entry) + sizeof(hoedown_block_cache_entry *))
+
+/* line_hash • 64 bit hash of the first two lines of data, eight bytes at a time */
+/*	a key holds two lines at least, unless it runs to the end of the
+ *	document; then it only matches data without more lines either */
+static uint64_t
+line_hash(const uint8_t *data, size_t size)
+{
+	static const uint64_t m = 0x9E3779B97F4A7C15ULL;
+	const uint8_t *nl = memchr(data, '\n', size);
+	uint64_t h, w;
+
+	if (nl)
+		nl = memchr(nl + 1, '\n', size - (nl + 1 - data));
+	if (nl)
+		size = nl - data + 1;
+
+	h = size * m;
+	while (size >= 8) {
+		memcpy(&w, data, 8);
+		h = (h ^ (w * m)) * m;
+		h ^= h >> 29;
+		data += 8;
+		size -= 8;
+	}
+
+	w = 0;
+	memcpy(&w, data, size);
+	h = (h ^ (w * m)) * m;
+	h ^= h >> 32;
+	return h;
+}
+
+static hoedown_block_cache_entry **
+bucket(hoedown_block_cache *cache, uint64_t hash)
+{
+	return &cache->buckets[hash & (cache->nbuckets - 1)];
+}
+
+static void
+unlink_used(hoedown_block_cache_entry *entry)
+{
+	entry->prev_used->next_used = entry->next_used;
+	entry->next_used->prev_used = entry->prev_used;
+}
+
+static void
+link_used(hoedown_block_cache *cache, hoedown_block_cache_entry *entry)
+{
+	entry->prev_used = &cache->lru;
+	entry->next_used = cache->lru.next_used;
+	cache->lru.next_used->prev_used = entry;
+	cache->lru.next_used = entry;
+}
+
+static void
+evict(hoedown_block_cache *cache, hoedown_block_cache_entry *entry)
+{
+	hoedown_block_cache_entry **slot = bucket(cache, entry->line_hash);
+
+	while (*slot != entry)
+		slot = &(*slot)->next;
+	*slot = entry->next;
+
+	unlink_used(entry);
+	cache->bytes -= ENTRY_COST + entry->key_size + entry->out_size;
+	cache->count--;
+	free(entry);
+}
+
+/* grow • doubles the buckets, keeping the entries where they are on failure */
+static void
+grow(hoedown_block_cache *cache)
+{
+	hoedown_block_cache_entry **buckets, **old = cache->buckets, *entry, *next;
+	size_t i, n = cache->nbuckets;
+
+	buckets = calloc(n * 2, sizeof(hoedown_block_cache_entry *));
+	if (!buckets)
+		return;
+
+	cache->buckets = buckets;
+	cache->nbuckets = n * 2;
+	for (i = 0; i < n; ++i) {
+		for (entry = old[i]; entry; entry = next) {
+			next = entry->next;
+			entry->next = *bucket(cache, entry->line_hash);
+			*bucket(cache, entry->line_hash) = entry;
+		}
+	}
+	free(old);
+}
+
+hoedown_block_cache *
+hoedown_block_cache_new(size_t max_bytes)
+{
+	hoedown_block_cache *cache = malloc(sizeof(hoedown_block_cache));
+	if (!cache)
+		return NULL;
+
+	cache->nbuckets = 64;
+	cache->buckets = calloc(cache->nbuckets, sizeof(hoedown_block_cache_entry *));
+	if (!cache->buckets) {
+		free(cache);
+		return NULL;
+	}
+
+	cache->lru.prev_used = cache->lru.next_used = &cache->lru;
+	cache->max_bytes = max_bytes;
+	cache->bytes = 0;
+	cache->count = 0;
+	cache->hits = 0;
+	cache->misses = 0;
+	return cache;
+}
+
+void
+hoedown_block_cache_free(hoedown_block_cache *cache)
+{
+	if (!cache)
+		return;
+
+	hoedown_block_cache_clear(cache);
+	free(cache->buckets);
+	free(cache);
+}
+
+void
+hoedown_block_cache_clear(hoedown_block_cache *cache)
+{
+	while (cache->lru.next_used != &cache->lru)
+		evict(cache, cache->lru.next_used);
+}
+
+const hoedown_block_cache_entry *
+hoedown_block_cache_find(hoedown_block_cache *cache, const uint8_t *data, size_t size, unsigned int flags)
+{
+	hoedown_block_cache_entry *entry;
+	uint64_t hash = line_hash(data, size);
+
+	for (entry = *bucket(cache, hash); entry; entry = entry->next) {
+		if (entry->line_hash != hash || (entry->flags & HOEDOWN_BLOCK_AFTER_OUTPUT) != (flags & HOEDOWN_BLOCK_AFTER_OUTPUT))
+			continue;
+
+		if (entry->flags & HOEDOWN_BLOCK_AT_END ? entry->key_size != size : entry->key_size > size)
+			continue;
+
+		if (memcmp(entry->data, data, entry->key_size) == 0) {
+			unlink_used(entry);
+			link_used(cache, entry);
+			cache->hits++;
+			return entry;
+		}
+	}
+
+	cache->misses++;
+	return NULL;
+}
+
+void
+hoedown_block_cache_store(hoedown_block_cache *cache, const uint8_t *key, size_t key_size, size_t block_size, const uint8_t *out, size_t out_size, unsigned int flags)
+{
+	hoedown_block_cache_entry *entry;
+	size_t cost = ENTRY_COST + key_size + out_size;
+
+	if (cost > cache->max_bytes)
+		return;
+
+	while (cache->bytes + cost > cache->max_bytes)
+		evict(cache, cache->lru.prev_used);
+
+	entry = malloc(sizeof(hoedown_block_cache_entry) + key_size + out_size);
+	if (!entry)
+		return;
+
+	entry->data = (uint8_t *)(entry + 1);
+	memcpy(entry->data, key, key_size);
+	memcpy(entry->data + key_size, out, out_size);
+	entry->line_hash = line_hash(key, key_size);
+	entry->key_size = key_size;
+	entry->block_size = block_size;
+	entry->out_size = out_size;
+	entry->flags = flags;
+
+	if (cache->count >= cache->nbuckets)
+		grow(cache);
+
+	entry->next = *bucket(cache, entry->line_hash);
+	*bucket(cache, entry->line_hash) = entry;
+	link_used(cache, entry);
+	cache->bytes += cost;
+	cache->count++;
+}
@@ -0,0 +1,70 @@
+/* block_cache.h - rendered top level blocks, reused by later renders */
+
+#ifndef HOEDOWN_BLOCK_CACHE_H
+#define HOEDOWN_BLOCK_CACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* hoedown_block_cache_flags - what the output of a block depends on besides its key */
+enum hoedown_block_cache_flags {
+	HOEDOWN_BLOCK_AFTER_OUTPUT = (1 << 0),	/* rendered after other output */
+	HOEDOWN_BLOCK_AT_END = (1 << 1)			/* the key runs to the end of the document */
+};
+
+/* hoedown_block_cache_entry - the output of one block */
+/*	the key is the source of the block followed by the lines that ended it;
+ *	data holds the key, then the output */
+struct hoedown_block_cache_entry {
+	struct hoedown_block_cache_entry *next;	/* in the same bucket */
+	struct hoedown_block_cache_entry *prev_used, *next_used;	/* most recently used first */
+	uint64_t line_hash;		/* hash of the first two lines of the key */
+	size_t key_size;
+	size_t block_size;		/* bytes of source the block spans */
+	size_t out_size;
+	unsigned int flags;
+	uint8_t *data;
+};
+
+typedef struct hoedown_block_cache_entry hoedown_block_cache_entry;
+
+/* hoedown_block_cache - entries found by the first two lines of their key */
+/*	a cache must only be shared by renders with the same extensions and
+ *	renderer options, see hoedown_markdown_set_block_cache */
+struct hoedown_block_cache {
+	hoedown_block_cache_entry **buckets;
+	size_t nbuckets;		/* a power of two */
+	hoedown_block_cache_entry lru;	/* list head */
+	size_t max_bytes;
+	size_t bytes;			/* bytes accounted for the entries */
+	size_t count;
+	size_t hits, misses;
+};
+
+typedef struct hoedown_block_cache hoedown_block_cache;
+
+/* hoedown_block_cache_new: allocation of an empty cache holding up to max_bytes */
+hoedown_block_cache *hoedown_block_cache_new(size_t max_bytes);
+
+void hoedown_block_cache_free(hoedown_block_cache *cache);
+
+/* hoedown_block_cache_clear: drops every entry, keeping the counters */
+void hoedown_block_cache_clear(hoedown_block_cache *cache);
+
+/* hoedown_block_cache_find: the entry whose key starts data, NULL if none */
+/*	with HOEDOWN_BLOCK_AT_END, the key must also end data */
+const hoedown_block_cache_entry *hoedown_block_cache_find(hoedown_block_cache *cache, const uint8_t *data, size_t size, unsigned int flags);
+
+/* hoedown_block_cache_store: adds a copy of a block and its output */
+/*	evicting the least recently used entries over the budget */
+void hoedown_block_cache_store(hoedown_block_cache *cache, const uint8_t *key, size_t key_size, size_t block_size, const uint8_t *out, size_t out_size, unsigned int flags);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /** HOEDOWN_BLOCK_CACHE_H **/
@@ -79,6 +79,10 @@ hoedown_buffer_put(hoedown_buffer *buf, const void *data, size_t len)
 {
 	assert(buf && buf->unit);
 
+	/* an empty buffer has no data yet, nor may an empty source */
+	if (!len)
+		return;
+
 	if (buf->size + len > buf->asize && hoedown_buffer_grow(buf, buf->size + len) < 0)
 		return;
 
@@ -9,21 +9,7 @@
 
 #define USE_XHTML(opt) (opt->flags & HOEDOWN_HTML_USE_XHTML)
 
-struct rndr_state {
-	struct {
-		int header_count;
-		int current_level;
-		int level_offset;
-		int nesting_level;
-	} toc_data;
-
-	unsigned int flags;
-
-	/* extra callbacks */
-	void (*link_attributes)(hoedown_buffer *ob, const hoedown_buffer *url, void *self);
-};
-
-typedef struct rndr_state rndr_state;
+typedef struct hoedown_html_renderer_state rndr_state;
 
 int
 hoedown_html_is_tag(const uint8_t *tag_data, size_t tag_size, const char *tagname)
@@ -68,6 +54,44 @@ static inline void escape_href(hoedown_buffer *ob, const uint8_t *source, size_t
 	hoedown_escape_href(ob, source, length);
 }
 
+/* block_sep • puts a block on its own line, unless it is the first one of
+ * ob or of the container last entered in place */
+static inline void
+block_sep(hoedown_buffer *ob, const rndr_state *state)
+{
+	if (ob->size && (ob != state->block_ob || ob->size != state->block_start))
+		hoedown_buffer_putc(ob, '\n');
+}
+
+/* rndr_text • writes raw text escaped, and with HOEDOWN_HTML_SMARTYPANTS
+ * converted as the text around it */
+static inline void
+rndr_text(hoedown_buffer *ob, const uint8_t *text, size_t size, rndr_state *state)
+{
+	if (state->flags & HOEDOWN_HTML_SMARTYPANTS)
+		hoedown_html_smartypants_text(ob, text, size, &state->smartypants);
+	else
+		escape_html(ob, text, size);
+}
+
+/* flush_text • converts the text smartypants left escaped only, before
+ * anything else is written */
+static inline void
+flush_text(rndr_state *state)
+{
+	if (state->flags & HOEDOWN_HTML_SMARTYPANTS)
+		hoedown_html_smartypants_flush(&state->smartypants);
+}
+
+/* end_text • forgets the smartypants quotes left open at the end of a block,
+ * so that a block renders the same whatever came before it */
+static inline void
+end_text(rndr_state *state)
+{
+	flush_text(state);
+	memset(&state->smartypants, 0, sizeof(state->smartypants));
+}
+
 /********************
  * GENERIC RENDERER *
  ********************/
@@ -84,6 +108,7 @@ rndr_autolink(hoedown_buffer *ob, const hoedown_buffer *link, enum hoedown_autol
 		type != HOEDOWN_AUTOLINK_EMAIL)
 		return 0;
 
+	flush_text(state);
 	HOEDOWN_BUFPUTSL(ob, "<a href=\"");
 	if (type == HOEDOWN_AUTOLINK_EMAIL)
 		HOEDOWN_BUFPUTSL(ob, "mailto:");
@@ -103,11 +128,12 @@ rndr_autolink(hoedown_buffer *ob, const hoedown_buffer *link, enum hoedown_autol
 	 * want to print the `mailto:` prefix
 	 */
 	if (hoedown_buffer_prefix(link, "mailto:") == 0) {
-		escape_html(ob, link->data + 7, link->size - 7);
+		rndr_text(ob, link->data + 7, link->size - 7, state);
 	} else {
-		escape_html(ob, link->data, link->size);
+		rndr_text(ob, link->data, link->size, state);
 	}
 
+	flush_text(state);
 	HOEDOWN_BUFPUTSL(ob, "</a>");
 
 	return 1;
@@ -118,7 +144,8 @@ rndr_blockcode(hoedown_buffer *ob, const hoedown_buffer *text, const hoedown_buf
 {
 	rndr_state *state = opaque;
 
-	if (ob->size) hoedown_buffer_putc(ob, '\n');
+	flush_text(state);
+	block_sep(ob, state);
 
 	if (lang && lang->size) {
 		size_t i, cls = 0;
@@ -159,25 +186,21 @@ rndr_blockcode(hoedown_buffer *ob, const hoedown_buffer *text, const hoedown_buf
 	HOEDOWN_BUFPUTSL(ob, "</code></pre>\n");
 }
 
-static void
-rndr_blockquote(hoedown_buffer *ob, const hoedown_buffer *text, void *opaque)
-{
-	if (ob->size) hoedown_buffer_putc(ob, '\n');
-	HOEDOWN_BUFPUTSL(ob, "<blockquote>\n");
-	if (text) hoedown_buffer_put(ob, text->data, text->size);
-	HOEDOWN_BUFPUTSL(ob, "</blockquote>\n");
-}
-
 static int
 rndr_codespan(hoedown_buffer *ob, const hoedown_buffer *text, void *opaque)
 {
 	rndr_state *state = opaque;
+	flush_text(state);
 	if (state->flags & HOEDOWN_HTML_PRETTIFY)
 		HOEDOWN_BUFPUTSL(ob, "<code class=\"prettyprint\">");
 	else
 		HOEDOWN_BUFPUTSL(ob, "<code>");
 	if (text) escape_html(ob, text->data, text->size);
 	HOEDOWN_BUFPUTSL(ob, "</code>");
+
+	/* the second pass would take it for the end of a raw <code> */
+	if (state->flags & HOEDOWN_HTML_SMARTYPANTS)
+		hoedown_html_smartypants_tag((const uint8_t *)"</code>", 7, &state->smartypants);
 	return 1;
 }
 
@@ -187,6 +210,7 @@ rndr_strikethrough(hoedown_buffer *ob, const hoedown_buffer *text, void *opaque)
 	if (!text || !text->size)
 		return 0;
 
+	flush_text(opaque);
 	HOEDOWN_BUFPUTSL(ob, "<del>");
 	hoedown_buffer_put(ob, text->data, text->size);
 	HOEDOWN_BUFPUTSL(ob, "</del>");
@@ -199,6 +223,7 @@ rndr_double_emphasis(hoedown_buffer *ob, const hoedown_buffer *text, void *opaqu
 	if (!text || !text->size)
 		return 0;
 
+	flush_text(opaque);
 	HOEDOWN_BUFPUTSL(ob, "<strong>");
 	hoedown_buffer_put(ob, text->data, text->size);
 	HOEDOWN_BUFPUTSL(ob, "</strong>");
@@ -210,6 +235,7 @@ static int
 rndr_emphasis(hoedown_buffer *ob, const hoedown_buffer *text, void *opaque)
 {
 	if (!text || !text->size) return 0;
+	flush_text(opaque);
 	HOEDOWN_BUFPUTSL(ob, "<em>");
 	if (text) hoedown_buffer_put(ob, text->data, text->size);
 	HOEDOWN_BUFPUTSL(ob, "</em>");
@@ -222,6 +248,7 @@ rndr_underline(hoedown_buffer *ob, const hoedown_buffer *text, void *opaque)
 	if (!text || !text->size)
 		return 0;
 
+	flush_text(opaque);
 	HOEDOWN_BUFPUTSL(ob, "<u>");
 	hoedown_buffer_put(ob, text->data, text->size);
 	HOEDOWN_BUFPUTSL(ob, "</u>");
@@ -235,6 +262,7 @@ rndr_highlight(hoedown_buffer *ob, const hoedown_buffer *text, void *opaque)
 	if (!text || !text->size)
 		return 0;
 
+	flush_text(opaque);
 	HOEDOWN_BUFPUTSL(ob, "<mark>");
 	hoedown_buffer_put(ob, text->data, text->size);
 	HOEDOWN_BUFPUTSL(ob, "</mark>");
@@ -245,11 +273,18 @@ rndr_highlight(hoedown_buffer *ob, const hoedown_buffer *text, void *opaque)
 static int
 rndr_quote(hoedown_buffer *ob, const hoedown_buffer *text, void *opaque)
 {
+	rndr_state *state = opaque;
+
 	if (!text || !text->size)
 		return 0;
 
+	flush_text(state);
 	HOEDOWN_BUFPUTSL(ob, "<q>");
-	hoedown_buffer_put(ob, text->data, text->size);
+	if (state->flags & HOEDOWN_HTML_SMARTYPANTS)
+		hoedown_html_smartypants_html(ob, text->data, text->size, &state->smartypants);
+	else
+		hoedown_buffer_put(ob, text->data, text->size);
+	flush_text(state);
 	HOEDOWN_BUFPUTSL(ob, "</q>");
 
 	return 1;
@@ -259,6 +294,7 @@ static int
 rndr_linebreak(hoedown_buffer *ob, void *opaque)
 {
 	rndr_state *state = opaque;
+	flush_text(state);
 	hoedown_buffer_puts(ob, USE_XHTML(state) ? "<br/>\n" : "<br>\n");
 	return 1;
 }
@@ -268,8 +304,8 @@ rndr_header(hoedown_buffer *ob, const hoedown_buffer *text, int level, void *opa
 {
 	rndr_state *state = opaque;
 
-	if (ob->size)
-		hoedown_buffer_putc(ob, '\n');
+	end_text(state);
+	block_sep(ob, state);
 
 	if ((state->flags & HOEDOWN_HTML_TOC) && (level <= state->toc_data.nesting_level))
 		hoedown_buffer_printf(ob, "<h%d id=\"toc_%d\">", level, state->toc_data.header_count++);
@@ -288,6 +324,7 @@ rndr_link(hoedown_buffer *ob, const hoedown_buffer *link, const hoedown_buffer *
 	if (link != NULL && (state->flags & HOEDOWN_HTML_SAFELINK) != 0 && !hoedown_autolink_is_safe(link->data, link->size))
 		return 0;
 
+	flush_text(state);
 	HOEDOWN_BUFPUTSL(ob, "<a href=\"");
 
 	if (link && link->size)
@@ -311,43 +348,20 @@ rndr_link(hoedown_buffer *ob, const hoedown_buffer *link, const hoedown_buffer *
 	return 1;
 }
 
-static void
-rndr_list(hoedown_buffer *ob, const hoedown_buffer *text, int flags, void *opaque)
-{
-	if (ob->size) hoedown_buffer_putc(ob, '\n');
-	hoedown_buffer_put(ob, flags & HOEDOWN_LIST_ORDERED ? "<ol>\n" : "<ul>\n", 5);
-	if (text) hoedown_buffer_put(ob, text->data, text->size);
-	hoedown_buffer_put(ob, flags & HOEDOWN_LIST_ORDERED ? "</ol>\n" : "</ul>\n", 6);
-}
-
-static void
-rndr_listitem(hoedown_buffer *ob, const hoedown_buffer *text, int flags, void *opaque)
-{
-	HOEDOWN_BUFPUTSL(ob, "<li>");
-	if (text) {
-		size_t size = text->size;
-		while (size && text->data[size - 1] == '\n')
-			size--;
-
-		hoedown_buffer_put(ob, text->data, size);
-	}
-	HOEDOWN_BUFPUTSL(ob, "</li>\n");
-}
-
 static void
 rndr_paragraph(hoedown_buffer *ob, const hoedown_buffer *text, void *opaque)
 {
 	rndr_state *state = opaque;
-	size_t i = 0;
+	size_t i = 0, size = text ? text->size : 0;
 
-	if (ob->size) hoedown_buffer_putc(ob, '\n');
+	while (i < size && isspace(text->data[i])) i++;
 
-	if (!text || !text->size)
-		return;
-
-	while (i < text->size && isspace(text->data[i])) i++;
+	/* decided before the text converts: a paragraph of a dropped &#0; is
+	 * still written, empty, as by the second pass */
+	end_text(state);
+	block_sep(ob, state);
 
-	if (i == text->size)
+	if (i == size)
 		return;
 
 	HOEDOWN_BUFPUTSL(ob, "<p>");
@@ -380,6 +394,7 @@ rndr_paragraph(hoedown_buffer *ob, const hoedown_buffer *text, void *opaque)
 static void
 rndr_raw_block(hoedown_buffer *ob, const hoedown_buffer *text, void *opaque)
 {
+	rndr_state *state = opaque;
 	size_t org, sz;
 	if (!text) return;
 	sz = text->size;
@@ -387,7 +402,8 @@ rndr_raw_block(hoedown_buffer *ob, const hoedown_buffer *text, void *opaque)
 	org = 0;
 	while (org < sz && text->data[org] == '\n') org++;
 	if (org >= sz) return;
-	if (ob->size) hoedown_buffer_putc(ob, '\n');
+	flush_text(state);
+	block_sep(ob, state);
 	hoedown_buffer_put(ob, text->data + org, sz - org);
 	hoedown_buffer_putc(ob, '\n');
 }
@@ -396,6 +412,7 @@ static int
 rndr_triple_emphasis(hoedown_buffer *ob, const hoedown_buffer *text, void *opaque)
 {
 	if (!text || !text->size) return 0;
+	flush_text(opaque);
 	HOEDOWN_BUFPUTSL(ob, "<strong><em>");
 	hoedown_buffer_put(ob, text->data, text->size);
 	HOEDOWN_BUFPUTSL(ob, "</em></strong>");
@@ -406,7 +423,8 @@ static void
 rndr_hrule(hoedown_buffer *ob, void *opaque)
 {
 	rndr_state *state = opaque;
-	if (ob->size) hoedown_buffer_putc(ob, '\n');
+	flush_text(state);
+	block_sep(ob, state);
 	hoedown_buffer_puts(ob, USE_XHTML(state) ? "<hr/>\n" : "<hr>\n");
 }
 
@@ -416,6 +434,7 @@ rndr_image(hoedown_buffer *ob, const hoedown_buffer *link, const hoedown_buffer
 	rndr_state *state = opaque;
 	if (!link || !link->size) return 0;
 
+	flush_text(state);
 	HOEDOWN_BUFPUTSL(ob, "<img src=\"");
 	escape_href(ob, link->data, link->size);
 	HOEDOWN_BUFPUTSL(ob, "\" alt=\"");
@@ -439,7 +458,7 @@ rndr_raw_html(hoedown_buffer *ob, const hoedown_buffer *text, void *opaque)
 	/* HTML_ESCAPE overrides SKIP_HTML, SKIP_STYLE, SKIP_LINKS and SKIP_IMAGES
 	* It doens't see if there are any valid tags, just escape all of them. */
 	if((state->flags & HOEDOWN_HTML_ESCAPE) != 0) {
-		escape_html(ob, text->data, text->size);
+		rndr_text(ob, text->data, text->size, state);
 		return 1;
 	}
 
@@ -458,34 +477,17 @@ rndr_raw_html(hoedown_buffer *ob, const hoedown_buffer *text, void *opaque)
 		hoedown_html_is_tag(text->data, text->size, "img"))
 		return 1;
 
+	flush_text(state);
 	hoedown_buffer_put(ob, text->data, text->size);
-	return 1;
-}
 
-static void
-rndr_table(hoedown_buffer *ob, const hoedown_buffer *header, const hoedown_buffer *body, void *opaque)
-{
-	if (ob->size) hoedown_buffer_putc(ob, '\n');
-	HOEDOWN_BUFPUTSL(ob, "<table><thead>\n");
-	if (header)
-		hoedown_buffer_put(ob, header->data, header->size);
-	HOEDOWN_BUFPUTSL(ob, "</thead><tbody>\n");
-	if (body)
-		hoedown_buffer_put(ob, body->data, body->size);
-	HOEDOWN_BUFPUTSL(ob, "</tbody></table>\n");
-}
-
-static void
-rndr_tablerow(hoedown_buffer *ob, const hoedown_buffer *text, void *opaque)
-{
-	HOEDOWN_BUFPUTSL(ob, "<tr>\n");
-	if (text)
-		hoedown_buffer_put(ob, text->data, text->size);
-	HOEDOWN_BUFPUTSL(ob, "</tr>\n");
+	if (state->flags & HOEDOWN_HTML_SMARTYPANTS)
+		hoedown_html_smartypants_tag(text->data, text->size, &state->smartypants);
+	return 1;
 }
 
+/* tablecell_open • opening tag of a table cell, rendered in place */
 static void
-rndr_tablecell(hoedown_buffer *ob, const hoedown_buffer *text, int flags, void *opaque)
+tablecell_open(hoedown_buffer *ob, int flags)
 {
 	if (flags & HOEDOWN_TABLE_HEADER) {
 		HOEDOWN_BUFPUTSL(ob, "<th");
@@ -509,48 +511,37 @@ rndr_tablecell(hoedown_buffer *ob, const hoedown_buffer *text, int flags, void *
 	default:
 		HOEDOWN_BUFPUTSL(ob, ">");
 	}
-
-	if (text)
-		hoedown_buffer_put(ob, text->data, text->size);
-
-	if (flags & HOEDOWN_TABLE_HEADER) {
-		HOEDOWN_BUFPUTSL(ob, "</th>\n");
-	} else {
-		HOEDOWN_BUFPUTSL(ob, "</td>\n");
-	}
 }
 
 static int
 rndr_superscript(hoedown_buffer *ob, const hoedown_buffer *text, void *opaque)
 {
 	if (!text || !text->size) return 0;
+	flush_text(opaque);
 	HOEDOWN_BUFPUTSL(ob, "<sup>");
 	hoedown_buffer_put(ob, text->data, text->size);
 	HOEDOWN_BUFPUTSL(ob, "</sup>");
 	return 1;
 }
 
+/* rndr_entity • only with HOEDOWN_HTML_SMARTYPANTS, which converts &quot;
+ * and the like, and drops &#0; */
 static void
-rndr_normal_text(hoedown_buffer *ob, const hoedown_buffer *text, void *opaque)
+rndr_entity(hoedown_buffer *ob, const hoedown_buffer *entity, void *opaque)
 {
-	if (text)
-		escape_html(ob, text->data, text->size);
+	rndr_state *state = opaque;
+	hoedown_html_smartypants_html(ob, entity->data, entity->size, &state->smartypants);
 }
 
 static void
-rndr_footnotes(hoedown_buffer *ob, const hoedown_buffer *text, void *opaque)
+rndr_normal_text(hoedown_buffer *ob, const hoedown_buffer *text, void *opaque)
 {
 	rndr_state *state = opaque;
 
-	if (ob->size) hoedown_buffer_putc(ob, '\n');
-	HOEDOWN_BUFPUTSL(ob, "<div class=\"footnotes\">\n");
-	hoedown_buffer_puts(ob, USE_XHTML(state) ? "<hr/>\n" : "<hr>\n");
-	HOEDOWN_BUFPUTSL(ob, "<ol>\n");
-	
-	if (text)
-		hoedown_buffer_put(ob, text->data, text->size);
-	
-	HOEDOWN_BUFPUTSL(ob, "\n</ol>\n</div>\n");
+	if (!text)
+		return;
+
+	rndr_text(ob, text->data, text->size, state);
 }
 
 static void
@@ -558,7 +549,9 @@ rndr_footnote_def(hoedown_buffer *ob, const hoedown_buffer *text, unsigned int n
 {
 	size_t i = 0;
 	int pfound = 0;
-	
+
+	end_text(opaque);
+
 	/* insert anchor at the end of first paragraph block */
 	if (text) {
 		while ((i+3) < text->size) {
@@ -583,9 +576,121 @@ rndr_footnote_def(hoedown_buffer *ob, const hoedown_buffer *text, unsigned int n
 	HOEDOWN_BUFPUTSL(ob, "</li>\n");
 }
 
+/* rndr_container_enter • opening tags of the containers rendered in place */
+static void
+rndr_container_enter(hoedown_buffer *ob, enum hoedown_container type, int flags, void *opaque)
+{
+	rndr_state *state = opaque;
+
+	end_text(state);
+
+	switch (type) {
+	case HOEDOWN_CONTAINER_BLOCKQUOTE:
+		block_sep(ob, state);
+		HOEDOWN_BUFPUTSL(ob, "<blockquote>\n");
+		break;
+
+	case HOEDOWN_CONTAINER_LIST:
+		block_sep(ob, state);
+		hoedown_buffer_put(ob, flags & HOEDOWN_LIST_ORDERED ? "<ol>\n" : "<ul>\n", 5);
+		break;
+
+	case HOEDOWN_CONTAINER_LISTITEM:
+		HOEDOWN_BUFPUTSL(ob, "<li>");
+		break;
+
+	case HOEDOWN_CONTAINER_TABLE:
+		block_sep(ob, state);
+		HOEDOWN_BUFPUTSL(ob, "<table>");
+		break;
+
+	case HOEDOWN_CONTAINER_TABLE_HEADER:
+		HOEDOWN_BUFPUTSL(ob, "<thead>\n");
+		break;
+
+	case HOEDOWN_CONTAINER_TABLE_BODY:
+		HOEDOWN_BUFPUTSL(ob, "<tbody>\n");
+		break;
+
+	case HOEDOWN_CONTAINER_TABLE_ROW:
+		HOEDOWN_BUFPUTSL(ob, "<tr>\n");
+		break;
+
+	case HOEDOWN_CONTAINER_TABLE_CELL:
+		tablecell_open(ob, flags);
+		break;
+
+	case HOEDOWN_CONTAINER_FOOTNOTES:
+		block_sep(ob, state);
+		HOEDOWN_BUFPUTSL(ob, "<div class=\"footnotes\">\n");
+		hoedown_buffer_puts(ob, USE_XHTML(state) ? "<hr/>\n" : "<hr>\n");
+		HOEDOWN_BUFPUTSL(ob, "<ol>\n");
+		break;
+	}
+
+	state->block_ob = ob;
+	state->block_start = ob->size;
+}
+
+/* rndr_container_leave • closing tags of the containers rendered in place */
+static void
+rndr_container_leave(hoedown_buffer *ob, enum hoedown_container type, int flags, size_t content, void *opaque)
+{
+	rndr_state *state = opaque;
+
+	end_text(state);
+
+	switch (type) {
+	case HOEDOWN_CONTAINER_BLOCKQUOTE:
+		HOEDOWN_BUFPUTSL(ob, "</blockquote>\n");
+		break;
+
+	case HOEDOWN_CONTAINER_LIST:
+		hoedown_buffer_put(ob, flags & HOEDOWN_LIST_ORDERED ? "</ol>\n" : "</ul>\n", 6);
+		break;
+
+	case HOEDOWN_CONTAINER_LISTITEM:
+		while (ob->size > content && ob->data[ob->size - 1] == '\n')
+			ob->size--;
+		HOEDOWN_BUFPUTSL(ob, "</li>\n");
+		break;
+
+	case HOEDOWN_CONTAINER_TABLE:
+		HOEDOWN_BUFPUTSL(ob, "</table>\n");
+		break;
+
+	case HOEDOWN_CONTAINER_TABLE_HEADER:
+		HOEDOWN_BUFPUTSL(ob, "</thead>");
+		break;
+
+	case HOEDOWN_CONTAINER_TABLE_BODY:
+		HOEDOWN_BUFPUTSL(ob, "</tbody>");
+		break;
+
+	case HOEDOWN_CONTAINER_TABLE_ROW:
+		HOEDOWN_BUFPUTSL(ob, "</tr>\n");
+		break;
+
+	case HOEDOWN_CONTAINER_TABLE_CELL:
+		if (flags & HOEDOWN_TABLE_HEADER)
+			HOEDOWN_BUFPUTSL(ob, "</th>\n");
+		else
+			HOEDOWN_BUFPUTSL(ob, "</td>\n");
+		break;
+
+	case HOEDOWN_CONTAINER_FOOTNOTES:
+		HOEDOWN_BUFPUTSL(ob, "\n</ol>\n</div>\n");
+		break;
+	}
+
+	/* the content is not empty anymore, so no block follows its start */
+	state->block_ob = NULL;
+}
+
 static int
 rndr_footnote_ref(hoedown_buffer *ob, unsigned int num, void *opaque)
 {
+	flush_text(opaque);
 	hoedown_buffer_printf(ob, "<sup id=\"fnref%d\"><a href=\"#fn%d\" rel=\"footnote\">%d</a></sup>", num, num, num);
 	return 1;
 }
@@ -595,6 +700,12 @@ toc_header(hoedown_buffer *ob, const hoedown_buffer *text, int level, void *opaq
 {
 	rndr_state *state = opaque;
 
+	/* a header nested in a block the TOC drops only takes its id */
+	if (level <= state->toc_data.nesting_level && ob != state->toc_data.ob) {
+		state->toc_data.header_count++;
+		return;
+	}
+
 	if (level <= state->toc_data.nesting_level) {
 		/* set the level offset if this is the first header
 		 * we're parsing for the document */
@@ -625,6 +736,13 @@ toc_header(hoedown_buffer *ob, const hoedown_buffer *text, int level, void *opaq
 	}
 }
 
+/* toc_blockhtml • leaves HTML blocks out, parsed as the HTML renderer parses
+ * them: the headers they hold get no id there */
+static void
+toc_blockhtml(hoedown_buffer *ob, const hoedown_buffer *text, void *opaque)
+{
+}
+
 static int
 toc_link(hoedown_buffer *ob, const hoedown_buffer *link, const hoedown_buffer *title, const hoedown_buffer *content, void *opaque)
 {
@@ -633,6 +751,17 @@ toc_link(hoedown_buffer *ob, const hoedown_buffer *link, const hoedown_buffer *t
 	return 1;
 }
 
+/* toc_doc_header • takes note of the TOC output, which top level headers go
+ * to, with no list open, also after a render left by a longjmp */
+static void
+toc_doc_header(hoedown_buffer *ob, void *opaque)
+{
+	rndr_state *state = opaque;
+
+	state->toc_data.ob = ob;
+	state->toc_data.current_level = 0;
+}
+
 static void
 toc_finalize(hoedown_buffer *ob, void *opaque)
 {
@@ -642,6 +771,24 @@ toc_finalize(hoedown_buffer *ob, void *opaque)
 		HOEDOWN_BUFPUTSL(ob, "</li>\n</ul>\n");
 		state->toc_data.current_level--;
 	}
+	state->toc_data.ob = NULL;
+}
+
+/* rndr_doc_header • starts the document with no smartypants quote open */
+static void
+rndr_doc_header(hoedown_buffer *ob, void *opaque)
+{
+	rndr_state *state = opaque;
+
+	/* nothing is held yet, from this document */
+	memset(&state->smartypants, 0, sizeof(state->smartypants));
+}
+
+/* rndr_doc_footer • converts the text smartypants left at the end */
+static void
+rndr_doc_footer(hoedown_buffer *ob, void *opaque)
+{
+	flush_text(opaque);
 }
 
 hoedown_renderer *
@@ -650,7 +797,7 @@ hoedown_html_toc_renderer_new(int nesting_level)
 	static const hoedown_renderer cb_default = {
 		NULL,
 		NULL,
-		NULL,
+		toc_blockhtml,
 		toc_header,
 		NULL,
 		NULL,
@@ -681,9 +828,12 @@ hoedown_html_toc_renderer_new(int nesting_level)
 		NULL,
 		NULL,
 
-		NULL,
+		toc_doc_header,
 		toc_finalize,
 		
+		NULL,
+
+		NULL,
 		NULL
 	};
 
@@ -720,17 +870,17 @@ hoedown_html_renderer_new(unsigned int render_flags, int nesting_level)
 {
 	static const hoedown_renderer cb_default = {
 		rndr_blockcode,
-		rndr_blockquote,
+		NULL,
 		rndr_raw_block,
 		rndr_header,
 		rndr_hrule,
-		rndr_list,
-		rndr_listitem,
+		NULL,
+		NULL,
 		rndr_paragraph,
-		rndr_table,
-		rndr_tablerow,
-		rndr_tablecell,
-		rndr_footnotes,
+		NULL,
+		NULL,
+		NULL,
+		NULL,
 		rndr_footnote_def,
 
 		rndr_autolink,
@@ -752,10 +902,13 @@ hoedown_html_renderer_new(unsigned int render_flags, int nesting_level)
 		NULL,
 		rndr_normal_text,
 
-		NULL,
-		NULL,
+		rndr_doc_header,
+		rndr_doc_footer,
 		
-		NULL
+		NULL,
+
+		rndr_container_enter,
+		rndr_container_leave
 	};
 
 	rndr_state       *state;
@@ -794,6 +947,9 @@ hoedown_html_renderer_new(unsigned int render_flags, int nesting_level)
 
 	if (render_flags & HOEDOWN_HTML_SKIP_HTML || render_flags & HOEDOWN_HTML_ESCAPE)
 		renderer->blockhtml = NULL;
+
+	if (render_flags & HOEDOWN_HTML_SMARTYPANTS)
+		renderer->entity = rndr_entity;
 	
 	renderer->opaque = state;
 	return renderer;
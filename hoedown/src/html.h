@@ -22,7 +22,8 @@ typedef enum {
 	HOEDOWN_HTML_HARD_WRAP = (1 << 7),
 	HOEDOWN_HTML_USE_XHTML = (1 << 8),
 	HOEDOWN_HTML_ESCAPE = (1 << 9),
-	HOEDOWN_HTML_PRETTIFY = (1 << 10)
+	HOEDOWN_HTML_PRETTIFY = (1 << 10),
+	HOEDOWN_HTML_SMARTYPANTS = (1 << 11)
 } hoedown_html_render_mode;
 
 typedef enum {
@@ -31,6 +32,47 @@ typedef enum {
 	HOEDOWN_HTML_TAG_CLOSE
 } hoedown_html_tag;
 
+/* hoedown_html_smartypants_data - smartypants state between runs of text */
+struct hoedown_html_smartypants_data {
+	int in_squote;
+	int in_dquote;
+	int skip_tag;	/* inside the raw HTML tag of this index + 1, left alone */
+
+	/* the text written last, escaped but not converted yet */
+	hoedown_buffer *ob;	/* where it was written, or NULL */
+	size_t start;	/* where it starts there */
+};
+
+typedef struct hoedown_html_smartypants_data hoedown_html_smartypants_data;
+
+/* hoedown_html_renderer_state - opaque of the HTML and TOC renderers */
+struct hoedown_html_renderer_state {
+	void *opaque;	/* free for the user of the renderer */
+
+	struct {
+		int header_count;
+		int current_level;
+		int level_offset;
+		int nesting_level;
+		const hoedown_buffer *ob;	/* the TOC while it is rendered */
+	} toc_data;
+
+	unsigned int flags;
+
+	/* extra callbacks */
+	void (*link_attributes)(hoedown_buffer *ob, const hoedown_buffer *url, void *self);
+
+	/* content start of the last container entered in place */
+	const hoedown_buffer *block_ob;
+	size_t block_start;
+
+	/* quotes open in the text of the current block, with
+	 * HOEDOWN_HTML_SMARTYPANTS */
+	hoedown_html_smartypants_data smartypants;
+};
+
+typedef struct hoedown_html_renderer_state hoedown_html_renderer_state;
+
 int
 hoedown_html_is_tag(const uint8_t *tag_data, size_t tag_size, const char *tagname);
 
@@ -46,6 +88,35 @@ hoedown_html_renderer_free(hoedown_renderer *renderer);
 extern void
 hoedown_html_smartypants(hoedown_buffer *ob, const uint8_t *text, size_t size);
 
+/* hoedown_html_smartypants_text: smartypants of raw text, escaped as HTML */
+/*	the buffered conversion of HOEDOWN_HTML_SMARTYPANTS. the text is only
+ *	escaped into ob, and converts with what is written straight after it,
+ *	sharing smrt, once hoedown_html_smartypants_flush is called, which
+ *	copies it out and scans it again: as by hoedown_html_smartypants, but
+ *	for the quotes and the skipped tag left open in smrt before. an
+ *	autolink may still take it back from ob as it is in the source */
+extern void
+hoedown_html_smartypants_text(hoedown_buffer *ob, const uint8_t *text, size_t size, hoedown_html_smartypants_data *smrt);
+
+/* hoedown_html_smartypants_html: smartypants of HTML written as is between runs of text */
+/*	for entities and other HTML the renderer copies from the source */
+extern void
+hoedown_html_smartypants_html(hoedown_buffer *ob, const uint8_t *text, size_t size, hoedown_html_smartypants_data *smrt);
+
+/* hoedown_html_smartypants_flush: converts the text written since the last call */
+/*	whatever writes to ob other than the two above calls this first, and
+ *	so does the end of the text: what follows it in ob is no longer seen
+ *	by the conversion. bytes put in ob after the text without a call,
+ *	such as a backslash the parser writes itself, convert along with it */
+extern void
+hoedown_html_smartypants_flush(hoedown_html_smartypants_data *smrt);
+
+/* hoedown_html_smartypants_tag: follows a raw HTML tag written between runs of text */
+/*	the content of pre, code, var, samp, kbd, math, script and style is
+ *	left alone, as by hoedown_html_smartypants */
+extern void
+hoedown_html_smartypants_tag(const uint8_t *tag, size_t size, hoedown_html_smartypants_data *smrt);
+
 #ifdef __cplusplus
 }
 #endif
@@ -1,4 +1,5 @@
 #include "html.h"
+#include "escape.h"
 
 #include <string.h>
 #include <stdlib.h>
@@ -9,24 +10,26 @@
 #define snprintf _snprintf
 #endif
 
-struct smartypants_data {
-	int in_squote;
-	int in_dquote;
-};
+#if defined(__SSE2__) && defined(__GNUC__)
+#include <emmintrin.h>
+#define SMARTYPANTS_SSE2
+#endif
+
+typedef hoedown_html_smartypants_data smartypants_data;
 
-static size_t smartypants_cb__ltag(hoedown_buffer *ob, struct smartypants_data *smrt, uint8_t previous_char, const uint8_t *text, size_t size);
-static size_t smartypants_cb__dquote(hoedown_buffer *ob, struct smartypants_data *smrt, uint8_t previous_char, const uint8_t *text, size_t size);
-static size_t smartypants_cb__amp(hoedown_buffer *ob, struct smartypants_data *smrt, uint8_t previous_char, const uint8_t *text, size_t size);
-static size_t smartypants_cb__period(hoedown_buffer *ob, struct smartypants_data *smrt, uint8_t previous_char, const uint8_t *text, size_t size);
-static size_t smartypants_cb__number(hoedown_buffer *ob, struct smartypants_data *smrt, uint8_t previous_char, const uint8_t *text, size_t size);
-static size_t smartypants_cb__dash(hoedown_buffer *ob, struct smartypants_data *smrt, uint8_t previous_char, const uint8_t *text, size_t size);
-static size_t smartypants_cb__parens(hoedown_buffer *ob, struct smartypants_data *smrt, uint8_t previous_char, const uint8_t *text, size_t size);
-static size_t smartypants_cb__squote(hoedown_buffer *ob, struct smartypants_data *smrt, uint8_t previous_char, const uint8_t *text, size_t size);
-static size_t smartypants_cb__backtick(hoedown_buffer *ob, struct smartypants_data *smrt, uint8_t previous_char, const uint8_t *text, size_t size);
-static size_t smartypants_cb__escape(hoedown_buffer *ob, struct smartypants_data *smrt, uint8_t previous_char, const uint8_t *text, size_t size);
+static size_t smartypants_cb__ltag(hoedown_buffer *ob, smartypants_data *smrt, uint8_t previous_char, const uint8_t *text, size_t size);
+static size_t smartypants_cb__dquote(hoedown_buffer *ob, smartypants_data *smrt, uint8_t previous_char, const uint8_t *text, size_t size);
+static size_t smartypants_cb__amp(hoedown_buffer *ob, smartypants_data *smrt, uint8_t previous_char, const uint8_t *text, size_t size);
+static size_t smartypants_cb__period(hoedown_buffer *ob, smartypants_data *smrt, uint8_t previous_char, const uint8_t *text, size_t size);
+static size_t smartypants_cb__number(hoedown_buffer *ob, smartypants_data *smrt, uint8_t previous_char, const uint8_t *text, size_t size);
+static size_t smartypants_cb__dash(hoedown_buffer *ob, smartypants_data *smrt, uint8_t previous_char, const uint8_t *text, size_t size);
+static size_t smartypants_cb__parens(hoedown_buffer *ob, smartypants_data *smrt, uint8_t previous_char, const uint8_t *text, size_t size);
+static size_t smartypants_cb__squote(hoedown_buffer *ob, smartypants_data *smrt, uint8_t previous_char, const uint8_t *text, size_t size);
+static size_t smartypants_cb__backtick(hoedown_buffer *ob, smartypants_data *smrt, uint8_t previous_char, const uint8_t *text, size_t size);
+static size_t smartypants_cb__escape(hoedown_buffer *ob, smartypants_data *smrt, uint8_t previous_char, const uint8_t *text, size_t size);
 
 static size_t (*smartypants_cb_ptrs[])
-	(hoedown_buffer *, struct smartypants_data *, uint8_t, const uint8_t *, size_t) =
+	(hoedown_buffer *, smartypants_data *, uint8_t, const uint8_t *, size_t) =
 {
 	NULL,					/* 0 */
 	smartypants_cb__dash,	/* 1 */
@@ -60,6 +63,59 @@ static const uint8_t smartypants_cb_chars[] = {
 	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
 };
 
+/* the tags whose content is left alone */
+static const char *skip_tags[] = {
+	"pre", "code", "var", "samp", "kbd", "math", "script", "style"
+};
+
+#define SKIP_TAGS_COUNT (sizeof(skip_tags) / sizeof(skip_tags[0]))
+
+/* skip_plain • the number of bytes before the first one with an action */
+/*	where SSE2 is there, 16 bytes are compared at once, and a dash, a
+ *	period or a digit is only stopped at when the next byte may start what
+ *	its callback converts; the others would copy it as is */
+static inline size_t
+skip_plain(const uint8_t *text, size_t size)
+{
+	size_t i = 0;
+
+#ifdef SMARTYPANTS_SSE2
+	const __m128i dash = _mm_set1_epi8('-'), period = _mm_set1_epi8('.');
+	const __m128i space = _mm_set1_epi8(' '), slash = _mm_set1_epi8('/');
+	const __m128i one = _mm_set1_epi8('1'), three = _mm_set1_epi8('3');
+	const __m128i squote = _mm_set1_epi8('\''), dquote = _mm_set1_epi8('"');
+	const __m128i amp = _mm_set1_epi8('&'), paren = _mm_set1_epi8('(');
+	const __m128i lt = _mm_set1_epi8('<'), backtick = _mm_set1_epi8('`');
+	const __m128i backslash = _mm_set1_epi8('\\');
+
+	while (i + 17 <= size) {
+		__m128i v = _mm_loadu_si128((const __m128i *)(text + i));
+		__m128i next = _mm_loadu_si128((const __m128i *)(text + i + 1)), m;
+		int mask;
+
+		m = _mm_and_si128(_mm_cmpeq_epi8(v, dash), _mm_cmpeq_epi8(next, dash));
+		m = _mm_or_si128(m, _mm_and_si128(_mm_cmpeq_epi8(v, period),
+			_mm_or_si128(_mm_cmpeq_epi8(next, period), _mm_cmpeq_epi8(next, space))));
+		m = _mm_or_si128(m, _mm_and_si128(_mm_cmpeq_epi8(next, slash),
+			_mm_or_si128(_mm_cmpeq_epi8(v, one), _mm_cmpeq_epi8(v, three))));
+		m = _mm_or_si128(m, _mm_or_si128(_mm_cmpeq_epi8(v, squote), _mm_cmpeq_epi8(v, dquote)));
+		m = _mm_or_si128(m, _mm_or_si128(_mm_cmpeq_epi8(v, amp), _mm_cmpeq_epi8(v, paren)));
+		m = _mm_or_si128(m, _mm_or_si128(_mm_cmpeq_epi8(v, lt), _mm_cmpeq_epi8(v, backtick)));
+		m = _mm_or_si128(m, _mm_cmpeq_epi8(v, backslash));
+
+		mask = _mm_movemask_epi8(m);
+		if (mask)
+			return i + __builtin_ctz(mask);
+		i += 16;
+	}
+#endif
+
+	while (i < size && smartypants_cb_chars[text[i]] == 0)
+		i++;
+
+	return i;
+}
+
 static inline int
 word_boundary(uint8_t c)
 {
@@ -112,7 +168,7 @@ smartypants_quotes(hoedown_buffer *ob, uint8_t previous_char, uint8_t next_char,
 	'text' points at the last character of the single-quote, e.g. ' or ;
 */
 static size_t
-smartypants_squote(hoedown_buffer *ob, struct smartypants_data *smrt, uint8_t previous_char, const uint8_t *text, size_t size,
+smartypants_squote(hoedown_buffer *ob, smartypants_data *smrt, uint8_t previous_char, const uint8_t *text, size_t size,
 				   const uint8_t *squote_text, size_t squote_size)
 {
 	if (size >= 2) {
@@ -128,7 +184,7 @@ smartypants_squote(hoedown_buffer *ob, struct smartypants_data *smrt, uint8_t pr
 
 		/* Tom's, isn't, I'm, I'd */
 		if ((t1 == 's' || t1 == 't' || t1 == 'm' || t1 == 'd') &&
-			(size == 3 || word_boundary(text[2]))) {
+			(size == 2 || word_boundary(text[2]))) {
 			HOEDOWN_BUFPUTSL(ob, "&rsquo;");
 			return 0;
 		}
@@ -140,14 +196,14 @@ smartypants_squote(hoedown_buffer *ob, struct smartypants_data *smrt, uint8_t pr
 			if (((t1 == 'r' && t2 == 'e') ||
 				(t1 == 'l' && t2 == 'l') ||
 				(t1 == 'v' && t2 == 'e')) &&
-				(size == 4 || word_boundary(text[3]))) {
+				(size == 3 || word_boundary(text[3]))) {
 				HOEDOWN_BUFPUTSL(ob, "&rsquo;");
 				return 0;
 			}
 		}
 	}
 
-	if (smartypants_quotes(ob, previous_char, size > 0 ? text[1] : 0, 's', &smrt->in_squote))
+	if (smartypants_quotes(ob, previous_char, size > 1 ? text[1] : 0, 's', &smrt->in_squote))
 		return 0;
 
 	hoedown_buffer_put(ob, squote_text, squote_size);
@@ -156,14 +212,14 @@ smartypants_squote(hoedown_buffer *ob, struct smartypants_data *smrt, uint8_t pr
 
 /* Converts ' to left or right single quote. */
 static size_t
-smartypants_cb__squote(hoedown_buffer *ob, struct smartypants_data *smrt, uint8_t previous_char, const uint8_t *text, size_t size)
+smartypants_cb__squote(hoedown_buffer *ob, smartypants_data *smrt, uint8_t previous_char, const uint8_t *text, size_t size)
 {
 	return smartypants_squote(ob, smrt, previous_char, text, size, text, 1);
 }
 
 /* Converts (c), (r), (tm) */
 static size_t
-smartypants_cb__parens(hoedown_buffer *ob, struct smartypants_data *smrt, uint8_t previous_char, const uint8_t *text, size_t size)
+smartypants_cb__parens(hoedown_buffer *ob, smartypants_data *smrt, uint8_t previous_char, const uint8_t *text, size_t size)
 {
 	if (size >= 3) {
 		uint8_t t1 = tolower(text[1]);
@@ -191,7 +247,7 @@ smartypants_cb__parens(hoedown_buffer *ob, struct smartypants_data *smrt, uint8_
 
 /* Converts "--" to em-dash, etc. */
 static size_t
-smartypants_cb__dash(hoedown_buffer *ob, struct smartypants_data *smrt, uint8_t previous_char, const uint8_t *text, size_t size)
+smartypants_cb__dash(hoedown_buffer *ob, smartypants_data *smrt, uint8_t previous_char, const uint8_t *text, size_t size)
 {
 	if (size >= 3 && text[1] == '-' && text[2] == '-') {
 		HOEDOWN_BUFPUTSL(ob, "&mdash;");
@@ -209,7 +265,7 @@ smartypants_cb__dash(hoedown_buffer *ob, struct smartypants_data *smrt, uint8_t
 
 /* Converts &quot; etc. */
 static size_t
-smartypants_cb__amp(hoedown_buffer *ob, struct smartypants_data *smrt, uint8_t previous_char, const uint8_t *text, size_t size)
+smartypants_cb__amp(hoedown_buffer *ob, smartypants_data *smrt, uint8_t previous_char, const uint8_t *text, size_t size)
 {
 	int len;
 	if (size >= 6 && memcmp(text, "&quot;", 6) == 0) {
@@ -231,7 +287,7 @@ smartypants_cb__amp(hoedown_buffer *ob, struct smartypants_data *smrt, uint8_t p
 
 /* Converts "..." to ellipsis */
 static size_t
-smartypants_cb__period(hoedown_buffer *ob, struct smartypants_data *smrt, uint8_t previous_char, const uint8_t *text, size_t size)
+smartypants_cb__period(hoedown_buffer *ob, smartypants_data *smrt, uint8_t previous_char, const uint8_t *text, size_t size)
 {
 	if (size >= 3 && text[1] == '.' && text[2] == '.') {
 		HOEDOWN_BUFPUTSL(ob, "&hellip;");
@@ -249,7 +305,7 @@ smartypants_cb__period(hoedown_buffer *ob, struct smartypants_data *smrt, uint8_
 
 /* Converts `` to opening double quote */
 static size_t
-smartypants_cb__backtick(hoedown_buffer *ob, struct smartypants_data *smrt, uint8_t previous_char, const uint8_t *text, size_t size)
+smartypants_cb__backtick(hoedown_buffer *ob, smartypants_data *smrt, uint8_t previous_char, const uint8_t *text, size_t size)
 {
 	if (size >= 2 && text[1] == '`') {
 		if (smartypants_quotes(ob, previous_char, size >= 3 ? text[2] : 0, 'd', &smrt->in_dquote))
@@ -262,7 +318,7 @@ smartypants_cb__backtick(hoedown_buffer *ob, struct smartypants_data *smrt, uint
 
 /* Converts 1/2, 1/4, 3/4 */
 static size_t
-smartypants_cb__number(hoedown_buffer *ob, struct smartypants_data *smrt, uint8_t previous_char, const uint8_t *text, size_t size)
+smartypants_cb__number(hoedown_buffer *ob, smartypants_data *smrt, uint8_t previous_char, const uint8_t *text, size_t size)
 {
 	if (word_boundary(previous_char) && size >= 3) {
 		if (text[0] == '1' && text[1] == '/' && text[2] == '2') {
@@ -295,59 +351,70 @@ smartypants_cb__number(hoedown_buffer *ob, struct smartypants_data *smrt, uint8_
 
 /* Converts " to left or right double quote */
 static size_t
-smartypants_cb__dquote(hoedown_buffer *ob, struct smartypants_data *smrt, uint8_t previous_char, const uint8_t *text, size_t size)
+smartypants_cb__dquote(hoedown_buffer *ob, smartypants_data *smrt, uint8_t previous_char, const uint8_t *text, size_t size)
 {
-	if (!smartypants_quotes(ob, previous_char, size > 0 ? text[1] : 0, 'd', &smrt->in_dquote))
+	if (!smartypants_quotes(ob, previous_char, size > 1 ? text[1] : 0, 'd', &smrt->in_dquote))
 		HOEDOWN_BUFPUTSL(ob, "&quot;");
 
 	return 0;
 }
 
+/* skipped_end • where the content of skip_tags[tag] ends in text, from i:
+ * the '>' of its closing tag, or size when it does not close there. the
+ * '<' on the way are only looked at when a '/' follows */
 static size_t
-smartypants_cb__ltag(hoedown_buffer *ob, struct smartypants_data *smrt, uint8_t previous_char, const uint8_t *text, size_t size)
+skipped_end(const uint8_t *text, size_t size, size_t i, size_t tag)
 {
-	static const char *skip_tags[] = {
-	  "pre", "code", "var", "samp", "kbd", "math", "script", "style"
-	};
-	static const size_t skip_tags_count = 8;
-
-	size_t tag, i = 0;
-
-	while (i < size && text[i] != '>')
-		i++;
+	const uint8_t *p = NULL;
 
-	for (tag = 0; tag < skip_tags_count; ++tag) {
-		if (hoedown_html_is_tag(text, size, skip_tags[tag]) == HOEDOWN_HTML_TAG_OPEN)
+	while (i < size && (p = memchr(text + i, '<', size - i)) != NULL) {
+		i = p - text;
+		if (i + 1 < size && text[i + 1] == '/' &&
+			hoedown_html_is_tag(text + i, size - i, skip_tags[tag]) == HOEDOWN_HTML_TAG_CLOSE)
 			break;
+		i++;
 	}
 
-	if (tag < skip_tags_count) {
-		for (;;) {
-			while (i < size && text[i] != '<')
-				i++;
+	if (!p || i >= size)
+		return size;
 
-			if (i == size)
-				break;
+	p = memchr(text + i, '>', size - i);
+	return p ? (size_t)(p - text) : size;
+}
 
-			if (hoedown_html_is_tag(text + i, size - i, skip_tags[tag]) == HOEDOWN_HTML_TAG_CLOSE)
-				break;
+static size_t
+smartypants_cb__ltag(hoedown_buffer *ob, smartypants_data *smrt, uint8_t previous_char, const uint8_t *text, size_t size)
+{
+	const uint8_t *p;
+	size_t tag, i;
 
-			i++;
-		}
+	p = memchr(text, '>', size);
+	i = p ? (size_t)(p - text) : size;
 
-		while (i < size && text[i] != '>')
-			i++;
+	for (tag = 0; tag < SKIP_TAGS_COUNT; ++tag) {
+		if (hoedown_html_is_tag(text, size, skip_tags[tag]) == HOEDOWN_HTML_TAG_OPEN)
+			break;
+	}
+
+	if (tag < SKIP_TAGS_COUNT) {
+		i = skipped_end(text, size, i, tag);
+
+		/* not closed yet: what is written next is left alone too */
+		if (i == size)
+			smrt->skip_tag = (int)tag + 1;
 	}
 
-	hoedown_buffer_put(ob, text, i + 1);
+	hoedown_buffer_put(ob, text, i < size ? i + 1 : size);
 	return i;
 }
 
 static size_t
-smartypants_cb__escape(hoedown_buffer *ob, struct smartypants_data *smrt, uint8_t previous_char, const uint8_t *text, size_t size)
+smartypants_cb__escape(hoedown_buffer *ob, smartypants_data *smrt, uint8_t previous_char, const uint8_t *text, size_t size)
 {
-	if (size < 2)
+	if (size < 2) {
+		hoedown_buffer_putc(ob, '\\');
 		return 0;
+	}
 
 	switch (text[1]) {
 	case '\\':
@@ -395,31 +462,140 @@ static struct {
 };
 #endif
 
-void
-hoedown_html_smartypants(hoedown_buffer *ob, const uint8_t *text, size_t size)
+/* smartypants_convert • converts HTML into ob, with the quotes and the
+ * skipped tag of smrt; previous_char is the byte before text */
+static void
+smartypants_convert(hoedown_buffer *ob, const uint8_t *text, size_t size, smartypants_data *smrt, uint8_t previous_char)
 {
-	size_t i;
-	struct smartypants_data smrt = {0, 0};
+	size_t i = 0;
 
-	if (!text)
-		return;
+	/* the rest of a skipped tag left open before */
+	if (smrt->skip_tag) {
+		i = skipped_end(text, size, 0, smrt->skip_tag - 1);
+		if (i < size) {
+			smrt->skip_tag = 0;
+			i++;
+		}
 
-	hoedown_buffer_grow(ob, size);
+		hoedown_buffer_put(ob, text, i);
+	}
 
-	for (i = 0; i < size; ++i) {
+	for (; i < size; ++i) {
 		size_t org;
-		uint8_t action = 0;
 
 		org = i;
-		while (i < size && (action = smartypants_cb_chars[text[i]]) == 0)
-			i++;
+		i += skip_plain(text + i, size - i);
 
 		if (i > org)
 			hoedown_buffer_put(ob, text + org, i - org);
 
 		if (i < size) {
-			i += smartypants_cb_ptrs[(int)action]
-				(ob, &smrt, i ? text[i - 1] : 0, text + i, size - i);
+			i += smartypants_cb_ptrs[smartypants_cb_chars[text[i]]]
+				(ob, smrt, i ? text[i - 1] : previous_char, text + i, size - i);
+		}
+	}
+}
+
+void
+hoedown_html_smartypants(hoedown_buffer *ob, const uint8_t *text, size_t size)
+{
+	smartypants_data smrt = {0};
+
+	if (!text)
+		return;
+
+	/* entities are a little longer than the chars they replace */
+	hoedown_buffer_grow(ob, ob->size + size + (size >> 4));
+
+	smartypants_convert(ob, text, size, &smrt, 0);
+}
+
+/* smartypants_pending • makes what is written to ob next part of the text
+ * to convert, after the one left elsewhere is converted */
+static void
+smartypants_pending(hoedown_buffer *ob, smartypants_data *smrt)
+{
+	if (smrt->ob != ob) {
+		hoedown_html_smartypants_flush(smrt);
+		smrt->ob = ob;
+		smrt->start = ob->size;
+	}
+}
+
+void
+hoedown_html_smartypants_text(hoedown_buffer *ob, const uint8_t *text, size_t size, hoedown_html_smartypants_data *smrt)
+{
+	if (!size)
+		return;
+
+	smartypants_pending(ob, smrt);
+	hoedown_escape_html(ob, text, size, 0);
+}
+
+void
+hoedown_html_smartypants_html(hoedown_buffer *ob, const uint8_t *text, size_t size, hoedown_html_smartypants_data *smrt)
+{
+	if (!size)
+		return;
+
+	smartypants_pending(ob, smrt);
+	hoedown_buffer_put(ob, text, size);
+}
+
+void
+hoedown_html_smartypants_flush(hoedown_html_smartypants_data *smrt)
+{
+	hoedown_buffer *ob = smrt->ob, *work = NULL;
+	uint8_t small[256];
+	const uint8_t *copy = small;
+	size_t start, size;
+
+	if (!ob)
+		return;
+
+	smrt->ob = NULL;
+
+	/* an autolink may have taken back some of it as it is in the source */
+	start = smrt->start < ob->size ? smrt->start : ob->size;
+
+	/* only from the first byte to convert, unless a skipped tag may close */
+	if (!smrt->skip_tag)
+		start += skip_plain(ob->data + start, ob->size - start);
+
+	size = ob->size - start;
+	if (!size)
+		return;
+
+	if (size <= sizeof(small)) {
+		memcpy(small, ob->data + start, size);
+	} else {
+		work = hoedown_buffer_new(size);
+		if (!work)
+			return;
+		hoedown_buffer_put(work, ob->data + start, size);
+		copy = work->data;
+	}
+
+	ob->size = start;
+	smartypants_convert(ob, copy, size, smrt, start ? ob->data[start - 1] : 0);
+	hoedown_buffer_free(work);
+}
+
+void
+hoedown_html_smartypants_tag(const uint8_t *tag, size_t size, hoedown_html_smartypants_data *smrt)
+{
+	size_t i;
+
+	if (smrt->skip_tag) {
+		if (hoedown_html_is_tag(tag, size, skip_tags[smrt->skip_tag - 1]) == HOEDOWN_HTML_TAG_CLOSE)
+			smrt->skip_tag = 0;
+		return;
+	}
+
+	for (i = 0; i < SKIP_TAGS_COUNT; ++i) {
+		if (hoedown_html_is_tag(tag, size, skip_tags[i]) == HOEDOWN_HTML_TAG_OPEN) {
+			smrt->skip_tag = (int)i + 1;
+			return;
 		}
 	}
 }
@@ -13,6 +13,20 @@
 #define strncasecmp	_strnicmp
 #endif
 
+#if defined(__SSE2__) && defined(__GNUC__)
+#include <emmintrin.h>
+#define MARKDOWN_SSE2
+#endif
+
+#ifdef HOEDOWN_STATS
+#include <stddef.h>
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <x86intrin.h>
+#else
+#include <time.h>
+#endif
+#endif
+
 #define REF_TABLE_SIZE 8
 
 #define BUFFER_BLOCK 0
@@ -20,6 +34,16 @@
 
 #define HOEDOWN_LI_END 8	/* internal list flag */
 
+#define CANCEL_POLL_WORK 4096	/* work units between two polls of the cancel callback */
+#define OUTPUT_CHUNK 16384	/* output held before it is handed to the output callback */
+
+#define HTML_BLOCK_TAG_MAX 10	/* longest name in html_block_names.gperf */
+#define BLOCK_MEMO_TAGS 8
+#define BLOCK_MEMO_EXTS (HOEDOWN_EXT_BOUNDED | HOEDOWN_EXT_LAX_SPACING)
+
+#define MATCH_NL 1		/* a newline appears inside the pair */
+#define MATCH_RBRACKET 2	/* a ']' appears inside the pair */
+
 const char *hoedown_find_block_tag(const char *str, unsigned int len);
 
 /***************
@@ -59,6 +83,78 @@ struct footnote_list {
 	struct footnote_item *tail;
 };
 
+/* link_match: an opening '[' or '(' and the position of its closing pair */
+struct link_match {
+	size_t open;
+	size_t close;	/* 0 when the pair is never closed */
+	int flags;
+};
+
+/* match_list: pairs of one bracket type, sorted by opening position */
+struct match_list {
+	struct link_match *item;
+	size_t size;
+	size_t asize;
+	int ready;
+};
+
+/* char_runs: runs of one char in a span, with the longest run from each on */
+struct char_runs {
+	size_t *start;
+	size_t *end;
+	size_t *longest;
+	size_t size;
+	int ready;
+};
+
+/* inline_memo: look-ahead results shared by the triggers of one
+ * parse_inline call; only used with HOEDOWN_EXT_BOUNDED */
+struct inline_memo {
+	uint8_t *data;
+	size_t size;
+
+	uint8_t *emph_fail[4][3];	/* first opener without a closer, by delimiter and width */
+	uint8_t *sup_fail;			/* first '^(' without a ')' */
+
+	size_t last_gt;				/* end of the last '>', (size_t)-1 until known */
+	size_t last_rparen;			/* end of the last ')', (size_t)-1 until known */
+	size_t squote_from;			/* last space-quote search and its result */
+	size_t squote_at;
+
+	struct char_runs ticks;
+	struct char_runs quotes;
+	struct match_list brackets;
+	struct match_list parens;
+};
+
+/* block_probe: the block-start probes of a line, by parse_paragraph
+ * and then again by parse_block where the paragraph stops */
+enum block_probe {
+	BLOCK_PROBE_HTML,
+	BLOCK_PROBE_FENCE,
+	BLOCK_PROBE_OLI,
+	BLOCK_PROBE_ULI,
+	BLOCK_PROBES
+};
+
+/* block_memo: HTML block scans that failed in one parse_block call,
+ * and the probes of the last line; only used with BLOCK_MEMO_EXTS */
+struct block_memo {
+	uint8_t *data;
+	size_t size;
+
+	const char *tag[BLOCK_MEMO_TAGS];
+	uint8_t *tag_fail[BLOCK_MEMO_TAGS];
+	size_t tag_next;
+
+	uint8_t *comment_fail;
+	uint8_t *hr_fail;
+
+	uint8_t *probe_at;			/* line of the probes below */
+	unsigned int probe_known;	/* 1 << BLOCK_PROBE_* of the probes run there */
+	size_t probe[BLOCK_PROBES];
+};
+
 /* char_trigger: function pointer to render active chars */
 /*   returns the number of chars taken care of */
 /*   data is the pointer of the beginning of the span */
@@ -111,6 +207,24 @@ static char_trigger markdown_char_ptrs[] = {
 	&char_quote
 };
 
+/* work_buf - a pooled work buffer, with its size when taken */
+struct work_buf {
+	hoedown_buffer buf;	/* first, freed as a hoedown_buffer */
+	size_t taken;		/* asize when taken, then when given back */
+};
+
+/* render_usage - memory of a render, as the parser sees its buffers */
+/*	buffers are looked at when work buffers are given back, so growths in
+ *	between count as one */
+struct render_usage {
+	size_t allocated;	/* bytes obtained, growths counting what they added */
+	size_t held;		/* bytes held when last looked */
+	size_t peak;		/* most bytes held at once */
+	size_t reallocs;	/* growths of the buffers */
+	size_t ob_asize;	/* allocated size of the output when last looked */
+	size_t text_asize;	/* same for the copy of the document */
+};
+
 /* render • structure containing state for a parser instance */
 struct hoedown_markdown {
 	hoedown_renderer md;
@@ -123,35 +237,384 @@ struct hoedown_markdown {
 	unsigned int ext_flags;
 	size_t max_nesting;
 	int in_link_body;
+
+	struct inline_memo *inline_memo;
+	struct block_memo *block_memo;
+
+	size_t work;
+	size_t max_work;
+	size_t next_poll;
+	int (*cancel)(void *data);
+	void *cancel_data;
+	int status;
+
+	int (*output)(const uint8_t *data, size_t size, void *opaque);
+	void *output_data;
+	hoedown_buffer *output_ob;	/* the top level output, while rendering */
+
+	size_t in_place;
+
+	hoedown_renderer toc;	/* renders the headers again into toc_ob */
+	uint8_t toc_active_char[256];
+	hoedown_buffer *toc_ob;	/* NULL without a toc */
+	int in_toc;		/* toc and md are swapped, parsing a header for toc */
+
+	hoedown_block_cache *block_cache;
+	uint8_t *block_src;	/* the top level text before parsing, while it is cached */
+	int block_deps;		/* set when a block may render differently elsewhere */
+
+	struct render_usage usage;	/* of the render going on */
+	hoedown_buffer *render_text;	/* the copy of the document, while rendering */
+	hoedown_buffer *render_ob;	/* the output of the render going on */
+	hoedown_render_memory memory;	/* of the last render */
+	size_t retain_bufs;		/* work buffers kept per pool after a render */
+	size_t retain_capacity;	/* bytes kept per work buffer */
+
+#ifdef HOEDOWN_STATS
+	hoedown_renderer stats_renderer;	/* the callbacks wrapped by md->md */
+	hoedown_stats stats;
+#endif
 };
 
 /***************************
  * HELPER FUNCTIONS *
  ***************************/
 
+/* usage_add • accounts for bytes taken during the render */
+static void
+usage_add(hoedown_markdown *md, size_t bytes)
+{
+	md->usage.allocated += bytes;
+	md->usage.held += bytes;
+	if (md->usage.held > md->usage.peak)
+		md->usage.peak = md->usage.held;
+}
+
+/* usage_sub • accounts for bytes given back */
+static void
+usage_sub(hoedown_markdown *md, size_t bytes)
+{
+	md->usage.held = md->usage.held > bytes ? md->usage.held - bytes : 0;
+}
+
+/* usage_grown • accounts for a buffer grown from *seen bytes to asize */
+static inline void
+usage_grown(hoedown_markdown *md, size_t *seen, size_t asize)
+{
+	if (asize > *seen) {
+		usage_add(md, asize - *seen);
+		md->usage.reallocs++;
+		*seen = asize;
+	}
+}
+
+/* usage_seen • accounts for work_buf and for what the output and the copy
+ * of the document grew by since last seen */
+static inline void
+usage_seen(hoedown_markdown *md, struct work_buf *work)
+{
+	usage_grown(md, &work->taken, work->buf.asize);
+	if (md->render_ob)
+		usage_grown(md, &md->usage.ob_asize, md->render_ob->asize);
+	if (md->render_text)
+		usage_grown(md, &md->usage.text_asize, md->render_text->asize);
+}
+
 static inline hoedown_buffer *
 newbuf(hoedown_markdown *md, int type)
 {
 	static const size_t buf_size[2] = {256, 64};
-	hoedown_buffer *work = NULL;
+	struct work_buf *work = NULL;
 	hoedown_stack *pool = &md->work_bufs[type];
 
 	if (pool->size < pool->asize &&
 		pool->item[pool->size] != NULL) {
 		work = pool->item[pool->size++];
-		work->size = 0;
+		work->buf.size = 0;
 	} else {
-		work = hoedown_buffer_new(buf_size[type]);
+		work = malloc(sizeof(struct work_buf));
+		if (work) {
+			work->buf.data = NULL;
+			work->buf.size = work->buf.asize = 0;
+			work->buf.unit = buf_size[type];
+			usage_add(md, sizeof(struct work_buf));
+		}
 		hoedown_stack_push(pool, work);
 	}
 
-	return work;
+	if (!work)
+		return NULL;
+
+	work->taken = work->buf.asize;
+	return &work->buf;
 }
 
 static inline void
 popbuf(hoedown_markdown *md, int type)
 {
-	md->work_bufs[type].size--;
+	hoedown_stack *pool = &md->work_bufs[type];
+
+	usage_seen(md, pool->item[--pool->size]);
+}
+
+/* trim_pool • frees the buffers of an idle pool past max_bufs, shrinking
+ * the others to max_capacity */
+static void
+trim_pool(hoedown_markdown *md, hoedown_stack *pool, size_t max_bufs, size_t max_capacity)
+{
+	hoedown_buffer *work;
+	uint8_t *data;
+	size_t i;
+
+	assert(pool->size == 0);
+
+	for (i = 0; i < pool->asize && pool->item[i]; ++i) {
+		work = pool->item[i];
+
+		if (i >= max_bufs) {
+			usage_sub(md, sizeof(struct work_buf) + work->asize);
+			hoedown_buffer_free(work);
+			pool->item[i] = NULL;
+		} else if (work->asize > max_capacity) {
+			if (max_capacity == 0) {
+				usage_sub(md, work->asize);
+				hoedown_buffer_reset(work);
+				continue;
+			}
+
+			data = realloc(work->data, max_capacity);
+			if (!data)
+				continue;
+
+			usage_sub(md, work->asize - max_capacity);
+			work->data = data;
+			work->asize = max_capacity;
+			work->size = 0;
+		}
+	}
+}
+
+/* nesting • depth of the containers being rendered */
+static inline size_t
+nesting(hoedown_markdown *md)
+{
+	return md->work_bufs[BUFFER_SPAN].size + md->work_bufs[BUFFER_BLOCK].size + md->in_place;
+}
+
+/****************************
+ * INSTRUMENTATION *
+ ****************************/
+
+#ifdef HOEDOWN_STATS
+
+/* stats_clock • current time stamp */
+static inline uint64_t
+stats_clock(void)
+{
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+	return __rdtsc();
+#else
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+#endif
+}
+
+/* stats_add • counts a call that started at start, returning bytes */
+static inline size_t
+stats_add(struct hoedown_stats_counter *counter, uint64_t start, size_t bytes)
+{
+	counter->calls++;
+	counter->bytes += bytes;
+	counter->cycles += stats_clock() - start;
+	return bytes;
+}
+
+/* STATS: counts call, an expression giving the bytes it parsed */
+#define STATS_DECL uint64_t stats_start;
+#define STATS(md, group, kind, call) \
+	(stats_start = stats_clock(), stats_add(&(md)->stats.group[kind], stats_start, (call)))
+#define STATS_START() (stats_start = stats_clock())
+#define STATS_STOP(md, group, kind, bytes) \
+	((void)stats_add(&(md)->stats.group[kind], stats_start, (bytes)))
+
+/* callbacks are wrapped into functions timing them, md being their opaque */
+#define STATS_INDEX(name) \
+	(offsetof(hoedown_renderer, name) / sizeof(void (*)(void)) - \
+	 (offsetof(hoedown_renderer, name) > offsetof(hoedown_renderer, opaque)))
+
+#define STATS_VOID_CALLBACK(name, params, args) \
+static void \
+stats_##name params \
+{ \
+	hoedown_markdown *md = opaque; \
+	uint64_t start = stats_clock(); \
+	size_t size = ob->size; \
+	md->stats_renderer.name args; \
+	stats_add(&md->stats.callback[STATS_INDEX(name)], start, ob->size > size ? ob->size - size : 0); \
+}
+
+#define STATS_INT_CALLBACK(name, params, args) \
+static int \
+stats_##name params \
+{ \
+	hoedown_markdown *md = opaque; \
+	uint64_t start = stats_clock(); \
+	size_t size = ob->size; \
+	int ret = md->stats_renderer.name args; \
+	stats_add(&md->stats.callback[STATS_INDEX(name)], start, ob->size > size ? ob->size - size : 0); \
+	return ret; \
+}
+
+#define OPAQUE md->stats_renderer.opaque
+typedef const hoedown_buffer cbuf;
+
+STATS_VOID_CALLBACK(blockcode, (hoedown_buffer *ob, cbuf *text, cbuf *lang, void *opaque), (ob, text, lang, OPAQUE))
+STATS_VOID_CALLBACK(blockquote, (hoedown_buffer *ob, cbuf *text, void *opaque), (ob, text, OPAQUE))
+STATS_VOID_CALLBACK(blockhtml, (hoedown_buffer *ob, cbuf *text, void *opaque), (ob, text, OPAQUE))
+STATS_VOID_CALLBACK(header, (hoedown_buffer *ob, cbuf *text, int level, void *opaque), (ob, text, level, OPAQUE))
+STATS_VOID_CALLBACK(hrule, (hoedown_buffer *ob, void *opaque), (ob, OPAQUE))
+STATS_VOID_CALLBACK(list, (hoedown_buffer *ob, cbuf *text, int flags, void *opaque), (ob, text, flags, OPAQUE))
+STATS_VOID_CALLBACK(listitem, (hoedown_buffer *ob, cbuf *text, int flags, void *opaque), (ob, text, flags, OPAQUE))
+STATS_VOID_CALLBACK(paragraph, (hoedown_buffer *ob, cbuf *text, void *opaque), (ob, text, OPAQUE))
+STATS_VOID_CALLBACK(table, (hoedown_buffer *ob, cbuf *header, cbuf *body, void *opaque), (ob, header, body, OPAQUE))
+STATS_VOID_CALLBACK(table_row, (hoedown_buffer *ob, cbuf *text, void *opaque), (ob, text, OPAQUE))
+STATS_VOID_CALLBACK(table_cell, (hoedown_buffer *ob, cbuf *text, int flags, void *opaque), (ob, text, flags, OPAQUE))
+STATS_VOID_CALLBACK(footnotes, (hoedown_buffer *ob, cbuf *text, void *opaque), (ob, text, OPAQUE))
+STATS_VOID_CALLBACK(footnote_def, (hoedown_buffer *ob, cbuf *text, unsigned int num, void *opaque), (ob, text, num, OPAQUE))
+STATS_INT_CALLBACK(autolink, (hoedown_buffer *ob, cbuf *link, enum hoedown_autolink type, void *opaque), (ob, link, type, OPAQUE))
+STATS_INT_CALLBACK(codespan, (hoedown_buffer *ob, cbuf *text, void *opaque), (ob, text, OPAQUE))
+STATS_INT_CALLBACK(double_emphasis, (hoedown_buffer *ob, cbuf *text, void *opaque), (ob, text, OPAQUE))
+STATS_INT_CALLBACK(emphasis, (hoedown_buffer *ob, cbuf *text, void *opaque), (ob, text, OPAQUE))
+STATS_INT_CALLBACK(underline, (hoedown_buffer *ob, cbuf *text, void *opaque), (ob, text, OPAQUE))
+STATS_INT_CALLBACK(highlight, (hoedown_buffer *ob, cbuf *text, void *opaque), (ob, text, OPAQUE))
+STATS_INT_CALLBACK(quote, (hoedown_buffer *ob, cbuf *text, void *opaque), (ob, text, OPAQUE))
+STATS_INT_CALLBACK(image, (hoedown_buffer *ob, cbuf *link, cbuf *title, cbuf *alt, void *opaque), (ob, link, title, alt, OPAQUE))
+STATS_INT_CALLBACK(linebreak, (hoedown_buffer *ob, void *opaque), (ob, OPAQUE))
+STATS_INT_CALLBACK(link, (hoedown_buffer *ob, cbuf *link, cbuf *title, cbuf *content, void *opaque), (ob, link, title, content, OPAQUE))
+STATS_INT_CALLBACK(raw_html_tag, (hoedown_buffer *ob, cbuf *tag, void *opaque), (ob, tag, OPAQUE))
+STATS_INT_CALLBACK(triple_emphasis, (hoedown_buffer *ob, cbuf *text, void *opaque), (ob, text, OPAQUE))
+STATS_INT_CALLBACK(strikethrough, (hoedown_buffer *ob, cbuf *text, void *opaque), (ob, text, OPAQUE))
+STATS_INT_CALLBACK(superscript, (hoedown_buffer *ob, cbuf *text, void *opaque), (ob, text, OPAQUE))
+STATS_INT_CALLBACK(footnote_ref, (hoedown_buffer *ob, unsigned int num, void *opaque), (ob, num, OPAQUE))
+STATS_VOID_CALLBACK(entity, (hoedown_buffer *ob, cbuf *entity, void *opaque), (ob, entity, OPAQUE))
+STATS_VOID_CALLBACK(normal_text, (hoedown_buffer *ob, cbuf *text, void *opaque), (ob, text, OPAQUE))
+STATS_VOID_CALLBACK(doc_header, (hoedown_buffer *ob, void *opaque), (ob, OPAQUE))
+STATS_VOID_CALLBACK(doc_footer, (hoedown_buffer *ob, void *opaque), (ob, OPAQUE))
+STATS_VOID_CALLBACK(container_enter, (hoedown_buffer *ob, enum hoedown_container type, int flags, void *opaque), (ob, type, flags, OPAQUE))
+STATS_VOID_CALLBACK(container_leave, (hoedown_buffer *ob, enum hoedown_container type, int flags, size_t content, void *opaque), (ob, type, flags, content, OPAQUE))
+
+#undef OPAQUE
+
+#define STATS_WRAP(md, name) \
+	if ((md)->md.name) (md)->md.name = stats_##name
+
+/* stats_wrap • puts the timing functions in front of the callbacks of md */
+static void
+stats_wrap(hoedown_markdown *md)
+{
+	memset(&md->stats, 0, sizeof(md->stats));
+	md->stats_renderer = md->md;
+
+	STATS_WRAP(md, blockcode);
+	STATS_WRAP(md, blockquote);
+	STATS_WRAP(md, blockhtml);
+	STATS_WRAP(md, header);
+	STATS_WRAP(md, hrule);
+	STATS_WRAP(md, list);
+	STATS_WRAP(md, listitem);
+	STATS_WRAP(md, paragraph);
+	STATS_WRAP(md, table);
+	STATS_WRAP(md, table_row);
+	STATS_WRAP(md, table_cell);
+	STATS_WRAP(md, footnotes);
+	STATS_WRAP(md, footnote_def);
+	STATS_WRAP(md, autolink);
+	STATS_WRAP(md, codespan);
+	STATS_WRAP(md, double_emphasis);
+	STATS_WRAP(md, emphasis);
+	STATS_WRAP(md, underline);
+	STATS_WRAP(md, highlight);
+	STATS_WRAP(md, quote);
+	STATS_WRAP(md, image);
+	STATS_WRAP(md, linebreak);
+	STATS_WRAP(md, link);
+	STATS_WRAP(md, raw_html_tag);
+	STATS_WRAP(md, triple_emphasis);
+	STATS_WRAP(md, strikethrough);
+	STATS_WRAP(md, superscript);
+	STATS_WRAP(md, footnote_ref);
+	STATS_WRAP(md, entity);
+	STATS_WRAP(md, normal_text);
+	STATS_WRAP(md, doc_header);
+	STATS_WRAP(md, doc_footer);
+	STATS_WRAP(md, container_enter);
+	STATS_WRAP(md, container_leave);
+	md->md.opaque = md;
+}
+
+#else
+
+#define STATS_DECL
+#define STATS(md, group, kind, call) (call)
+#define STATS_START() ((void)0)
+#define STATS_STOP(md, group, kind, bytes) ((void)0)
+
+#endif
+
+/* flush_output • hands the output over to the output callback, when ob is
+ * the top level one with in_place containers open, returning the bytes
+ * taken out of ob */
+static size_t
+flush_output(hoedown_buffer *ob, hoedown_markdown *md, size_t in_place)
+{
+	size_t keep;
+
+	if (!md->output || ob != md->output_ob || ob->size < OUTPUT_CHUNK ||
+		nesting(md) != in_place || md->block_src ||
+		md->status != HOEDOWN_RENDER_OK)
+		return 0;
+
+	/* the last character stays, for renderers to look back at */
+	keep = ob->size - 1;
+	while (keep > 0 && (ob->data[keep] & 0xC0) == 0x80)
+		keep--;
+
+	if (keep == 0)
+		return 0;
+
+	if (md->output(ob->data, keep, md->output_data)) {
+		md->status = HOEDOWN_RENDER_CANCELLED;
+		md->output_ob = NULL;
+		return 0;
+	}
+
+	memmove(ob->data, ob->data + keep, ob->size - keep);
+	ob->size -= keep;
+	return keep;
+}
+
+/* enter_container • opens a container in place unless it has a callback */
+/*	returns 0 when the container has to be rendered into a work buffer */
+static int
+enter_container(hoedown_buffer *ob, hoedown_markdown *md, int has_callback, enum hoedown_container type, int flags, size_t *content)
+{
+	*content = 0;
+	if (has_callback || !md->md.container_enter || !md->md.container_leave)
+		return 0;
+
+	md->md.container_enter(ob, type, flags, md->md.opaque);
+	md->in_place++;
+	*content = ob->size;
+	return 1;
+}
+
+/* leave_container • closes a container opened by enter_container */
+static void
+leave_container(hoedown_buffer *ob, hoedown_markdown *md, enum hoedown_container type, int flags, size_t content)
+{
+	md->in_place--;
+	md->md.container_leave(ob, type, flags, content, md->md.opaque);
 }
 
 static void
@@ -295,37 +758,460 @@ free_footnote_ref(struct footnote_ref *ref)
 	free(ref);
 }
 
-static void
-free_footnote_list(struct footnote_list *list, int free_refs)
+static void
+free_footnote_list(struct footnote_list *list, int free_refs)
+{
+	struct footnote_item *item = list->head;
+	struct footnote_item *next;
+	
+	while (item) {
+		next = item->next;
+		if (free_refs)
+			free_footnote_ref(item->ref);
+		free(item);
+		item = next;
+	}
+}
+
+
+/*
+ * Check whether a char is a Markdown space.
+
+ * Right now we only consider spaces the actual
+ * space and a newline: tabs and carriage returns
+ * are filtered out during the preprocessing phase.
+ *
+ * If we wanted to actually be UTF-8 compliant, we
+ * should instead extract an Unicode codepoint from
+ * this character and check for space properties.
+ */
+static inline int
+_isspace(int c)
+{
+	return c == ' ' || c == '\n';
+}
+
+/***************************
+ * BOUNDED PARSING HELPERS *
+ ***************************/
+
+/* The helpers below back HOEDOWN_EXT_BOUNDED. Every look-ahead scan that
+ * can run to the end of the current span or block records its failure in
+ * a memo owned by the innermost parse_inline or parse_block call, so the
+ * next opener of the same kind gives up at once instead of scanning the
+ * same bytes again. Bracket pairs are matched in a single pass.
+ *
+ * The block memo also serves HOEDOWN_EXT_LAX_SPACING, where parse_paragraph
+ * probes every line for the start of a block: the HTML block failures are
+ * shared by the lines of the paragraph, and the probes of the line where it
+ * stops are kept for parse_block, which starts the next block there. */
+
+static void
+inline_memo_init(struct inline_memo *memo, uint8_t *data, size_t size)
+{
+	memset(memo, 0x0, sizeof(struct inline_memo));
+	memo->data = data;
+	memo->size = size;
+	memo->last_gt = (size_t)-1;
+	memo->last_rparen = (size_t)-1;
+	memo->squote_from = (size_t)-1;
+}
+
+static void
+inline_memo_free(struct inline_memo *memo)
+{
+	free(memo->ticks.start);
+	free(memo->quotes.start);
+	free(memo->brackets.item);
+	free(memo->parens.item);
+}
+
+/* inline_memo_get • returns the memo when the span ends where the memo's does */
+static inline struct inline_memo *
+inline_memo_get(hoedown_markdown *md, uint8_t *data, size_t size)
+{
+	struct inline_memo *memo = md->inline_memo;
+
+	if (memo && data + size == memo->data + memo->size)
+		return memo;
+
+	return NULL;
+}
+
+static inline int
+emph_index(uint8_t c)
+{
+	switch (c) {
+	case '*': return 0;
+	case '_': return 1;
+	case '~': return 2;
+	default: return 3;
+	}
+}
+
+/* emph_failed • whether a closer search for this delimiter already failed earlier */
+static inline int
+emph_failed(struct inline_memo *memo, uint8_t *data, uint8_t c, int width)
+{
+	uint8_t *fail;
+
+	if (!memo)
+		return 0;
+
+	fail = memo->emph_fail[emph_index(c)][width - 1];
+	return fail && data >= fail;
+}
+
+/* emph_fail • records a failed closer search, always returns 0 */
+static size_t
+emph_fail(struct inline_memo *memo, uint8_t *data, uint8_t c, int width)
+{
+	uint8_t **fail;
+
+	if (memo) {
+		fail = &memo->emph_fail[emph_index(c)][width - 1];
+		if (!*fail || data < *fail)
+			*fail = data;
+	}
+
+	return 0;
+}
+
+/* memo_char_after • whether 'c' appears in the memo's span at or after 'from' */
+static int
+memo_char_after(struct inline_memo *memo, size_t *last, uint8_t c, size_t from)
+{
+	if (*last == (size_t)-1) {
+		size_t i = memo->size;
+
+		while (i > 0 && memo->data[i - 1] != c)
+			i--;
+
+		*last = i;
+	}
+
+	return *last > from;
+}
+
+/* find_runs • collects the runs of 'c' in a span */
+static void
+find_runs(struct char_runs *runs, uint8_t *data, size_t size, uint8_t c)
+{
+	size_t i, count = 0, longest = 0;
+
+	runs->ready = 1;
+
+	for (i = 0; i < size; ++i) {
+		if (data[i] == c && (i == 0 || data[i - 1] != c))
+			count++;
+	}
+
+	if (!count)
+		return;
+
+	/* one allocation holds the three arrays */
+	runs->start = malloc(3 * count * sizeof(size_t));
+	if (!runs->start)
+		return;
+
+	runs->end = runs->start + count;
+	runs->longest = runs->end + count;
+	runs->size = count;
+
+	i = size;
+	while (count) {
+		size_t end;
+
+		while (data[i - 1] != c)
+			i--;
+
+		end = i;
+		while (i > 0 && data[i - 1] == c)
+			i--;
+
+		count--;
+		if (end - i > longest)
+			longest = end - i;
+
+		runs->start[count] = i;
+		runs->end[count] = end;
+		runs->longest[count] = longest;
+	}
+}
+
+/* find_run • index of the first run starting at or after 'from' */
+static size_t
+find_run(struct inline_memo *memo, struct char_runs *runs, uint8_t c, size_t from)
+{
+	size_t lo = 0, hi;
+
+	if (!runs->ready)
+		find_runs(runs, memo->data, memo->size, c);
+
+	hi = runs->size;
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo) / 2;
+
+		if (runs->start[mid] < from)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	return lo;
+}
+
+/* memo_run_length • length of the run of 'c' starting at 'at', 0 if unknown */
+static size_t
+memo_run_length(struct inline_memo *memo, struct char_runs *runs, uint8_t c, size_t at)
+{
+	size_t run = find_run(memo, runs, c, at);
+
+	/* 'at' may also fall inside the previous run */
+	if (run < runs->size && runs->start[run] == at)
+		return runs->end[run] - at;
+
+	if (run > 0 && runs->end[run - 1] > at)
+		return runs->end[run - 1] - at;
+
+	return 0;
+}
+
+/* memo_longest_run • longest run of 'c' starting at or after 'from' */
+static size_t
+memo_longest_run(struct inline_memo *memo, struct char_runs *runs, uint8_t c, size_t from)
+{
+	size_t run = find_run(memo, runs, c, from);
+
+	/* a failed allocation leaves no runs: never claim a failure then */
+	if (!runs->start)
+		return (size_t)-1;
+
+	return run < runs->size ? runs->longest[run] : 0;
+}
+
+/* memo_space_quote • position of the first quote preceded by whitespace */
+static size_t
+memo_space_quote(struct inline_memo *memo, size_t from)
+{
+	size_t i;
+
+	if (memo->squote_from <= from && from <= memo->squote_at)
+		return memo->squote_at;
+
+	for (i = from ? from : 1; i < memo->size; ++i) {
+		if ((memo->data[i] == '\'' || memo->data[i] == '"') &&
+			_isspace(memo->data[i - 1]))
+			break;
+	}
+
+	if (i > memo->size)
+		i = memo->size;
+
+	memo->squote_from = from;
+	memo->squote_at = i;
+	return i;
+}
+
+static struct link_match *
+match_add(struct match_list *list, size_t open)
+{
+	struct link_match *item;
+
+	if (list->size == list->asize) {
+		size_t asize = list->asize ? list->asize * 2 : 16;
+
+		item = realloc(list->item, asize * sizeof(struct link_match));
+		if (!item)
+			return NULL;
+
+		list->item = item;
+		list->asize = asize;
+	}
+
+	item = &list->item[list->size++];
+	item->open = open;
+	item->close = 0;
+	item->flags = 0;
+	return item;
+}
+
+/* push_index • grows a stack of positions as needed */
+static int
+push_index(size_t **stack, size_t *size, size_t *asize, size_t value)
+{
+	if (*size == *asize) {
+		size_t new_asize = *asize ? *asize * 2 : 16;
+		size_t *new_stack = realloc(*stack, new_asize * sizeof(size_t));
+
+		if (!new_stack)
+			return 0;
+
+		*stack = new_stack;
+		*asize = new_asize;
+	}
+
+	(*stack)[(*size)++] = value;
+	return 1;
+}
+
+/* close_match • records the closing char of a pair */
+static void
+close_match(struct link_match *m, size_t close, size_t last_nl, size_t last_rb)
+{
+	m->close = close;
+	if (last_nl > m->open)
+		m->flags |= MATCH_NL;
+	if (last_rb > m->open + 1)
+		m->flags |= MATCH_RBRACKET;
+}
+
+/* match_pairs • pairs every opening char of a span with its closing char */
+/*	brackets follow the escaping rule of char_link's text scan (a char
+ *	preceded by a backslash is skipped), parens follow the rule of its
+ *	link scan (a backslash skips the next char). An escaped '[' can still
+ *	open a link: it waits for the first ']' seen at the nesting depth it
+ *	was found at. */
+static void
+match_pairs(struct match_list *list, uint8_t *data, size_t size, uint8_t open, uint8_t close)
+{
+	size_t *stack = NULL, depth = 0, stack_asize = 0;
+	size_t *wait = NULL, wait_size = 0, wait_asize = 0;
+	size_t i, last_nl = 0, last_rb = 0;
+
+	list->ready = 1;
+
+	for (i = 0; i < size; ++i) {
+		size_t nl = last_nl, rb = last_rb;
+
+		if (data[i] == '\n')
+			last_nl = i + 1;
+		else if (data[i] == ']')
+			last_rb = i + 1;
+
+		if (open == '(' && data[i] == '\\') {
+			i++;
+			continue;
+		}
+
+		if (open == '[' && i > 0 && data[i - 1] == '\\') {
+			if (data[i] == open) {
+				if (!match_add(list, i) ||
+					!push_index(&wait, &wait_size, &wait_asize, list->size - 1) ||
+					!push_index(&wait, &wait_size, &wait_asize, depth))
+					break;
+			}
+			continue;
+		}
+
+		if (data[i] == open) {
+			if (!match_add(list, i) ||
+				!push_index(&stack, &depth, &stack_asize, list->size - 1))
+				break;
+		}
+		else if (data[i] == close) {
+			while (wait_size && wait[wait_size - 1] == depth) {
+				close_match(&list->item[wait[wait_size - 2]], i, nl, rb);
+				wait_size -= 2;
+			}
+
+			if (depth)
+				close_match(&list->item[stack[--depth]], i, nl, rb);
+		}
+	}
+
+	/* an aborted pass must not be mistaken for unmatched openers */
+	if (i < size)
+		list->size = 0;
+
+	free(stack);
+	free(wait);
+}
+
+/* match_find • looks up the pair opened at the given position */
+static struct link_match *
+match_find(struct match_list *list, size_t open)
+{
+	size_t lo = 0, hi = list->size;
+
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo) / 2;
+
+		if (list->item[mid].open < open)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	if (lo < list->size && list->item[lo].open == open)
+		return &list->item[lo];
+
+	return NULL;
+}
+
+static void
+block_memo_init(struct block_memo *memo, uint8_t *data, size_t size)
+{
+	memset(memo, 0x0, sizeof(struct block_memo));
+	memo->data = data;
+	memo->size = size;
+}
+
+/* block_memo_get • returns the memo when the block ends where the memo's does */
+static inline struct block_memo *
+block_memo_get(hoedown_markdown *md, uint8_t *data, size_t size)
+{
+	struct block_memo *memo = md->block_memo;
+
+	if (memo && data + size == memo->data + memo->size)
+		return memo;
+
+	return NULL;
+}
+
+/* block_memo_tag • slot holding the failure of the given block tag */
+static uint8_t **
+block_memo_tag(struct block_memo *memo, const char *tag, int add)
+{
+	size_t i;
+
+	for (i = 0; i < BLOCK_MEMO_TAGS; ++i) {
+		if (memo->tag[i] == tag)
+			return &memo->tag_fail[i];
+	}
+
+	if (!add)
+		return NULL;
+
+	i = memo->tag_next++ % BLOCK_MEMO_TAGS;
+	memo->tag[i] = tag;
+	memo->tag_fail[i] = NULL;
+	return &memo->tag_fail[i];
+}
+
+/* add_work • accounts for parsing work, returns 0 once the render must stop */
+static int
+add_work(hoedown_markdown *md, size_t units)
 {
-	struct footnote_item *item = list->head;
-	struct footnote_item *next;
-	
-	while (item) {
-		next = item->next;
-		if (free_refs)
-			free_footnote_ref(item->ref);
-		free(item);
-		item = next;
-	}
-}
+	if (md->status != HOEDOWN_RENDER_OK)
+		return 0;
 
+	md->work += units;
 
-/*
- * Check whether a char is a Markdown space.
+	if (md->max_work && md->work > md->max_work) {
+		md->status = HOEDOWN_RENDER_BUDGET_EXCEEDED;
+		return 0;
+	}
 
- * Right now we only consider spaces the actual
- * space and a newline: tabs and carriage returns
- * are filtered out during the preprocessing phase.
- *
- * If we wanted to actually be UTF-8 compliant, we
- * should instead extract an Unicode codepoint from
- * this character and check for space properties.
- */
-static inline int
-_isspace(int c)
-{
-	return c == ' ' || c == '\n';
+	if (md->cancel && md->work >= md->next_poll) {
+		md->next_poll = md->work + CANCEL_POLL_WORK;
+		if (md->cancel(md->cancel_data)) {
+			md->status = HOEDOWN_RENDER_CANCELLED;
+			return 0;
+		}
+	}
+
+	return 1;
 }
 
 /****************************
@@ -426,6 +1312,37 @@ tag_length(uint8_t *data, size_t size, enum hoedown_autolink *autolink)
 	return i + 1;
 }
 
+/* autolink_candidate • whether an autolink trigger may start a link */
+/*	the first checks of hoedown_autolink__url, __email and __www, made in
+ *	place: ':' and 'w' are common in prose, and a trigger that fails splits
+ *	the text and costs a work buffer */
+static inline int
+autolink_candidate(const uint8_t *data, size_t max_rewind, size_t size, uint8_t action)
+{
+	uint8_t c;
+
+	switch (action) {
+	case MD_CHAR_AUTOLINK_URL:
+		return size >= 4 && data[1] == '/' && data[2] == '/';
+
+	case MD_CHAR_AUTOLINK_EMAIL:
+		if (!max_rewind || size < 2)
+			return 0;
+		c = data[-1];
+		if (!isalnum(c) && c != '.' && c != '+' && c != '-' && c != '_')
+			return 0;
+		c = data[1];
+		return isalnum(c) || c == '.' || c == '-' || c == '_';
+
+	case MD_CHAR_AUTOLINK_WWW:
+		if (max_rewind && !ispunct(data[-1]) && !isspace(data[-1]))
+			return 0;
+		return size >= 4 && data[1] == 'w' && data[2] == 'w' && data[3] == '.';
+	}
+
+	return 1;
+}
+
 /* parse_inline • parses inline markdown elements */
 static void
 parse_inline(hoedown_buffer *ob, hoedown_markdown *md, uint8_t *data, size_t size)
@@ -433,17 +1350,37 @@ parse_inline(hoedown_buffer *ob, hoedown_markdown *md, uint8_t *data, size_t siz
 	size_t i = 0, end = 0;
 	uint8_t action = 0;
 	hoedown_buffer work = { 0, 0, 0, 0 };
+	struct inline_memo memo, *parent_memo = md->inline_memo;
+	STATS_DECL
+
+	if (nesting(md) > md->max_nesting)
+		return;
 
-	if (md->work_bufs[BUFFER_SPAN].size +
-		md->work_bufs[BUFFER_BLOCK].size > md->max_nesting)
+	if (!add_work(md, size))
 		return;
 
+	STATS_START();
+
+	if (md->ext_flags & HOEDOWN_EXT_BOUNDED) {
+		inline_memo_init(&memo, data, size);
+		md->inline_memo = &memo;
+	}
+
 	while (i < size) {
-		/* copying inactive chars into the output */
+		/* copying inactive chars into the output, with the autolink
+		 * triggers that cannot start a link */
 		while (end < size && (action = md->active_char[data[end]]) == 0) {
 			end++;
 		}
 
+		while (end < size && action >= MD_CHAR_AUTOLINK_URL && action <= MD_CHAR_AUTOLINK_WWW &&
+			!autolink_candidate(data + end, end, size - end, action)) {
+			end++;
+			while (end < size && (action = md->active_char[data[end]]) == 0) {
+				end++;
+			}
+		}
+
 		if (md->md.normal_text) {
 			work.data = data + i;
 			work.size = end - i;
@@ -452,10 +1389,10 @@ parse_inline(hoedown_buffer *ob, hoedown_markdown *md, uint8_t *data, size_t siz
 		else
 			hoedown_buffer_put(ob, data + i, end - i);
 
-		if (end >= size) break;
+		if (end >= size || !add_work(md, 1)) break;
 		i = end;
 
-		end = markdown_char_ptrs[(int)action](ob, md, data + i, i, size - i);
+		end = STATS(md, span, action - 1, markdown_char_ptrs[(int)action](ob, md, data + i, i, size - i));
 		if (!end) /* no action from the callback */
 			end = i + 1;
 		else {
@@ -463,6 +1400,13 @@ parse_inline(hoedown_buffer *ob, hoedown_markdown *md, uint8_t *data, size_t siz
 			end = i;
 		}
 	}
+
+	if (md->ext_flags & HOEDOWN_EXT_BOUNDED) {
+		inline_memo_free(&memo);
+		md->inline_memo = parent_memo;
+	}
+
+	STATS_STOP(md, block, HOEDOWN_STATS_INLINE, size);
 }
 
 /* find_emph_char • looks for the next emph uint8_t, skipping other constructs */
@@ -563,16 +1507,20 @@ parse_emph1(hoedown_buffer *ob, hoedown_markdown *md, uint8_t *data, size_t size
 {
 	size_t i = 0, len;
 	hoedown_buffer *work = 0;
+	struct inline_memo *memo = inline_memo_get(md, data, size);
 	int r;
 
+	if (emph_failed(memo, data, c, 1))
+		return 0;
+
 	/* skipping one symbol if coming from emph3 */
 	if (size > 1 && data[0] == c && data[1] == c) i = 1;
 
 	while (i < size) {
 		len = find_emph_char(data + i, size - i, c);
-		if (!len) return 0;
+		if (!len) return emph_fail(memo, data, c, 1);
 		i += len;
-		if (i >= size) return 0;
+		if (i >= size) return emph_fail(memo, data, c, 1);
 
 		if (data[i] == c && !_isspace(data[i - 1])) {
 
@@ -594,7 +1542,7 @@ parse_emph1(hoedown_buffer *ob, hoedown_markdown *md, uint8_t *data, size_t size
 		}
 	}
 
-	return 0;
+	return emph_fail(memo, data, c, 1);
 }
 
 /* parse_emph2 • parsing single emphase */
@@ -603,11 +1551,15 @@ parse_emph2(hoedown_buffer *ob, hoedown_markdown *md, uint8_t *data, size_t size
 {
 	size_t i = 0, len;
 	hoedown_buffer *work = 0;
+	struct inline_memo *memo = inline_memo_get(md, data, size);
 	int r;
 
+	if (emph_failed(memo, data, c, 2))
+		return 0;
+
 	while (i < size) {
 		len = find_emph_char(data + i, size - i, c);
-		if (!len) return 0;
+		if (!len) return emph_fail(memo, data, c, 2);
 		i += len;
 
 		if (i + 1 < size && data[i] == c && data[i + 1] == c && i && !_isspace(data[i - 1])) {
@@ -626,7 +1578,7 @@ parse_emph2(hoedown_buffer *ob, hoedown_markdown *md, uint8_t *data, size_t size
 		}
 		i++;
 	}
-	return 0;
+	return emph_fail(memo, data, c, 2);
 }
 
 /* parse_emph3 • parsing single emphase */
@@ -635,11 +1587,15 @@ static size_t
 parse_emph3(hoedown_buffer *ob, hoedown_markdown *md, uint8_t *data, size_t size, uint8_t c)
 {
 	size_t i = 0, len;
+	struct inline_memo *memo = inline_memo_get(md, data, size);
 	int r;
 
+	if (emph_failed(memo, data, c, 3))
+		return 0;
+
 	while (i < size) {
 		len = find_emph_char(data + i, size - i, c);
-		if (!len) return 0;
+		if (!len) return emph_fail(memo, data, c, 3);
 		i += len;
 
 		/* skip whitespace preceded symbols */
@@ -668,7 +1624,7 @@ parse_emph3(hoedown_buffer *ob, hoedown_markdown *md, uint8_t *data, size_t size
 			else return len - 1;
 		}
 	}
-	return 0;
+	return emph_fail(memo, data, c, 3);
 }
 
 /* char_emphasis • single and double emphasis parsing */
@@ -731,10 +1687,18 @@ char_codespan(hoedown_buffer *ob, hoedown_markdown *md, uint8_t *data, size_t of
 {
 	size_t end, nb = 0, i, f_begin, f_end;
 
+	struct inline_memo *memo = inline_memo_get(md, data, size);
+
+	if (memo)
+		nb = memo_run_length(memo, &memo->ticks, '`', offset);
+
 	/* counting the number of backticks in the delimiter */
 	while (nb < size && data[nb] == '`')
 		nb++;
 
+	if (memo && memo_longest_run(memo, &memo->ticks, '`', offset + nb) < nb)
+		return 0;
+
 	/* finding the next delimiter */
 	i = 0;
 	for (end = nb; end < size && i < nb; end++) {
@@ -773,10 +1737,18 @@ char_quote(hoedown_buffer *ob, hoedown_markdown *md, uint8_t *data, size_t offse
 {    
 	size_t end, nq = 0, i, f_begin, f_end;
 
+	struct inline_memo *memo = inline_memo_get(md, data, size);
+
+	if (memo)
+		nq = memo_run_length(memo, &memo->quotes, '"', offset);
+
 	/* counting the number of quotes in the delimiter */
 	while (nq < size && data[nq] == '"')
 		nq++;
 
+	if (memo && memo_longest_run(memo, &memo->quotes, '"', offset + nq) < nq)
+		return 0;
+
 	/* finding the next delimiter */
 	i = 0;
 	for (end = nq; end < size && i < nq; end++) {
@@ -868,10 +1840,18 @@ static size_t
 char_langle_tag(hoedown_buffer *ob, hoedown_markdown *md, uint8_t *data, size_t offset, size_t size)
 {
 	enum hoedown_autolink altype = HOEDOWN_AUTOLINK_NONE;
-	size_t end = tag_length(data, size, &altype);
-	hoedown_buffer work = { data, end, 0, 0 };
+	struct inline_memo *memo = inline_memo_get(md, data, size);
+	size_t end;
+	hoedown_buffer work = { data, 0, 0, 0 };
 	int ret = 0;
 
+	/* a tag or an autolink always ends on a '>' */
+	if (memo && !memo_char_after(memo, &memo->last_gt, '>', offset))
+		return 0;
+
+	end = tag_length(data, size, &altype);
+	work.size = end;
+
 	if (end > 2) {
 		if (md->md.autolink && altype != HOEDOWN_AUTOLINK_NONE) {
 			hoedown_buffer *u_link = newbuf(md, BUFFER_SPAN);
@@ -889,6 +1869,27 @@ char_langle_tag(hoedown_buffer *ob, hoedown_markdown *md, uint8_t *data, size_t
 	else return end;
 }
 
+/* autolink_rewind • how far back an autolink at data may take the text
+ * that ob ends with: over the chars before data that ob holds as they are
+ * in the source, and that an email or URL may start with. a span, a token
+ * of a recording renderer or SmartyPants stops it, rather than being cut */
+static size_t
+autolink_rewind(hoedown_buffer *ob, uint8_t *data, size_t offset)
+{
+	size_t i = 0;
+	uint8_t c;
+
+	while (i < offset && i < ob->size) {
+		c = *(data - 1 - i);
+		if (ob->data[ob->size - 1 - i] != c ||
+			!(isalnum(c) || c == '.' || c == '+' || c == '-' || c == '_'))
+			break;
+		i++;
+	}
+
+	return i;
+}
+
 static size_t
 char_autolink_www(hoedown_buffer *ob, hoedown_markdown *md, uint8_t *data, size_t offset, size_t size)
 {
@@ -932,7 +1933,7 @@ char_autolink_email(hoedown_buffer *ob, hoedown_markdown *md, uint8_t *data, siz
 
 	link = newbuf(md, BUFFER_SPAN);
 
-	if ((link_len = hoedown_autolink__email(&rewind, link, data, offset, size, 0)) > 0) {
+	if ((link_len = hoedown_autolink__email(&rewind, link, data, autolink_rewind(ob, data, offset), size, 0)) > 0) {
 		ob->size -= rewind;
 		md->md.autolink(ob, link, HOEDOWN_AUTOLINK_EMAIL, md->md.opaque);
 	}
@@ -952,7 +1953,7 @@ char_autolink_url(hoedown_buffer *ob, hoedown_markdown *md, uint8_t *data, size_
 
 	link = newbuf(md, BUFFER_SPAN);
 
-	if ((link_len = hoedown_autolink__url(&rewind, link, data, offset, size, 0)) > 0) {
+	if ((link_len = hoedown_autolink__url(&rewind, link, data, autolink_rewind(ob, data, offset), size, 0)) > 0) {
 		ob->size -= rewind;
 		md->md.autolink(ob, link, HOEDOWN_AUTOLINK_NORMAL, md->md.opaque);
 	}
@@ -966,6 +1967,8 @@ static size_t
 char_link(hoedown_buffer *ob, hoedown_markdown *md, uint8_t *data, size_t offset, size_t size)
 {
 	int is_img = (offset && data[-1] == '!'), level;
+	struct inline_memo *memo = inline_memo_get(md, data, size);
+	struct link_match *text_match = NULL;
 	size_t i = 1, txt_e, link_b = 0, link_e = 0, title_b = 0, title_e = 0;
 	hoedown_buffer *content = 0;
 	hoedown_buffer *link = 0;
@@ -979,8 +1982,22 @@ char_link(hoedown_buffer *ob, hoedown_markdown *md, uint8_t *data, size_t offset
 	if ((is_img && !md->md.image) || (!is_img && !md->md.link))
 		goto cleanup;
 
+	if (memo) {
+		if (!memo->brackets.ready)
+			match_pairs(&memo->brackets, memo->data, memo->size, '[', ']');
+
+		text_match = match_find(&memo->brackets, offset);
+	}
+
 	/* looking for the matching closing bracket */
-	for (level = 1; i < size; i++) {
+	if (text_match) {
+		if (!text_match->close)
+			goto cleanup;
+
+		i = text_match->close - offset;
+		text_has_nl = (text_match->flags & MATCH_NL) != 0;
+	}
+	else for (level = 1; i < size; i++) {
 		if (data[i] == '\n')
 			text_has_nl = 1;
 
@@ -1014,10 +2031,11 @@ char_link(hoedown_buffer *ob, hoedown_markdown *md, uint8_t *data, size_t offset
 		id.data = data + 2;
 		id.size = txt_e - 2;
 		
+		md->block_deps = 1;
 		fr = find_footnote_ref(&md->footnotes_found, id.data, id.size);
 		
-		/* mark footnote used */
-		if (fr && !fr->is_used) {
+		/* mark footnote used, by the render of md only */
+		if (fr && !fr->is_used && !md->in_toc) {
 			if(!add_footnote_ref(&md->footnotes_used, fr))
 				goto cleanup;
 			fr->is_used = 1;
@@ -1038,7 +2056,8 @@ char_link(hoedown_buffer *ob, hoedown_markdown *md, uint8_t *data, size_t offset
 
 	/* inline style link */
 	if (i < size && data[i] == '(') {
-		size_t nb_p;
+		size_t nb_p, paren = i;
+		struct link_match *paren_match = NULL;
 
 		/* skipping initial whitespace */
 		i++;
@@ -1052,7 +2071,22 @@ char_link(hoedown_buffer *ob, hoedown_markdown *md, uint8_t *data, size_t offset
 		/* Count the number of open parenthesis */
 		nb_p = 0;
 
-		while (i < size) {
+		if (memo) {
+			if (!memo->parens.ready)
+				match_pairs(&memo->parens, memo->data, memo->size, '(', ')');
+
+			paren_match = match_find(&memo->parens, offset + paren);
+		}
+
+		if (paren_match) {
+			size_t end = memo_space_quote(memo, offset + link_b);
+
+			if (paren_match->close && paren_match->close < end)
+				end = paren_match->close;
+
+			i = end - offset;
+		}
+		else while (i < size) {
 			if (data[i] == '\\') i += 2;
 			else if (data[i] == '(' && i != 0) {
 				nb_p++; i++;
@@ -1074,6 +2108,14 @@ char_link(hoedown_buffer *ob, hoedown_markdown *md, uint8_t *data, size_t offset
 			i++;
 			title_b = i;
 
+			/* no closing quote, or no ')' after the first one */
+			if (memo) {
+				uint8_t *quote = memchr(data + i, qtype, size - i);
+
+				if (!quote || !memo_char_after(memo, &memo->last_rparen, ')', offset + (quote - data)))
+					goto cleanup;
+			}
+
 			while (i < size) {
 				if (data[i] == '\\') i += 2;
 				else if (data[i] == qtype) {in_title = 0; i++;}
@@ -1131,6 +2173,9 @@ char_link(hoedown_buffer *ob, hoedown_markdown *md, uint8_t *data, size_t offset
 
 		/* finding the link_ref */
 		if (link_b == link_e) {
+			if (text_match && (text_match->flags & MATCH_RBRACKET))
+				goto cleanup;
+
 			if (text_has_nl) {
 				hoedown_buffer *b = newbuf(md, BUFFER_SPAN);
 				size_t j;
@@ -1153,6 +2198,7 @@ char_link(hoedown_buffer *ob, hoedown_markdown *md, uint8_t *data, size_t offset
 			id.size = link_e - link_b;
 		}
 
+		md->block_deps = 1;
 		lr = find_link_ref(md->refs, id.data, id.size);
 		if (!lr)
 			goto cleanup;
@@ -1168,6 +2214,10 @@ char_link(hoedown_buffer *ob, hoedown_markdown *md, uint8_t *data, size_t offset
 		hoedown_buffer id = { 0, 0, 0, 0 };
 		struct link_ref *lr;
 
+		/* an id never holds a ']' */
+		if (text_match && (text_match->flags & MATCH_RBRACKET))
+			goto cleanup;
+
 		/* crafting the id */
 		if (text_has_nl) {
 			hoedown_buffer *b = newbuf(md, BUFFER_SPAN);
@@ -1188,6 +2238,7 @@ char_link(hoedown_buffer *ob, hoedown_markdown *md, uint8_t *data, size_t offset
 		}
 
 		/* finding the link_ref */
+		md->block_deps = 1;
 		lr = find_link_ref(md->refs, id.data, id.size);
 		if (!lr)
 			goto cleanup;
@@ -1231,7 +2282,8 @@ char_link(hoedown_buffer *ob, hoedown_markdown *md, uint8_t *data, size_t offset
 
 	/* cleanup */
 cleanup:
-	md->work_bufs[BUFFER_SPAN].size = (int)org_work_size;
+	while (md->work_bufs[BUFFER_SPAN].size > org_work_size)
+		popbuf(md, BUFFER_SPAN);
 	return ret ? i : 0;
 }
 
@@ -1248,13 +2300,21 @@ char_superscript(hoedown_buffer *ob, hoedown_markdown *md, uint8_t *data, size_t
 		return 0;
 
 	if (data[1] == '(') {
+		struct inline_memo *memo = inline_memo_get(md, data, size);
+
+		if (memo && memo->sup_fail && data > memo->sup_fail)
+			return 0;
+
 		sup_start = sup_len = 2;
 
 		while (sup_len < size && data[sup_len] != ')' && data[sup_len - 1] != '\\')
 			sup_len++;
 
-		if (sup_len == size)
+		if (sup_len == size) {
+			if (memo)
+				memo->sup_fail = data;
 			return 0;
+		}
 	} else {
 		sup_start = sup_len = 1;
 
@@ -1549,11 +2609,10 @@ static void parse_block(hoedown_buffer *ob, hoedown_markdown *md,
 static size_t
 parse_blockquote(hoedown_buffer *ob, hoedown_markdown *md, uint8_t *data, size_t size)
 {
-	size_t beg, end = 0, pre, work_size = 0;
+	size_t beg, end = 0, pre, work_size = 0, content;
 	uint8_t *work_data = 0;
 	hoedown_buffer *out = 0;
 
-	out = newbuf(md, BUFFER_BLOCK);
 	beg = 0;
 	while (beg < size) {
 		for (end = beg + 1; end < size && data[end - 1] != '\n'; end++);
@@ -1580,6 +2639,13 @@ parse_blockquote(hoedown_buffer *ob, hoedown_markdown *md, uint8_t *data, size_t
 		beg = end;
 	}
 
+	if (enter_container(ob, md, md->md.blockquote != NULL, HOEDOWN_CONTAINER_BLOCKQUOTE, 0, &content)) {
+		parse_block(ob, md, work_data, work_size);
+		leave_container(ob, md, HOEDOWN_CONTAINER_BLOCKQUOTE, 0, content);
+		return end;
+	}
+
+	out = newbuf(md, BUFFER_BLOCK);
 	parse_block(out, md, work_data, work_size);
 	if (md->md.blockquote)
 		md->md.blockquote(ob, out, md->md.opaque);
@@ -1588,7 +2654,52 @@ parse_blockquote(hoedown_buffer *ob, hoedown_markdown *md, uint8_t *data, size_t
 }
 
 static size_t
-parse_htmlblock(hoedown_buffer *ob, hoedown_markdown *md, uint8_t *data, size_t size, int do_render);
+block_probe(hoedown_markdown *md, uint8_t *data, size_t size, enum block_probe probe);
+
+/* swap_toc • exchanges the callbacks of md and those of md->toc */
+static void
+swap_toc(hoedown_markdown *md)
+{
+	hoedown_renderer cb;
+	uint8_t active_char[256];
+
+	memcpy(&cb, &md->md, sizeof(hoedown_renderer));
+	memcpy(&md->md, &md->toc, sizeof(hoedown_renderer));
+	memcpy(&md->toc, &cb, sizeof(hoedown_renderer));
+
+	memcpy(active_char, md->active_char, sizeof(active_char));
+	memcpy(md->active_char, md->toc_active_char, sizeof(active_char));
+	memcpy(md->toc_active_char, active_char, sizeof(active_char));
+
+	md->in_toc = !md->in_toc;
+}
+
+/* header_toc • renders a header again with md->toc, after md rendered it */
+/*	the header text is parsed with the span callbacks of md->toc in place
+ *	of those of md, without marking the footnotes it refers to as used; a
+ *	header nested in a container is rendered into a buffer thrown away, as
+ *	the containers of md->toc drop their content */
+static void
+header_toc(hoedown_markdown *md, uint8_t *data, size_t size, int level)
+{
+	hoedown_buffer *work, *out;
+	int nested = nesting(md) > 0;
+
+	swap_toc(md);
+
+	work = newbuf(md, BUFFER_SPAN);
+	parse_inline(work, md, data, size);
+
+	out = nested ? newbuf(md, BUFFER_SPAN) : md->toc_ob;
+	if (md->md.header)
+		md->md.header(out, work, level, md->md.opaque);
+
+	if (nested)
+		popbuf(md, BUFFER_SPAN);
+	popbuf(md, BUFFER_SPAN);
+
+	swap_toc(md);
+}
 
 /* parse_blockquote • handles parsing of a regular paragraph */
 static size_t
@@ -1624,22 +2735,25 @@ parse_paragraph(hoedown_buffer *ob, hoedown_markdown *md, uint8_t *data, size_t
 		 * here
 		 */
 		if ((md->ext_flags & HOEDOWN_EXT_LAX_SPACING) && !isalnum(data[i])) {
-			if (prefix_oli(data + i, size - i) ||
-				prefix_uli(data + i, size - i)) {
+			if (block_probe(md, data + i, size - i, BLOCK_PROBE_OLI) ||
+				block_probe(md, data + i, size - i, BLOCK_PROBE_ULI)) {
 				end = i;
 				break;
 			}
 
-			/* see if an html block starts here */
-			if (data[i] == '<' && md->md.blockhtml &&
-				parse_htmlblock(ob, md, data + i, size - i, 0)) {
-				end = i;
-				break;
+			/* see if an html block starts here; the look-ahead may
+			 * go past the end of the paragraph */
+			if (data[i] == '<' && md->md.blockhtml) {
+				md->block_deps = 1;
+				if (block_probe(md, data + i, size - i, BLOCK_PROBE_HTML)) {
+					end = i;
+					break;
+				}
 			}
 
 			/* see if a code fence starts here */
 			if ((md->ext_flags & HOEDOWN_EXT_FENCED_CODE) != 0 &&
-				is_codefence(data + i, size - i, NULL) != 0) {
+				block_probe(md, data + i, size - i, BLOCK_PROBE_FENCE) != 0) {
 				end = i;
 				break;
 			}
@@ -1690,48 +2804,126 @@ parse_paragraph(hoedown_buffer *ob, hoedown_markdown *md, uint8_t *data, size_t
 		header_work = newbuf(md, BUFFER_SPAN);
 		parse_inline(header_work, md, work.data, work.size);
 
+		md->block_deps = 1;
 		if (md->md.header)
 			md->md.header(ob, header_work, (int)level, md->md.opaque);
 
 		popbuf(md, BUFFER_SPAN);
+
+		if (md->toc_ob)
+			header_toc(md, work.data, work.size, (int)level);
 	}
 
 	return end;
 }
 
+/* code_line_closes • returns the size of the closing fence at data, a code
+ * line starting with a space or a fence char, or 0; clears *verbatim when
+ * the line holds only spaces, which the code keeps as an empty line */
+static size_t
+code_line_closes(uint8_t *data, size_t size, int *verbatim)
+{
+	hoedown_buffer trail = { 0, 0, 0, 0 };
+	size_t fence = is_codefence(data, size, &trail);
+
+	if (fence != 0 && trail.size == 0)
+		return fence;
+
+	if (data[0] == ' ' && is_empty(data, size))
+		*verbatim = 0;
+
+	return 0;
+}
+
+/* code_fence_scan • returns the start of the line closing the fenced code
+ * at data, or size, setting *fence_end to the end of that line. only the
+ * lines starting with a space or a fence char are looked at, 16 bytes at
+ * a time where SSE2 is there */
+static size_t
+code_fence_scan(uint8_t *data, size_t size, size_t *fence_end, int *verbatim)
+{
+	size_t i = 0, fence;
+	int start = 1;
+
+#ifdef MARKDOWN_SSE2
+	const __m128i newline = _mm_set1_epi8('\n'), space = _mm_set1_epi8(' ');
+	const __m128i backtick = _mm_set1_epi8('`'), tilde = _mm_set1_epi8('~');
+
+	while (i + 16 <= size) {
+		__m128i v = _mm_loadu_si128((const __m128i *)(data + i));
+		int lines = _mm_movemask_epi8(_mm_cmpeq_epi8(v, newline));
+		int marks = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, space),
+			_mm_or_si128(_mm_cmpeq_epi8(v, backtick), _mm_cmpeq_epi8(v, tilde))));
+		int mask = ((lines << 1) | start) & marks;
+
+		while (mask) {
+			size_t at = i + __builtin_ctz(mask);
+
+			if ((fence = code_line_closes(data + at, size - at, verbatim)) != 0) {
+				*fence_end = at + fence;
+				return at;
+			}
+			mask &= mask - 1;
+		}
+
+		start = (lines >> 15) & 1;
+		i += 16;
+	}
+#endif
+
+	for (; i < size; ++i) {
+		if (start && (data[i] == ' ' || data[i] == '`' || data[i] == '~') &&
+			(fence = code_line_closes(data + i, size - i, verbatim)) != 0) {
+			*fence_end = i + fence;
+			return i;
+		}
+		start = data[i] == '\n';
+	}
+
+	*fence_end = size;
+	return size;
+}
+
 /* parse_fencedcode • handles parsing of a block-level code fragment */
+/*	code whose lines all copy as they are is handed over in place */
 static size_t
 parse_fencedcode(hoedown_buffer *ob, hoedown_markdown *md, uint8_t *data, size_t size)
 {
-	size_t beg, end;
+	size_t beg, end, line, fence_end;
+	int verbatim = 1;
 	hoedown_buffer *work = 0;
 	hoedown_buffer lang = { 0, 0, 0, 0 };
+	hoedown_buffer text = { 0, 0, 0, 0 };
 
 	beg = is_codefence(data, size, &lang);
 	if (beg == 0) return 0;
 
-	work = newbuf(md, BUFFER_BLOCK);
+	if (beg < size) {
+		end = beg + code_fence_scan(data + beg, size - beg, &fence_end, &verbatim);
+		fence_end += beg;
+	} else
+		end = fence_end = beg;
 
-	while (beg < size) {
-		size_t fence_end;
-		hoedown_buffer fence_trail = { 0, 0, 0, 0 };
+	if (verbatim && (end == beg || data[end - 1] == '\n')) {
+		text.data = data + beg;
+		text.size = end - beg;
 
-		fence_end = is_codefence(data + beg, size - beg, &fence_trail);
-		if (fence_end != 0 && fence_trail.size == 0) {
-			beg += fence_end;
-			break;
-		}
+		if (md->md.blockcode)
+			md->md.blockcode(ob, &text, lang.size ? &lang : NULL, md->md.opaque);
 
-		for (end = beg + 1; end < size && data[end - 1] != '\n'; end++);
+		return fence_end;
+	}
 
-		if (beg < end) {
-			/* verbatim copy to the working buffer,
-				escaping entities */
-			if (is_empty(data + beg, end - beg))
-				hoedown_buffer_putc(work, '\n');
-			else hoedown_buffer_put(work, data + beg, end - beg);
-		}
-		beg = end;
+	work = newbuf(md, BUFFER_BLOCK);
+
+	for (; beg < end; beg = line) {
+		for (line = beg + 1; line < end && data[line - 1] != '\n'; line++);
+
+		/* verbatim copy to the working buffer,
+			escaping entities */
+		if (is_empty(data + beg, line - beg))
+			hoedown_buffer_putc(work, '\n');
+		else hoedown_buffer_put(work, data + beg, line - beg);
 	}
 
 	if (work->size && work->data[work->size - 1] != '\n')
@@ -1741,7 +2933,7 @@ parse_fencedcode(hoedown_buffer *ob, hoedown_markdown *md, uint8_t *data, size_t
 		md->md.blockcode(ob, work, lang.size ? &lang : NULL, md->md.opaque);
 
 	popbuf(md, BUFFER_BLOCK);
-	return beg;
+	return fence_end;
 }
 
 static size_t
@@ -1791,7 +2983,7 @@ static size_t
 parse_listitem(hoedown_buffer *ob, hoedown_markdown *md, uint8_t *data, size_t size, int *flags)
 {
 	hoedown_buffer *work = 0, *inter = 0;
-	size_t beg = 0, end, pre, sublist = 0, orgpre = 0, i;
+	size_t beg = 0, end, pre, sublist = 0, orgpre = 0, i, content;
 	int in_empty = 0, has_inside_empty = 0, in_fence = 0;
 
 	/* keeping track of the first indentation prefix */
@@ -1810,9 +3002,8 @@ parse_listitem(hoedown_buffer *ob, hoedown_markdown *md, uint8_t *data, size_t s
 	while (end < size && data[end - 1] != '\n')
 		end++;
 
-	/* getting working buffers */
+	/* getting the working buffer */
 	work = newbuf(md, BUFFER_SPAN);
-	inter = newbuf(md, BUFFER_SPAN);
 
 	/* putting the first line into the working buffer */
 	hoedown_buffer_put(work, data + beg, end - beg);
@@ -1895,6 +3086,11 @@ parse_listitem(hoedown_buffer *ob, hoedown_markdown *md, uint8_t *data, size_t s
 	if (has_inside_empty)
 		*flags |= HOEDOWN_LI_BLOCK;
 
+	if (enter_container(ob, md, md->md.listitem != NULL, HOEDOWN_CONTAINER_LISTITEM, *flags, &content))
+		inter = ob;
+	else
+		inter = newbuf(md, BUFFER_SPAN);
+
 	if (*flags & HOEDOWN_LI_BLOCK) {
 		/* intermediate render of block li */
 		if (sublist && sublist < work->size) {
@@ -1914,10 +3110,14 @@ parse_listitem(hoedown_buffer *ob, hoedown_markdown *md, uint8_t *data, size_t s
 	}
 
 	/* render of li itself */
-	if (md->md.listitem)
-		md->md.listitem(ob, inter, *flags, md->md.opaque);
+	if (inter == ob) {
+		leave_container(ob, md, HOEDOWN_CONTAINER_LISTITEM, *flags, content);
+	} else {
+		if (md->md.listitem)
+			md->md.listitem(ob, inter, *flags, md->md.opaque);
+		popbuf(md, BUFFER_SPAN);
+	}
 
-	popbuf(md, BUFFER_SPAN);
 	popbuf(md, BUFFER_SPAN);
 	return beg;
 }
@@ -1928,9 +3128,11 @@ static size_t
 parse_list(hoedown_buffer *ob, hoedown_markdown *md, uint8_t *data, size_t size, int flags)
 {
 	hoedown_buffer *work = 0;
-	size_t i = 0, j;
+	size_t i = 0, j, content;
+	int in_place;
 
-	work = newbuf(md, BUFFER_BLOCK);
+	in_place = enter_container(ob, md, md->md.list != NULL, HOEDOWN_CONTAINER_LIST, flags, &content);
+	work = in_place ? ob : newbuf(md, BUFFER_BLOCK);
 
 	while (i < size) {
 		j = parse_listitem(work, md, data + i, size - i, &flags);
@@ -1940,6 +3142,11 @@ parse_list(hoedown_buffer *ob, hoedown_markdown *md, uint8_t *data, size_t size,
 			break;
 	}
 
+	if (in_place) {
+		leave_container(ob, md, HOEDOWN_CONTAINER_LIST, flags, content);
+		return i;
+	}
+
 	if (md->md.list)
 		md->md.list(ob, work, flags, md->md.opaque);
 	popbuf(md, BUFFER_BLOCK);
@@ -1972,10 +3179,14 @@ parse_atxheader(hoedown_buffer *ob, hoedown_markdown *md, uint8_t *data, size_t
 
 		parse_inline(work, md, data + i, end - i);
 
+		md->block_deps = 1;
 		if (md->md.header)
 			md->md.header(ob, work, (int)level, md->md.opaque);
 
 		popbuf(md, BUFFER_SPAN);
+
+		if (md->toc_ob)
+			header_toc(md, data + i, end - i, (int)level);
 	}
 
 	return skip;
@@ -2002,11 +3213,14 @@ parse_footnote_list(hoedown_buffer *ob, hoedown_markdown *md, struct footnote_li
 	hoedown_buffer *work = 0;
 	struct footnote_item *item;
 	struct footnote_ref *ref;
+	size_t content;
+	int in_place;
 	
 	if (footnotes->count == 0)
 		return;
 	
-	work = newbuf(md, BUFFER_BLOCK);
+	in_place = enter_container(ob, md, md->md.footnotes != NULL, HOEDOWN_CONTAINER_FOOTNOTES, 0, &content);
+	work = in_place ? ob : newbuf(md, BUFFER_BLOCK);
 	
 	item = footnotes->head;
 	while (item) {
@@ -2015,6 +3229,11 @@ parse_footnote_list(hoedown_buffer *ob, hoedown_markdown *md, struct footnote_li
 		item = item->next;
 	}
 	
+	if (in_place) {
+		leave_container(ob, md, HOEDOWN_CONTAINER_FOOTNOTES, 0, content);
+		return;
+	}
+
 	if (md->md.footnotes)
 		md->md.footnotes(ob, work, md->md.opaque);
 	popbuf(md, BUFFER_BLOCK);
@@ -2094,20 +3313,22 @@ htmlblock_end(const char *curtag,
 }
 
 
-/* parse_htmlblock • parsing of inline HTML block */
+/* htmlblock_size • size of the HTML block starting at data, 0 if none */
 static size_t
-parse_htmlblock(hoedown_buffer *ob, hoedown_markdown *md, uint8_t *data, size_t size, int do_render)
+htmlblock_size(hoedown_markdown *md, uint8_t *data, size_t size)
 {
 	size_t i, j = 0, tag_end;
 	const char *curtag = NULL;
-	hoedown_buffer work = { data, 0, 0, 0 };
+	struct block_memo *memo = block_memo_get(md, data, size);
+	uint8_t **tag_fail;
 
 	/* identification of the opening tag */
 	if (size < 2 || data[0] != '<')
 		return 0;
 
+	/* names longer than any block tag need not be scanned to their end */
 	i = 1;
-	while (i < size && data[i] != '>' && data[i] != ' ')
+	while (i < size && i <= HTML_BLOCK_TAG_MAX + 1 && data[i] != '>' && data[i] != ' ')
 		i++;
 
 	if (i < size)
@@ -2117,40 +3338,40 @@ parse_htmlblock(hoedown_buffer *ob, hoedown_markdown *md, uint8_t *data, size_t
 	if (!curtag) {
 
 		/* HTML comment, laxist form */
-		if (size > 5 && data[1] == '!' && data[2] == '-' && data[3] == '-') {
+		if (size > 5 && data[1] == '!' && data[2] == '-' && data[3] == '-' &&
+			!(memo && memo->comment_fail && data > memo->comment_fail)) {
 			i = 5;
 
 			while (i < size && !(data[i - 2] == '-' && data[i - 1] == '-' && data[i] == '>'))
 				i++;
 
+			if (memo && i >= size)
+				memo->comment_fail = data;
+
 			i++;
 
 			if (i < size)
 				j = is_empty(data + i, size - i);
 
-			if (j) {
-				work.size = i + j;
-				if (do_render && md->md.blockhtml)
-					md->md.blockhtml(ob, &work, md->md.opaque);
-				return work.size;
-			}
+			if (j)
+				return i + j;
 		}
 
 		/* HR, which is the only self-closing block tag considered */
-		if (size > 4 && (data[1] == 'h' || data[1] == 'H') && (data[2] == 'r' || data[2] == 'R')) {
+		if (size > 4 && (data[1] == 'h' || data[1] == 'H') && (data[2] == 'r' || data[2] == 'R') &&
+			!(memo && memo->hr_fail && data > memo->hr_fail)) {
 			i = 3;
 			while (i < size && data[i] != '>')
 				i++;
 
+			if (memo && i >= size)
+				memo->hr_fail = data;
+
 			if (i + 1 < size) {
 				i++;
 				j = is_empty(data + i, size - i);
-				if (j) {
-					work.size = i + j;
-					if (do_render && md->md.blockhtml)
-						md->md.blockhtml(ob, &work, md->md.opaque);
-					return work.size;
-				}
+				if (j)
+					return i + j;
 			}
 		}
 
@@ -2158,27 +3379,121 @@ parse_htmlblock(hoedown_buffer *ob, hoedown_markdown *md, uint8_t *data, size_t
 		return 0;
 	}
 
+	/* the indented pass below already failed for an earlier tag */
+	if (memo && (tag_fail = block_memo_tag(memo, curtag, 0)) != NULL && data > *tag_fail)
+		return 0;
+
 	/* looking for an unindented matching closing tag */
 	/*	followed by a blank line */
 	tag_end = htmlblock_end(curtag, md, data, size, 1);
 
-	/* if not found, trying a second pass looking for indented match */
-	/* but not if tag is "ins" or "del" (following original Markdown.pl) */
-	if (!tag_end && strcmp(curtag, "ins") != 0 && strcmp(curtag, "del") != 0) {
-		tag_end = htmlblock_end(curtag, md, data, size, 0);
+	/* if not found, trying a second pass looking for indented match */
+	/* but not if tag is "ins" or "del" (following original Markdown.pl) */
+	if (!tag_end && strcmp(curtag, "ins") != 0 && strcmp(curtag, "del") != 0) {
+		tag_end = htmlblock_end(curtag, md, data, size, 0);
+
+		if (memo && !tag_end && (tag_fail = block_memo_tag(memo, curtag, 1)) != NULL)
+			*tag_fail = data;
+	}
+
+	return tag_end;
+}
+
+/* block_probe • runs a block-start probe, once per line with BLOCK_MEMO_EXTS */
+static size_t
+block_probe(hoedown_markdown *md, uint8_t *data, size_t size, enum block_probe probe)
+{
+	struct block_memo *memo = block_memo_get(md, data, size);
+	size_t result;
+
+	if (memo && memo->probe_at == data && (memo->probe_known & (1u << probe)))
+		return memo->probe[probe];
+
+	switch (probe) {
+	case BLOCK_PROBE_HTML:
+		result = htmlblock_size(md, data, size);
+		break;
+	case BLOCK_PROBE_FENCE:
+		result = is_codefence(data, size, NULL);
+		break;
+	case BLOCK_PROBE_OLI:
+		result = prefix_oli(data, size);
+		break;
+	default:
+		result = prefix_uli(data, size);
+		break;
+	}
+
+	if (memo) {
+		if (memo->probe_at != data) {
+			memo->probe_at = data;
+			memo->probe_known = 0;
+		}
+		memo->probe_known |= 1u << probe;
+		memo->probe[probe] = result;
+	}
+
+	return result;
+}
+
+/* parse_htmlblock • parsing of inline HTML block */
+static size_t
+parse_htmlblock(hoedown_buffer *ob, hoedown_markdown *md, uint8_t *data, size_t size, int do_render)
+{
+	hoedown_buffer work = { data, 0, 0, 0 };
+
+	work.size = block_probe(md, data, size, BLOCK_PROBE_HTML);
+	if (work.size && do_render && md->md.blockhtml)
+		md->md.blockhtml(ob, &work, md->md.opaque);
+
+	return work.size;
+}
+
+/* table_row_scan • returns the end of the row at data, keeping the offsets
+ * of its first max_pipes pipes and counting all of them in *count */
+static size_t
+table_row_scan(const uint8_t *data, size_t size, size_t *pipes, size_t max_pipes, size_t *count)
+{
+	size_t i = 0, n = 0;
+
+#ifdef MARKDOWN_SSE2
+	const __m128i pipe = _mm_set1_epi8('|'), newline = _mm_set1_epi8('\n');
+
+	while (i + 16 <= size) {
+		__m128i v = _mm_loadu_si128((const __m128i *)(data + i));
+		int mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, pipe), _mm_cmpeq_epi8(v, newline)));
+
+		while (mask) {
+			size_t at = i + __builtin_ctz(mask);
+
+			if (data[at] == '\n') {
+				*count = n;
+				return at;
+			}
+
+			if (n < max_pipes)
+				pipes[n] = at;
+			n++;
+			mask &= mask - 1;
+		}
+
+		i += 16;
 	}
+#endif
 
-	if (!tag_end)
-		return 0;
-
-	/* the end of the block has been found */
-	work.size = tag_end;
-	if (do_render && md->md.blockhtml)
-		md->md.blockhtml(ob, &work, md->md.opaque);
+	for (; i < size && data[i] != '\n'; ++i) {
+		if (data[i] == '|') {
+			if (n < max_pipes)
+				pipes[n] = i;
+			n++;
+		}
+	}
 
-	return tag_end;
+	*count = n;
+	return i;
 }
 
+/* parse_table_row • renders a row, its cells ending at the given pipes */
 static void
 parse_table_row(
 	hoedown_buffer *ob,
@@ -2187,48 +3502,72 @@ parse_table_row(
 	size_t size,
 	size_t columns,
 	int *col_data,
-	int header_flag)
+	int header_flag,
+	const size_t *pipes,
+	size_t npipes)
 {
-	size_t i = 0, col;
-	hoedown_buffer *row_work = 0;
+	size_t i = 0, p = 0, col, content, cell;
+	hoedown_buffer *row_work = 0, *cell_work = 0;
 
-	if (!md->md.table_cell || !md->md.table_row)
+	if (!md->md.table_cell && !(md->md.container_enter && md->md.container_leave))
 		return;
 
-	row_work = newbuf(md, BUFFER_SPAN);
+	if (enter_container(ob, md, md->md.table_row != NULL, HOEDOWN_CONTAINER_TABLE_ROW, header_flag, &content))
+		row_work = ob;
+	else if (md->md.table_row)
+		row_work = newbuf(md, BUFFER_SPAN);
+	else
+		return;
 
-	if (i < size && data[i] == '|')
+	/* one work buffer serves all the cells rendered by a callback */
+	if (md->md.table_cell)
+		cell_work = newbuf(md, BUFFER_SPAN);
+
+	if (i < size && data[i] == '|') {
 		i++;
+		p++;
+	}
 
 	for (col = 0; col < columns && i < size; ++col) {
 		size_t cell_start, cell_end;
-		hoedown_buffer *cell_work;
-
-		cell_work = newbuf(md, BUFFER_SPAN);
 
 		while (i < size && _isspace(data[i]))
 			i++;
 
 		cell_start = i;
-
-		while (i < size && data[i] != '|')
-			i++;
-
+		i = p < npipes ? pipes[p++] : size;
 		cell_end = i - 1;
 
 		while (cell_end > cell_start && _isspace(data[cell_end]))
 			cell_end--;
 
-		parse_inline(cell_work, md, data + cell_start, 1 + cell_end - cell_start);
-		md->md.table_cell(row_work, cell_work, col_data[col] | header_flag, md->md.opaque);
+		if (enter_container(row_work, md, cell_work != NULL, HOEDOWN_CONTAINER_TABLE_CELL, col_data[col] | header_flag, &cell)) {
+			parse_inline(row_work, md, data + cell_start, 1 + cell_end - cell_start);
+			leave_container(row_work, md, HOEDOWN_CONTAINER_TABLE_CELL, col_data[col] | header_flag, cell);
+		} else {
+			cell_work->size = 0;
+			parse_inline(cell_work, md, data + cell_start, 1 + cell_end - cell_start);
+			md->md.table_cell(row_work, cell_work, col_data[col] | header_flag, md->md.opaque);
+		}
 
-		popbuf(md, BUFFER_SPAN);
 		i++;
 	}
 
 	for (; col < columns; ++col) {
 		hoedown_buffer empty_cell = { 0, 0, 0, 0 };
-		md->md.table_cell(row_work, &empty_cell, col_data[col] | header_flag, md->md.opaque);
+
+		if (enter_container(row_work, md, cell_work != NULL, HOEDOWN_CONTAINER_TABLE_CELL, col_data[col] | header_flag, &cell))
+			leave_container(row_work, md, HOEDOWN_CONTAINER_TABLE_CELL, col_data[col] | header_flag, cell);
+		else
+			md->md.table_cell(row_work, &empty_cell, col_data[col] | header_flag, md->md.opaque);
+	}
+
+	if (cell_work)
+		popbuf(md, BUFFER_SPAN);
+
+	if (row_work == ob) {
+		leave_container(ob, md, HOEDOWN_CONTAINER_TABLE_ROW, header_flag, content);
+		return;
 	}
 
 	md->md.table_row(ob, row_work, md->md.opaque);
@@ -2236,17 +3575,18 @@ parse_table_row(
 	popbuf(md, BUFFER_SPAN);
 }
 
+/* parse_table_header • parses the header underline, returning the start of
+ * the body; the header row itself ends at *header_end */
 static size_t
 parse_table_header(
-	hoedown_buffer *ob,
-	hoedown_markdown *md,
 	uint8_t *data,
 	size_t size,
 	size_t *columns,
-	int **column_data)
+	int **column_data,
+	size_t *header_end)
 {
 	int pipes;
-	size_t i = 0, col, header_end, under_end;
+	size_t i = 0, col, row_end, under_end;
 
 	pipes = 0;
 	while (i < size && data[i] != '\n')
@@ -2256,15 +3596,15 @@ parse_table_header(
 	if (i == size || pipes == 0)
 		return 0;
 
-	header_end = i;
+	row_end = i;
 
-	while (header_end > 0 && _isspace(data[header_end - 1]))
-		header_end--;
+	while (row_end > 0 && _isspace(data[row_end - 1]))
+		row_end--;
 
 	if (data[0] == '|')
 		pipes--;
 
-	if (header_end && data[header_end - 1] == '|')
+	if (row_end && data[row_end - 1] == '|')
 		pipes--;
 
 	if (pipes < 0)
@@ -2317,14 +3657,7 @@ parse_table_header(
 	if (col < *columns)
 		return 0;
 
-	parse_table_row(
-		ob, md, data,
-		header_end,
-		*columns,
-		*column_data,
-		HOEDOWN_TABLE_HEADER
-	);
-
+	*header_end = row_end;
 	return under_end + 1;
 }
 
@@ -2335,78 +3668,190 @@ parse_table(
 	uint8_t *data,
 	size_t size)
 {
-	size_t i;
+	size_t i, header_end, content, section = 0, npipes, flushed;
 
 	hoedown_buffer *header_work = 0;
 	hoedown_buffer *body_work = 0;
 
-	size_t columns;
+	size_t columns, *pipes = NULL;
 	int *col_data = NULL;
 
-	header_work = newbuf(md, BUFFER_SPAN);
-	body_work = newbuf(md, BUFFER_BLOCK);
+	i = parse_table_header(data, size, &columns, &col_data, &header_end);
 
-	i = parse_table_header(header_work, md, data, size, &columns, &col_data);
-	if (i > 0) {
+	/* a row needs its leading pipe and one per column at most */
+	if (i != 0)
+		pipes = malloc((columns + 1) * sizeof(size_t));
 
-		while (i < size) {
-			size_t row_start;
-			int pipes = 0;
+	if (!pipes) {
+		free(col_data);
+		return 0;
+	}
+
+	if (enter_container(ob, md, md->md.table != NULL, HOEDOWN_CONTAINER_TABLE, 0, &content)) {
+		enter_container(ob, md, 0, HOEDOWN_CONTAINER_TABLE_HEADER, 0, &section);
+		header_work = body_work = ob;
+	} else {
+		header_work = newbuf(md, BUFFER_SPAN);
+		body_work = newbuf(md, BUFFER_BLOCK);
+	}
+
+	table_row_scan(data, header_end, pipes, columns + 1, &npipes);
+	parse_table_row(
+		header_work, md, data,
+		header_end,
+		columns,
+		col_data,
+		HOEDOWN_TABLE_HEADER,
+		pipes,
+		npipes < columns + 1 ? npipes : columns + 1
+	);
 
-			row_start = i;
+	if (body_work == ob) {
+		leave_container(ob, md, HOEDOWN_CONTAINER_TABLE_HEADER, 0, section);
+		enter_container(ob, md, 0, HOEDOWN_CONTAINER_TABLE_BODY, 0, &section);
+	}
 
-			while (i < size && data[i] != '\n')
-				if (data[i++] == '|')
-					pipes++;
+	while (i < size) {
+		size_t row_start = i;
 
-			if (pipes == 0 || i == size) {
-				i = row_start;
-				break;
-			}
+		i += table_row_scan(data + row_start, size - row_start, pipes, columns + 1, &npipes);
 
-			parse_table_row(
-				body_work,
-				md,
-				data + row_start,
-				i - row_start,
-				columns,
-				col_data, 0
-			);
+		if (npipes == 0 || i == size) {
+			i = row_start;
+			break;
+		}
 
-			i++;
+		parse_table_row(
+			body_work,
+			md,
+			data + row_start,
+			i - row_start,
+			columns,
+			col_data, 0,
+			pipes,
+			npipes < columns + 1 ? npipes : columns + 1
+		);
+
+		/* the rows of a top level table go out one by one */
+		if (body_work == ob && (flushed = flush_output(ob, md, 2)) != 0) {
+			content = content > flushed ? content - flushed : 0;
+			section = section > flushed ? section - flushed : 0;
 		}
 
+		i++;
+	}
+
+	if (body_work == ob) {
+		leave_container(ob, md, HOEDOWN_CONTAINER_TABLE_BODY, 0, section);
+		leave_container(ob, md, HOEDOWN_CONTAINER_TABLE, 0, content);
+	} else {
 		if (md->md.table)
 			md->md.table(ob, header_work, body_work, md->md.opaque);
+		popbuf(md, BUFFER_SPAN);
+		popbuf(md, BUFFER_BLOCK);
 	}
 
+	free(pipes);
 	free(col_data);
-	popbuf(md, BUFFER_SPAN);
-	popbuf(md, BUFFER_BLOCK);
 	return i;
 }
 
+/* replay_block • copies the output of the top level block starting data
+ * from the block cache, returning its size or 0 when it has to be parsed */
+static size_t
+replay_block(hoedown_buffer *ob, hoedown_markdown *md, uint8_t *data, size_t size)
+{
+	const hoedown_block_cache_entry *entry;
+
+	/* an html block may look at the whole document, and headers are
+	 * never stored */
+	if (data[0] == '<' || is_empty(data, size) || is_atxheader(md, data, size))
+		return 0;
+
+	entry = hoedown_block_cache_find(md->block_cache, data, size,
+		ob->size ? HOEDOWN_BLOCK_AFTER_OUTPUT : 0);
+	if (!entry)
+		return 0;
+
+	hoedown_buffer_put(ob, entry->data + entry->key_size, entry->out_size);
+	return entry->block_size;
+}
+
+/* cache_block • stores the output of the top level block from beg to end */
+/*	the key goes on with the lines that ended the block: the blank ones,
+ *	the first other one and the line after it, which list item prefixes
+ *	look at; that is all the parse of a block depends on */
+static void
+cache_block(hoedown_buffer *ob, hoedown_markdown *md, size_t out_start, size_t beg, size_t end, size_t size)
+{
+	const uint8_t *src = md->block_src;
+	size_t key_end = end, line, lines = 0;
+	unsigned int flags = 0;
+
+	if (md->block_deps || md->status != HOEDOWN_RENDER_OK || ob->size == out_start)
+		return;
+
+	while (key_end < size && lines < 2) {
+		line = is_empty(src + key_end, size - key_end);
+		if (line && !lines) {
+			key_end += line;
+			continue;
+		}
+
+		while (key_end < size && src[key_end++] != '\n');
+		lines++;
+	}
+
+	if (key_end > size)
+		key_end = size;
+
+	if (out_start)
+		flags |= HOEDOWN_BLOCK_AFTER_OUTPUT;
+	if (key_end >= size)
+		flags |= HOEDOWN_BLOCK_AT_END;
+
+	hoedown_block_cache_store(md->block_cache, src + beg, key_end - beg, end - beg,
+		ob->data + out_start, ob->size - out_start, flags);
+}
+
 /* parse_block • parsing of one block, returning next uint8_t to parse */
 static void
 parse_block(hoedown_buffer *ob, hoedown_markdown *md, uint8_t *data, size_t size)
 {
-	size_t beg, end, i;
+	size_t beg, end, i, out_start = 0;
 	uint8_t *txt_data;
+	struct block_memo memo, *parent_memo = md->block_memo;
+	int cached = md->block_src != NULL && nesting(md) == 0;
+	STATS_DECL
 	beg = 0;
 
-	if (md->work_bufs[BUFFER_SPAN].size +
-		md->work_bufs[BUFFER_BLOCK].size > md->max_nesting)
+	if (nesting(md) > md->max_nesting)
 		return;
 
-	while (beg < size) {
+	if (md->ext_flags & BLOCK_MEMO_EXTS) {
+		block_memo_init(&memo, data, size);
+		md->block_memo = &memo;
+	}
+
+	while (beg < size && md->status == HOEDOWN_RENDER_OK) {
 		txt_data = data + beg;
 		end = size - beg;
 
+		if (cached) {
+			if ((i = replay_block(ob, md, txt_data, end)) != 0) {
+				beg += i;
+				continue;
+			}
+
+			out_start = ob->size;
+			md->block_deps = (data[beg] == '<');
+		}
+
 		if (is_atxheader(md, txt_data, end))
-			beg += parse_atxheader(ob, md, txt_data, end);
+			beg += STATS(md, block, HOEDOWN_STATS_ATXHEADER, parse_atxheader(ob, md, txt_data, end));
 
 		else if (data[beg] == '<' && md->md.blockhtml &&
-				(i = parse_htmlblock(ob, md, txt_data, end, 1)) != 0)
+				(i = STATS(md, block, HOEDOWN_STATS_HTMLBLOCK, parse_htmlblock(ob, md, txt_data, end, 1))) != 0)
 			beg += i;
 
 		else if ((i = is_empty(txt_data, end)) != 0)
@@ -2423,28 +3868,39 @@ parse_block(hoedown_buffer *ob, hoedown_markdown *md, uint8_t *data, size_t size
 		}
 
 		else if ((md->ext_flags & HOEDOWN_EXT_FENCED_CODE) != 0 &&
-			(i = parse_fencedcode(ob, md, txt_data, end)) != 0)
+			(i = STATS(md, block, HOEDOWN_STATS_FENCEDCODE, parse_fencedcode(ob, md, txt_data, end))) != 0)
 			beg += i;
 
 		else if ((md->ext_flags & HOEDOWN_EXT_TABLES) != 0 &&
-			(i = parse_table(ob, md, txt_data, end)) != 0)
+			(i = STATS(md, block, HOEDOWN_STATS_TABLE, parse_table(ob, md, txt_data, end))) != 0)
 			beg += i;
 
 		else if (prefix_quote(txt_data, end))
-			beg += parse_blockquote(ob, md, txt_data, end);
+			beg += STATS(md, block, HOEDOWN_STATS_BLOCKQUOTE, parse_blockquote(ob, md, txt_data, end));
 
 		else if (!(md->ext_flags & HOEDOWN_EXT_DISABLE_INDENTED_CODE) && prefix_code(txt_data, end))
-			beg += parse_blockcode(ob, md, txt_data, end);
+			beg += STATS(md, block, HOEDOWN_STATS_BLOCKCODE, parse_blockcode(ob, md, txt_data, end));
 
-		else if (prefix_uli(txt_data, end))
-			beg += parse_list(ob, md, txt_data, end, 0);
+		else if (block_probe(md, txt_data, end, BLOCK_PROBE_ULI))
+			beg += STATS(md, block, HOEDOWN_STATS_LIST, parse_list(ob, md, txt_data, end, 0));
 
-		else if (prefix_oli(txt_data, end))
-			beg += parse_list(ob, md, txt_data, end, HOEDOWN_LIST_ORDERED);
+		else if (block_probe(md, txt_data, end, BLOCK_PROBE_OLI))
+			beg += STATS(md, block, HOEDOWN_STATS_LIST, parse_list(ob, md, txt_data, end, HOEDOWN_LIST_ORDERED));
 
 		else
-			beg += parse_paragraph(ob, md, txt_data, end);
+			beg += STATS(md, block, HOEDOWN_STATS_PARAGRAPH, parse_paragraph(ob, md, txt_data, end));
+
+		/* each block is charged for the bytes it spans */
+		add_work(md, (size_t)(data + beg - txt_data));
+
+		if (cached)
+			cache_block(ob, md, out_start, txt_data - data, beg, size);
+
+		flush_output(ob, md, 0);
 	}
+
+	if (md->ext_flags & BLOCK_MEMO_EXTS)
+		md->block_memo = parent_memo;
 }
 
 
@@ -2672,7 +4128,9 @@ is_ref(const uint8_t *data, size_t beg, size_t end, size_t *last, struct link_re
 	return 1;
 }
 
-static void expand_tabs(hoedown_buffer *ob, const uint8_t *line, size_t size)
+/* expand_tabs • copies a line with its tabs expanded, returning the bytes
+ * it takes, also when the buffer could not take them */
+static size_t expand_tabs(hoedown_buffer *ob, const uint8_t *line, size_t size)
 {
 	size_t  i = 0, tab = 0;
 
@@ -2695,12 +4153,142 @@ static void expand_tabs(hoedown_buffer *ob, const uint8_t *line, size_t size)
 
 		i++;
 	}
+
+	return tab;
+}
+
+/* pool_bytes • bytes held by the buffers of a pool, counting them */
+static size_t
+pool_bytes(hoedown_stack *pool, size_t *count)
+{
+	size_t i, bytes = 0;
+
+	*count = 0;
+	for (i = 0; i < pool->asize && pool->item[i]; ++i) {
+		bytes += sizeof(struct work_buf) + ((hoedown_buffer *)pool->item[i])->asize;
+		(*count)++;
+	}
+
+	return bytes;
+}
+
+/* refs_bytes • bytes held by the references and footnotes, counting them */
+static size_t
+refs_bytes(hoedown_markdown *md)
+{
+	struct link_ref *ref;
+	struct footnote_item *item;
+	size_t i, bytes = 0;
+
+	md->memory.refs = 0;
+	for (i = 0; i < REF_TABLE_SIZE; ++i) {
+		for (ref = md->refs[i]; ref; ref = ref->next) {
+			bytes += sizeof(struct link_ref);
+			if (ref->link)
+				bytes += sizeof(hoedown_buffer) + ref->link->asize;
+			if (ref->title)
+				bytes += sizeof(hoedown_buffer) + ref->title->asize;
+			md->memory.refs++;
+		}
+	}
+
+	if (!(md->ext_flags & HOEDOWN_EXT_FOOTNOTES))
+		return bytes;
+
+	md->memory.footnotes = md->footnotes_found.count;
+	for (item = md->footnotes_found.head; item; item = item->next) {
+		bytes += sizeof(struct footnote_item) + sizeof(struct footnote_ref);
+		if (item->ref->contents)
+			bytes += sizeof(hoedown_buffer) + item->ref->contents->asize;
+	}
+
+	return bytes;
+}
+
+/* start_usage • accounts a render from the buffers already held */
+static void
+start_usage(hoedown_markdown *md, hoedown_buffer *ob)
+{
+	size_t count;
+
+	memset(&md->usage, 0, sizeof(md->usage));
+	memset(&md->memory, 0, sizeof(md->memory));
+	md->usage.held = ob->asize +
+		pool_bytes(&md->work_bufs[BUFFER_BLOCK], &count) +
+		pool_bytes(&md->work_bufs[BUFFER_SPAN], &count);
+	md->usage.peak = md->usage.held;
+	md->usage.ob_asize = ob->asize;
+}
+
+/* end_text • frees the copy of the document, accounting for its growth */
+static void
+end_text(hoedown_markdown *md)
+{
+	usage_grown(md, &md->usage.text_asize, md->render_text->asize);
+	usage_sub(md, md->render_text->asize);
+	hoedown_buffer_free(md->render_text);
+	md->render_text = NULL;
+}
+
+/* end_usage • the memory of the render, once its buffers are given back */
+static void
+end_usage(hoedown_markdown *md)
+{
+	usage_grown(md, &md->usage.ob_asize, md->render_ob->asize);
+	md->render_ob = NULL;
+
+	md->memory.allocated = md->usage.allocated;
+	md->memory.peak = md->usage.peak;
+	md->memory.reallocs = md->usage.reallocs;
+	pool_bytes(&md->work_bufs[BUFFER_BLOCK], &md->memory.block_bufs);
+	pool_bytes(&md->work_bufs[BUFFER_SPAN], &md->memory.span_bufs);
 }
 
 /**********************
  * EXPORTED FUNCTIONS *
  **********************/
 
+/* set_active_chars • the chars starting the spans cb renders */
+static void
+set_active_chars(uint8_t *active_char, const hoedown_renderer *cb, unsigned int extensions)
+{
+	memset(active_char, 0x0, 256);
+
+	if (cb->emphasis || cb->double_emphasis || cb->triple_emphasis) {
+		active_char['*'] = MD_CHAR_EMPHASIS;
+		active_char['_'] = MD_CHAR_EMPHASIS;
+		if (extensions & HOEDOWN_EXT_STRIKETHROUGH)
+			active_char['~'] = MD_CHAR_EMPHASIS;
+		if (extensions & HOEDOWN_EXT_HIGHLIGHT)
+			active_char['='] = MD_CHAR_EMPHASIS;
+	}
+
+	if (cb->codespan)
+		active_char['`'] = MD_CHAR_CODESPAN;
+
+	if (cb->linebreak)
+		active_char['\n'] = MD_CHAR_LINEBREAK;
+
+	if (cb->image || cb->link)
+		active_char['['] = MD_CHAR_LINK;
+
+	active_char['<'] = MD_CHAR_LANGLE;
+	active_char['\\'] = MD_CHAR_ESCAPE;
+	active_char['&'] = MD_CHAR_ENTITITY;
+
+	if (extensions & HOEDOWN_EXT_AUTOLINK) {
+		active_char[':'] = MD_CHAR_AUTOLINK_URL;
+		active_char['@'] = MD_CHAR_AUTOLINK_EMAIL;
+		active_char['w'] = MD_CHAR_AUTOLINK_WWW;
+	}
+
+	if (extensions & HOEDOWN_EXT_SUPERSCRIPT)
+		active_char['^'] = MD_CHAR_SUPERSCRIPT;
+
+	if (extensions & HOEDOWN_EXT_QUOTE)
+		active_char['"'] = MD_CHAR_QUOTE;
+}
+
 hoedown_markdown *
 hoedown_markdown_new(
 	unsigned int extensions,
@@ -2720,66 +4308,76 @@ hoedown_markdown_new(
 	hoedown_stack_new(&md->work_bufs[BUFFER_BLOCK], 4);
 	hoedown_stack_new(&md->work_bufs[BUFFER_SPAN], 8);
 
-	memset(md->active_char, 0x0, 256);
-
-	if (md->md.emphasis || md->md.double_emphasis || md->md.triple_emphasis) {
-		md->active_char['*'] = MD_CHAR_EMPHASIS;
-		md->active_char['_'] = MD_CHAR_EMPHASIS;
-		if (extensions & HOEDOWN_EXT_STRIKETHROUGH)
-			md->active_char['~'] = MD_CHAR_EMPHASIS;
-		if (extensions & HOEDOWN_EXT_HIGHLIGHT)
-			md->active_char['='] = MD_CHAR_EMPHASIS;
-	}
-
-	if (md->md.codespan)
-		md->active_char['`'] = MD_CHAR_CODESPAN;
-
-	if (md->md.linebreak)
-		md->active_char['\n'] = MD_CHAR_LINEBREAK;
-
-	if (md->md.image || md->md.link)
-		md->active_char['['] = MD_CHAR_LINK;
-
-	md->active_char['<'] = MD_CHAR_LANGLE;
-	md->active_char['\\'] = MD_CHAR_ESCAPE;
-	md->active_char['&'] = MD_CHAR_ENTITITY;
-
-	if (extensions & HOEDOWN_EXT_AUTOLINK) {
-		md->active_char[':'] = MD_CHAR_AUTOLINK_URL;
-		md->active_char['@'] = MD_CHAR_AUTOLINK_EMAIL;
-		md->active_char['w'] = MD_CHAR_AUTOLINK_WWW;
-	}
-
-	if (extensions & HOEDOWN_EXT_SUPERSCRIPT)
-		md->active_char['^'] = MD_CHAR_SUPERSCRIPT;
-
-	if (extensions & HOEDOWN_EXT_QUOTE)
-		md->active_char['"'] = MD_CHAR_QUOTE;
+	set_active_chars(md->active_char, &md->md, extensions);
 
 	/* Extension data */
 	md->ext_flags = extensions;
 	md->max_nesting = max_nesting;
 	md->in_link_body = 0;
+	md->inline_memo = NULL;
+	md->block_memo = NULL;
+
+	md->max_work = 0;
+	md->cancel = NULL;
+	md->cancel_data = NULL;
+	md->status = HOEDOWN_RENDER_OK;
+	md->output = NULL;
+	md->output_data = NULL;
+	md->output_ob = NULL;
+	md->in_place = 0;
+	md->toc_ob = NULL;
+	md->in_toc = 0;
+
+	md->block_cache = NULL;
+	md->block_src = NULL;
+	md->render_text = NULL;
+	md->render_ob = NULL;
+	md->block_deps = 0;
+
+	memset(&md->usage, 0, sizeof(md->usage));
+	memset(&md->memory, 0, sizeof(md->memory));
+	md->retain_bufs = HOEDOWN_RETAIN_ALL;
+	md->retain_capacity = HOEDOWN_RETAIN_ALL;
+
+#ifdef HOEDOWN_STATS
+	stats_wrap(md);
+#endif
 
 	return md;
 }
 
-void
+/* render_failed • ends a render that cannot go on, with status */
+static int
+render_failed(hoedown_markdown *md, int status)
+{
+	hoedown_markdown_abort(md);
+	md->status = status;
+	return status;
+}
+
+int
 hoedown_markdown_render(hoedown_buffer *ob, const uint8_t *document, size_t doc_size, hoedown_markdown *md)
 {
 	static const uint8_t UTF8_BOM[] = {0xEF, 0xBB, 0xBF};
 
 	hoedown_buffer *text;
-	size_t beg, end;
+	size_t beg, end, ref_bytes, copied = 0;
 
 	int footnotes_enabled;
 
 	text = hoedown_buffer_new(64);
 	if (!text)
-		return;
+		return HOEDOWN_RENDER_ENOMEM;
 
-	/* Preallocate enough space for our buffer to avoid expanding while copying */
-	hoedown_buffer_grow(text, doc_size);
+	/* the output is accounted to the render while it lasts */
+	start_usage(md, ob);
+	md->render_text = text;
+	md->render_ob = ob;
+
+	/* reset the work accounting */
+	md->work = 0;
+	md->next_poll = 0;
+	md->status = HOEDOWN_RENDER_OK;
 
 	/* reset the references table */
 	memset(&md->refs, 0x0, REF_TABLE_SIZE * sizeof(void *));
@@ -2792,6 +4390,10 @@ hoedown_markdown_render(hoedown_buffer *ob, const uint8_t *document, size_t doc_
 		memset(&md->footnotes_used, 0x0, sizeof(md->footnotes_used));
 	}
 
+	/* Preallocate enough space for our buffer to avoid expanding while copying */
+	if (hoedown_buffer_grow(text, doc_size) < 0)
+		return render_failed(md, HOEDOWN_RENDER_ENOMEM);
+
 	/* first pass: looking for references, copying everything else */
 	beg = 0;
 
@@ -2812,50 +4414,218 @@ hoedown_markdown_render(hoedown_buffer *ob, const uint8_t *document, size_t doc_
 
 			/* adding the line body if present */
 			if (end > beg)
-				expand_tabs(text, document + beg, end - beg);
+				copied += expand_tabs(text, document + beg, end - beg);
 
 			while (end < doc_size && (document[end] == '\n' || document[end] == '\r')) {
 				/* add one \n per newline */
-				if (document[end] == '\n' || (end + 1 < doc_size && document[end + 1] != '\n'))
+				if (document[end] == '\n' || (end + 1 < doc_size && document[end + 1] != '\n')) {
 					hoedown_buffer_putc(text, '\n');
+					copied++;
+				}
 				end++;
 			}
 
 			beg = end;
 		}
 
+	/* expanded tabs can still take the copy past the largest buffer */
+	if (text->size != copied)
+		return render_failed(md, HOEDOWN_RENDER_ENOMEM);
+
+	ref_bytes = refs_bytes(md);
+	usage_add(md, ref_bytes);
+
 	/* pre-grow the output buffer to minimize allocations */
-	hoedown_buffer_grow(ob, text->size + (text->size >> 1));
+	md->output_ob = ob;
+	if (md->output)
+		hoedown_buffer_grow(ob, OUTPUT_CHUNK * 2);
+	else
+		hoedown_buffer_grow(ob, text->size + (text->size >> 1));
 
 	/* second pass: actual rendering */
 	if (md->md.doc_header)
 		md->md.doc_header(ob, md->md.opaque);
 
+	if (md->toc_ob) {
+		md->toc_ob->size = 0;
+		if (md->toc.doc_header)
+			md->toc.doc_header(md->toc_ob, md->toc.opaque);
+	}
+
 	if (text->size) {
 		/* adding a final newline if not already present */
 		if (text->data[text->size - 1] != '\n' &&  text->data[text->size - 1] != '\r')
 			hoedown_buffer_putc(text, '\n');
 
+		/* keys are taken from a copy: parsing rewrites blockquotes in place */
+		if (md->block_cache)
+			md->block_src = malloc(text->size);
+
+		if (md->block_src) {
+			memcpy(md->block_src, text->data, text->size);
+			usage_add(md, text->size);
+		}
+
 		parse_block(ob, md, text->data, text->size);
+
+		if (md->block_src)
+			usage_sub(md, text->size);
+
+		free(md->block_src);
+		md->block_src = NULL;
 	}
 	
 	/* footnotes */
-	if (footnotes_enabled)
+	if (footnotes_enabled && md->status == HOEDOWN_RENDER_OK)
 		parse_footnote_list(ob, md, &md->footnotes_used);
 
 	if (md->md.doc_footer)
 		md->md.doc_footer(ob, md->md.opaque);
 
+	if (md->toc_ob && md->toc.doc_footer)
+		md->toc.doc_footer(md->toc_ob, md->toc.opaque);
+
+	/* what a stopped render produced goes out too, unless output failed */
+	if (md->output && md->output_ob && ob->size) {
+		if (md->output(ob->data, ob->size, md->output_data))
+			md->status = HOEDOWN_RENDER_CANCELLED;
+		ob->size = 0;
+	}
+	md->output_ob = NULL;
+
 	/* clean-up */
-	hoedown_buffer_free(text);
+	end_text(md);
 	free_link_refs(md->refs);
 	if (footnotes_enabled) {
 		free_footnote_list(&md->footnotes_found, 1);
 		free_footnote_list(&md->footnotes_used, 0);
 	}
+	usage_sub(md, ref_bytes);
 
 	assert(md->work_bufs[BUFFER_SPAN].size == 0);
 	assert(md->work_bufs[BUFFER_BLOCK].size == 0);
+
+	hoedown_markdown_trim(md, md->retain_bufs, md->retain_capacity);
+	end_usage(md);
+
+	return md->status;
+}
+
+void
+hoedown_markdown_abort(hoedown_markdown *md)
+{
+	if (!md->render_text)
+		return;
+
+	/* a callback of the toc may have been left, with its callbacks in place */
+	if (md->in_toc)
+		swap_toc(md);
+
+	/* the work buffers in use are given back as they are */
+	while (md->work_bufs[BUFFER_SPAN].size)
+		popbuf(md, BUFFER_SPAN);
+	while (md->work_bufs[BUFFER_BLOCK].size)
+		popbuf(md, BUFFER_BLOCK);
+
+	end_text(md);
+	free_link_refs(md->refs);
+	if (md->ext_flags & HOEDOWN_EXT_FOOTNOTES) {
+		free_footnote_list(&md->footnotes_found, 1);
+		free_footnote_list(&md->footnotes_used, 0);
+	}
+	free(md->block_src);
+	md->block_src = NULL;
+
+	/* the memos lived on the stack that was left */
+	md->inline_memo = NULL;
+	md->block_memo = NULL;
+	md->in_link_body = 0;
+	md->in_place = 0;
+	md->output_ob = NULL;
+	md->status = HOEDOWN_RENDER_CANCELLED;
+
+	hoedown_markdown_trim(md, md->retain_bufs, md->retain_capacity);
+	end_usage(md);
+}
+
+void
+hoedown_markdown_set_work_budget(hoedown_markdown *md, size_t max_work)
+{
+	md->max_work = max_work;
+}
+
+size_t
+hoedown_markdown_work(const hoedown_markdown *md)
+{
+	return md->work;
+}
+
+void
+hoedown_markdown_set_cancel(hoedown_markdown *md, int (*cancel)(void *data), void *data)
+{
+	md->cancel = cancel;
+	md->cancel_data = data;
+}
+
+void
+hoedown_markdown_set_output(hoedown_markdown *md, int (*output)(const uint8_t *data, size_t size, void *opaque), void *opaque)
+{
+	md->output = output;
+	md->output_data = opaque;
+}
+
+void
+hoedown_markdown_set_toc(hoedown_markdown *md, const hoedown_renderer *toc, hoedown_buffer *toc_ob)
+{
+	md->toc_ob = toc ? toc_ob : NULL;
+	if (md->toc_ob) {
+		memcpy(&md->toc, toc, sizeof(hoedown_renderer));
+		set_active_chars(md->toc_active_char, toc, md->ext_flags);
+	}
+}
+
+void
+hoedown_markdown_set_block_cache(hoedown_markdown *md, hoedown_block_cache *cache)
+{
+	md->block_cache = cache;
+}
+
+const hoedown_stats *
+hoedown_markdown_stats(const hoedown_markdown *md)
+{
+#ifdef HOEDOWN_STATS
+	return &md->stats;
+#else
+	return NULL;
+#endif
+}
+
+void
+hoedown_markdown_reset_stats(hoedown_markdown *md)
+{
+#ifdef HOEDOWN_STATS
+	memset(&md->stats, 0, sizeof(md->stats));
+#endif
+}
+
+const hoedown_render_memory *
+hoedown_markdown_memory(const hoedown_markdown *md)
+{
+	return &md->memory;
+}
+
+void
+hoedown_markdown_set_retention(hoedown_markdown *md, size_t max_bufs, size_t max_capacity)
+{
+	md->retain_bufs = max_bufs;
+	md->retain_capacity = max_capacity;
+}
+
+void
+hoedown_markdown_trim(hoedown_markdown *md, size_t max_bufs, size_t max_capacity)
+{
+	trim_pool(md, &md->work_bufs[BUFFER_BLOCK], max_bufs, max_capacity);
+	trim_pool(md, &md->work_bufs[BUFFER_SPAN], max_bufs, max_capacity);
 }
 
 void
@@ -5,6 +5,7 @@
 
 #include "buffer.h"
 #include "autolink.h"
+#include "block_cache.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -34,6 +35,19 @@ enum hoedown_tableflags {
 	HOEDOWN_TABLE_HEADER = 4
 };
 
+/* hoedown_container - container blocks that can render in place */
+enum hoedown_container {
+	HOEDOWN_CONTAINER_BLOCKQUOTE,
+	HOEDOWN_CONTAINER_LIST,
+	HOEDOWN_CONTAINER_LISTITEM,
+	HOEDOWN_CONTAINER_TABLE,
+	HOEDOWN_CONTAINER_TABLE_HEADER,	/* inside a table, holds the header row */
+	HOEDOWN_CONTAINER_TABLE_BODY,	/* inside a table, holds the other rows */
+	HOEDOWN_CONTAINER_TABLE_ROW,
+	HOEDOWN_CONTAINER_FOOTNOTES,
+	HOEDOWN_CONTAINER_TABLE_CELL	/* inside a row, flags as for table_cell */
+};
+
 enum hoedown_extensions {
 	HOEDOWN_EXT_NO_INTRA_EMPHASIS = (1 << 0),
 	HOEDOWN_EXT_TABLES = (1 << 1),
@@ -47,7 +61,16 @@ enum hoedown_extensions {
 	HOEDOWN_EXT_DISABLE_INDENTED_CODE = (1 << 9),
 	HOEDOWN_EXT_HIGHLIGHT = (1 << 10),
 	HOEDOWN_EXT_FOOTNOTES = (1 << 11),
-	HOEDOWN_EXT_QUOTE = (1 << 12)
+	HOEDOWN_EXT_QUOTE = (1 << 12),
+	HOEDOWN_EXT_BOUNDED = (1 << 13)
+};
+
+/* hoedown_render_status - outcome of hoedown_markdown_render */
+enum hoedown_render_status {
+	HOEDOWN_RENDER_OK = 0,
+	HOEDOWN_RENDER_ENOMEM = -1,			/* the document could not be copied, as past 16MB with its tabs expanded */
+	HOEDOWN_RENDER_BUDGET_EXCEEDED = 1,	/* stopped by the work budget */
+	HOEDOWN_RENDER_CANCELLED = 2		/* stopped by the cancel or output callback */
 };
 
 /* hoedown_renderer - functions for rendering parsed data */
@@ -94,6 +117,14 @@ struct hoedown_renderer {
 
 	/* state object */
 	void *opaque;
+
+	/* in-place container callbacks - used by the containers whose callback
+	 * above is NULL: children render straight into ob between enter and
+	 * leave, content being the size of ob when enter returned, less the
+	 * bytes handed to the output callback since. after opaque, which keeps
+	 * its offset from older versions */
+	void (*container_enter)(hoedown_buffer *ob, enum hoedown_container type, int flags, void *opaque);
+	void (*container_leave)(hoedown_buffer *ob, enum hoedown_container type, int flags, size_t content, void *opaque);
 };
 
 typedef struct hoedown_renderer hoedown_renderer;
@@ -102,6 +133,73 @@ struct hoedown_markdown;
 
 typedef struct hoedown_markdown hoedown_markdown;
 
+/* hoedown_stats_block - the instrumented parse_* functions */
+enum hoedown_stats_block {
+	HOEDOWN_STATS_ATXHEADER,
+	HOEDOWN_STATS_HTMLBLOCK,	/* failed attempts included */
+	HOEDOWN_STATS_FENCEDCODE,	/* failed attempts included */
+	HOEDOWN_STATS_TABLE,		/* failed attempts included */
+	HOEDOWN_STATS_BLOCKQUOTE,
+	HOEDOWN_STATS_BLOCKCODE,
+	HOEDOWN_STATS_LIST,
+	HOEDOWN_STATS_PARAGRAPH,
+	HOEDOWN_STATS_INLINE,		/* parse_inline, the spans of every block */
+	HOEDOWN_STATS_BLOCKS
+};
+
+/* hoedown_stats_span - the char_* triggers of active chars */
+enum hoedown_stats_span {
+	HOEDOWN_STATS_EMPHASIS,
+	HOEDOWN_STATS_CODESPAN,
+	HOEDOWN_STATS_LINEBREAK,
+	HOEDOWN_STATS_LINK,
+	HOEDOWN_STATS_LANGLE,
+	HOEDOWN_STATS_ESCAPE,
+	HOEDOWN_STATS_ENTITY,
+	HOEDOWN_STATS_AUTOLINK_URL,
+	HOEDOWN_STATS_AUTOLINK_EMAIL,
+	HOEDOWN_STATS_AUTOLINK_WWW,
+	HOEDOWN_STATS_SUPERSCRIPT,
+	HOEDOWN_STATS_QUOTE,
+	HOEDOWN_STATS_SPANS
+};
+
+/* HOEDOWN_STATS_CALLBACKS: one counter per callback of hoedown_renderer, in order, opaque left out */
+#define HOEDOWN_STATS_CALLBACKS ((sizeof(hoedown_renderer) - sizeof(void *)) / sizeof(void (*)(void)))
+
+/* hoedown_stats_counter - calls of one function, what is inside included */
+struct hoedown_stats_counter {
+	uint64_t calls;
+	uint64_t bytes;		/* parsed by parse_* and char_*, written by callbacks */
+	uint64_t cycles;	/* time stamp counter, or nanoseconds without one */
+};
+
+/* hoedown_stats - counters of the renders of a hoedown_markdown */
+struct hoedown_stats {
+	struct hoedown_stats_counter block[HOEDOWN_STATS_BLOCKS];
+	struct hoedown_stats_counter span[HOEDOWN_STATS_SPANS];
+	struct hoedown_stats_counter callback[HOEDOWN_STATS_CALLBACKS];
+};
+
+typedef struct hoedown_stats hoedown_stats;
+
+/* hoedown_render_memory - memory taken by the last render */
+/*	bytes are those of the work buffers, the output buffer, the copy of
+ *	the document, references and footnotes; the renderer's own
+ *	allocations are left out. the parser looks at the buffers when it
+ *	gives back a work buffer, without hooking hoedown_buffer_grow */
+struct hoedown_render_memory {
+	size_t allocated;	/* bytes obtained during the render */
+	size_t peak;		/* most bytes held at once, pooled work buffers included */
+	size_t reallocs;	/* growths of the buffers, once per use of a work buffer */
+	size_t block_bufs;	/* work buffers pooled for blocks, after the render */
+	size_t span_bufs;	/* same for spans */
+	size_t refs;		/* link references defined */
+	size_t footnotes;	/* footnotes defined */
+};
+
+typedef struct hoedown_render_memory hoedown_render_memory;
+
 /*********
  * FLAGS *
  *********/
@@ -120,9 +218,95 @@ hoedown_markdown_new(
 	size_t max_nesting,
 	const hoedown_renderer *renderer);
 
-extern void
+/* hoedown_markdown_render: renders a document, returns a hoedown_render_status */
+/*	a render stopped early leaves the output it produced so far in ob */
+extern int
 hoedown_markdown_render(hoedown_buffer *ob, const uint8_t *document, size_t doc_size, hoedown_markdown *md);
 
+/* hoedown_markdown_abort: ends a render left by a longjmp out of a callback */
+/*	frees what the render held and makes md ready for the next one; ob
+ *	is left to the caller, with what was written to it. does nothing when
+ *	no render was left */
+extern void
+hoedown_markdown_abort(hoedown_markdown *md);
+
+/* hoedown_markdown_set_work_budget: limits the work of each render, 0 for no limit */
+/*	one unit is roughly one byte parsed at one nesting level, or one
+ *	active char looked at; without HOEDOWN_EXT_BOUNDED a single look-ahead
+ *	may scan far beyond the point where the budget runs out */
+extern void
+hoedown_markdown_set_work_budget(hoedown_markdown *md, size_t max_work);
+
+/* hoedown_markdown_work: units of work spent by the last render */
+/*	up to where it stopped, for one stopped early */
+extern size_t
+hoedown_markdown_work(const hoedown_markdown *md);
+
+/* hoedown_markdown_set_cancel: installs a callback polled while rendering */
+/*	the render stops when it returns non-zero; NULL removes it */
+extern void
+hoedown_markdown_set_cancel(hoedown_markdown *md, int (*cancel)(void *data), void *data);
+
+/* hoedown_markdown_set_output: hands the output over while rendering */
+/*	once the top level output holds a few kilobytes, output is called
+ *	with all of it but its last character at the end of each top level
+ *	block and of each row of a top level table rendered in place, and
+ *	with the rest at the end of the render, which leaves ob empty. the
+ *	output then takes memory for a block or a row, not the document. a
+ *	non-zero return stops the render as cancelled. bytes are only handed
+ *	over at the end with a block cache; NULL removes it */
+extern void
+hoedown_markdown_set_output(hoedown_markdown *md, int (*output)(const uint8_t *data, size_t size, void *opaque), void *opaque);
+
+/* hoedown_markdown_set_toc: renders the headers with toc as well, into toc_ob */
+/*	toc is a renderer writing its headers only, such as the one of
+ *	hoedown_html_toc_renderer_new. the text of each header is parsed again
+ *	with the span callbacks of toc and given to its header callback; the
+ *	blocks are parsed once, for md, and the other block callbacks of toc
+ *	are not called. toc_ob is emptied when a render starts, and ends up
+ *	with what a render with toc alone would give, as long as both set a
+ *	blockhtml callback or neither does. toc is copied, its opaque must
+ *	outlive md; NULL removes it */
+extern void
+hoedown_markdown_set_toc(hoedown_markdown *md, const hoedown_renderer *toc, hoedown_buffer *toc_ob);
+
+/* hoedown_markdown_set_block_cache: reuses the output of top level blocks */
+/*	the output of a block whose source and following lines were rendered
+ *	before is copied from cache instead of parsed again; blocks looking up
+ *	references or footnotes, headers and HTML blocks are always parsed.
+ *	the renderer must render a block the same way whatever came before it,
+ *	but for the separation from earlier output; NULL removes it */
+extern void
+hoedown_markdown_set_block_cache(hoedown_markdown *md, hoedown_block_cache *cache);
+
+/* hoedown_markdown_stats: counters of the renders so far */
+/*	NULL unless the library is built with HOEDOWN_STATS defined, which
+ *	wraps each callback of the renderer and times parse functions */
+extern const hoedown_stats *
+hoedown_markdown_stats(const hoedown_markdown *md);
+
+extern void
+hoedown_markdown_reset_stats(hoedown_markdown *md);
+
+/* hoedown_markdown_memory: memory taken by the last render */
+extern const hoedown_render_memory *
+hoedown_markdown_memory(const hoedown_markdown *md);
+
+/* HOEDOWN_RETAIN_ALL: no bound on the work buffers kept between renders */
+#define HOEDOWN_RETAIN_ALL ((size_t)-1)
+
+/* hoedown_markdown_set_retention: bounds the work buffers kept after each render */
+/*	each of the block and span pools keeps its first max_bufs buffers,
+ *	shrinking those that grew past max_capacity bytes. both default to
+ *	HOEDOWN_RETAIN_ALL, keeping every buffer at the size it reached */
+extern void
+hoedown_markdown_set_retention(hoedown_markdown *md, size_t max_bufs, size_t max_capacity);
+
+/* hoedown_markdown_trim: applies the same bounds once, outside of a render */
+/*	hoedown_markdown_trim(md, 0, 0) frees every pooled buffer */
+extern void
+hoedown_markdown_trim(hoedown_markdown *md, size_t max_bufs, size_t max_capacity);
+
 extern void
 hoedown_markdown_free(hoedown_markdown *md);
 
@@ -0,0 +1,357 @@
+/* bench.c - cycles per byte of single kernels on synthetic inputs */
+
+/* the parser's static functions are benchmarked in place */
+#include "markdown.c"
+
+#include "autolink.h"
+#include "escape.h"
+#include "html.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <x86intrin.h>
+#define CLOCK_UNIT "cycles"
+#else
+#include <time.h>
+#define CLOCK_UNIT "ns"
+#endif
+
+#define DEF_SIZE 65536
+#define DEF_REPS 15
+#define DEF_WARMUP 3
+#define REP_BYTES (1 << 22)	/* bytes processed per repetition */
+
+/* bench_clock • cycles, or nanoseconds where there is no cycle counter */
+static uint64_t
+bench_clock(void)
+{
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+	return __rdtsc();
+#else
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+#endif
+}
+
+/* the densities, fractions of bytes or words, of the synthetic inputs */
+struct densities {
+	double escape;	/* bytes escaped by the HTML and href escapers */
+	double links;	/* words that are links */
+	double quotes;	/* words with smartypants punctuation */
+	double tabs;	/* bytes that are tabs */
+};
+
+static uint64_t rng = 0x9E3779B97F4A7C15ULL;
+
+/* uniform • a number in [0, 1) */
+static double
+uniform(void)
+{
+	rng ^= rng >> 12;
+	rng ^= rng << 25;
+	rng ^= rng >> 27;
+	return (double)((rng * 0x2545F4914F6CDD1DULL) >> 11) / (double)(1ULL << 53);
+}
+
+static const char *
+pick(const char **list, size_t n)
+{
+	return list[(size_t)(uniform() * n)];
+}
+
+static const char *words[] = {
+	"the", "parser", "renders", "a", "document", "with", "some", "text", "and",
+	"buffer", "output", "input", "block", "span", "list", "item", "markdown"
+};
+
+#define WORD() pick(words, sizeof(words) / sizeof(words[0]))
+
+/* gen_escape • words, with special chars of the escapers at density */
+static void
+gen_escape(hoedown_buffer *ib, size_t size, const struct densities *d)
+{
+	static const char *specials[] = { "<", ">", "&", "\"", "'", "/", " ", "%", "\xC3\xA9" };
+
+	while (ib->size < size) {
+		if (uniform() < d->escape)
+			hoedown_buffer_puts(ib, pick(specials, sizeof(specials) / sizeof(specials[0])));
+		else
+			hoedown_buffer_putc(ib, 'a' + (uint8_t)(uniform() * 26));
+	}
+}
+
+/* gen_inline • a paragraph of words, links and some emphasis */
+static void
+gen_inline(hoedown_buffer *ib, size_t size, const struct densities *d)
+{
+	while (ib->size < size) {
+		double r = uniform();
+
+		if (r < d->links)
+			hoedown_buffer_printf(ib, "[%s](https://example.com/%s) ", WORD(), WORD());
+		else if (r < d->links + d->escape)
+			hoedown_buffer_printf(ib, "*%s* & `%s` ", WORD(), WORD());
+		else
+			hoedown_buffer_printf(ib, "%s ", WORD());
+	}
+}
+
+/* gen_smartypants • words, some quoted or followed by dashes and ellipses */
+static void
+gen_smartypants(hoedown_buffer *ib, size_t size, const struct densities *d)
+{
+	static const char *forms[] = { "\"%s\" ", "'%s' ", "%s's ", "%s -- ", "%s... ", "(c) %s ", "%s 1/2 " };
+
+	while (ib->size < size) {
+		if (uniform() < d->quotes)
+			hoedown_buffer_printf(ib, pick(forms, sizeof(forms) / sizeof(forms[0])), WORD());
+		else
+			hoedown_buffer_printf(ib, "%s ", WORD());
+	}
+}
+
+/* gen_tabs • a line of text, with tabs at density */
+static void
+gen_tabs(hoedown_buffer *ib, size_t size, const struct densities *d)
+{
+	while (ib->size < size)
+		hoedown_buffer_putc(ib, uniform() < d->tabs ? '\t' : 'a' + (uint8_t)(uniform() * 26));
+}
+
+/* gen_autolink • words, with bare URLs at density */
+static void
+gen_autolink(hoedown_buffer *ib, size_t size, const struct densities *d)
+{
+	while (ib->size < size) {
+		if (uniform() < d->links)
+			hoedown_buffer_printf(ib, "https://example.com/%s/%s?q=%s ", WORD(), WORD(), WORD());
+		else
+			hoedown_buffer_printf(ib, "%s ", WORD());
+	}
+}
+
+/* gen_table • a table of four columns, with links in cells at density */
+static void
+gen_table(hoedown_buffer *ib, size_t size, const struct densities *d)
+{
+	int col;
+
+	hoedown_buffer_puts(ib, "| a | b | c | d |\n|---|:--|:-:|--:|\n");
+	while (ib->size < size) {
+		for (col = 0; col < 4; ++col) {
+			if (uniform() < d->links)
+				hoedown_buffer_printf(ib, "| [%s](/%s) ", WORD(), WORD());
+			else
+				hoedown_buffer_printf(ib, "| %s %s ", WORD(), WORD());
+		}
+		hoedown_buffer_puts(ib, "|\n");
+	}
+}
+
+/* gen_fencedcode • a fenced code block of indented lines, with special
+ * chars of the HTML escaper at density */
+static void
+gen_fencedcode(hoedown_buffer *ib, size_t size, const struct densities *d)
+{
+	hoedown_buffer_puts(ib, "```c\n");
+	while (ib->size < size) {
+		hoedown_buffer_printf(ib, "%*s%s(%s);", (int)(uniform() * 4) * 4, "", WORD(), WORD());
+		if (uniform() < d->escape * 4)
+			hoedown_buffer_printf(ib, " /* %s < %s && \"%s\" */", WORD(), WORD(), WORD());
+		hoedown_buffer_putc(ib, '\n');
+	}
+	hoedown_buffer_puts(ib, "```\n");
+}
+
+/* kernel runs, from run_* below, get the input and a scratch output */
+struct kernel {
+	const char *name;
+	void (*generate)(hoedown_buffer *ib, size_t size, const struct densities *d);
+	void (*run)(hoedown_buffer *ob, hoedown_buffer *ib, hoedown_markdown *md);
+};
+
+static void
+run_escape_html(hoedown_buffer *ob, hoedown_buffer *ib, hoedown_markdown *md)
+{
+	hoedown_escape_html(ob, ib->data, ib->size, 0);
+}
+
+static void
+run_escape_href(hoedown_buffer *ob, hoedown_buffer *ib, hoedown_markdown *md)
+{
+	hoedown_escape_href(ob, ib->data, ib->size);
+}
+
+static void
+run_parse_inline(hoedown_buffer *ob, hoedown_buffer *ib, hoedown_markdown *md)
+{
+	parse_inline(ob, md, ib->data, ib->size);
+}
+
+static void
+run_parse_table(hoedown_buffer *ob, hoedown_buffer *ib, hoedown_markdown *md)
+{
+	parse_table(ob, md, ib->data, ib->size);
+}
+
+static void
+run_parse_fencedcode(hoedown_buffer *ob, hoedown_buffer *ib, hoedown_markdown *md)
+{
+	parse_fencedcode(ob, md, ib->data, ib->size);
+}
+
+static void
+run_smartypants(hoedown_buffer *ob, hoedown_buffer *ib, hoedown_markdown *md)
+{
+	hoedown_html_smartypants(ob, ib->data, ib->size);
+}
+
+/* run_smartypants_text • the buffered conversion of HOEDOWN_HTML_SMARTYPANTS */
+static void
+run_smartypants_text(hoedown_buffer *ob, hoedown_buffer *ib, hoedown_markdown *md)
+{
+	hoedown_html_smartypants_data smrt = { 0 };
+	hoedown_html_smartypants_text(ob, ib->data, ib->size, &smrt);
+	hoedown_html_smartypants_flush(&smrt);
+}
+
+static void
+run_expand_tabs(hoedown_buffer *ob, hoedown_buffer *ib, hoedown_markdown *md)
+{
+	expand_tabs(ob, ib->data, ib->size);
+}
+
+/* run_autolink_url • the URL trigger, at each ':' of the input */
+static void
+run_autolink_url(hoedown_buffer *ob, hoedown_buffer *ib, hoedown_markdown *md)
+{
+	uint8_t *colon, *end = ib->data + ib->size;
+	size_t rewind;
+
+	for (colon = ib->data; (colon = memchr(colon, ':', end - colon)) != NULL; colon++) {
+		ob->size = 0;
+		hoedown_autolink__url(&rewind, ob, colon, colon - ib->data, end - colon, 0);
+	}
+}
+
+static const struct kernel kernels[] = {
+	{ "escape_html",	gen_escape,			run_escape_html },
+	{ "escape_href",	gen_escape,			run_escape_href },
+	{ "parse_inline",	gen_inline,			run_parse_inline },
+	{ "parse_table",	gen_table,			run_parse_table },
+	{ "parse_fencedcode", gen_fencedcode,	run_parse_fencedcode },
+	{ "smartypants",	gen_smartypants,	run_smartypants },
+	{ "smartypants_text", gen_smartypants,	run_smartypants_text },
+	{ "expand_tabs",	gen_tabs,			run_expand_tabs },
+	{ "autolink_url",	gen_autolink,		run_autolink_url },
+	{ NULL, NULL, NULL }
+};
+
+static int
+cmp_double(const void *a, const void *b)
+{
+	double x = *(const double *)a, y = *(const double *)b;
+	return x < y ? -1 : x > y;
+}
+
+int
+main(int argc, char **argv)
+{
+	struct densities d = { 0.05, 0.05, 0.05, 0.05 };
+	size_t size = DEF_SIZE, reps = DEF_REPS, warmup = DEF_WARMUP, iters, r, n;
+	const char *only = NULL;
+	hoedown_renderer *renderer;
+	hoedown_markdown *md;
+	hoedown_buffer *ib, *ob;
+	double *samples, mean, var;
+	int argerr = 0, i;
+
+	/* parsing the command line */
+	for (i = 1; i < argc; ++i) {
+		if (strncmp(argv[i], "--kernel=", 9) == 0)
+			only = argv[i] + 9;
+		else if (strncmp(argv[i], "--size=", 7) == 0)
+			size = (size_t)strtoul(argv[i] + 7, NULL, 10);
+		else if (strncmp(argv[i], "--reps=", 7) == 0)
+			reps = (size_t)strtoul(argv[i] + 7, NULL, 10);
+		else if (strncmp(argv[i], "--warmup=", 9) == 0)
+			warmup = (size_t)strtoul(argv[i] + 9, NULL, 10);
+		else if (strncmp(argv[i], "--escape=", 9) == 0)
+			d.escape = strtod(argv[i] + 9, NULL);
+		else if (strncmp(argv[i], "--links=", 8) == 0)
+			d.links = strtod(argv[i] + 8, NULL);
+		else if (strncmp(argv[i], "--quotes=", 9) == 0)
+			d.quotes = strtod(argv[i] + 9, NULL);
+		else if (strncmp(argv[i], "--tabs=", 7) == 0)
+			d.tabs = strtod(argv[i] + 7, NULL);
+		else
+			argerr = 1;
+	}
+
+	if (argerr || !size || !reps) {
+		fprintf(stderr, "Usage: %s [--kernel=NAME] [--size=BYTES] [--reps=N] [--warmup=N]\n"
+			"\t[--escape=DENSITY] [--links=DENSITY] [--quotes=DENSITY] [--tabs=DENSITY]\n", argv[0]);
+		return 2;
+	}
+
+	ib = hoedown_buffer_new(size);
+	ob = hoedown_buffer_new(size);
+	samples = malloc(reps * sizeof(double));
+	renderer = hoedown_html_renderer_new(0, 0);
+	md = hoedown_markdown_new(0, 16, renderer);
+	memset(md->refs, 0, sizeof(md->refs));
+
+	/* each repetition runs a kernel over REP_BYTES of input, at least once */
+	iters = size < REP_BYTES ? REP_BYTES / size : 1;
+
+	printf("%-17s %10s %10s %10s %10s  (%s/byte, %u reps of %u runs on %u bytes)\n", "kernel",
+		"min", "median", "mean", "stddev", CLOCK_UNIT, (unsigned)reps, (unsigned)iters, (unsigned)size);
+
+	for (i = 0; kernels[i].name; ++i) {
+		const struct kernel *k = &kernels[i];
+
+		if (only && strcmp(only, k->name) != 0)
+			continue;
+
+		ib->size = 0;
+		k->generate(ib, size, &d);
+
+		for (r = 0; r < warmup; ++r) {
+			ob->size = 0;
+			k->run(ob, ib, md);
+		}
+
+		mean = 0;
+		for (r = 0; r < reps; ++r) {
+			uint64_t start = bench_clock();
+			for (n = 0; n < iters; ++n) {
+				ob->size = 0;
+				k->run(ob, ib, md);
+			}
+			samples[r] = (double)(bench_clock() - start) / ((double)iters * ib->size);
+			mean += samples[r];
+		}
+		mean /= reps;
+
+		var = 0;
+		for (r = 0; r < reps; ++r)
+			var += (samples[r] - mean) * (samples[r] - mean);
+		var /= reps;
+
+		qsort(samples, reps, sizeof(double), cmp_double);
+		printf("%-17s %10.3f %10.3f %10.3f %10.3f\n", k->name,
+			samples[0], samples[reps / 2], mean, sqrt(var));
+	}
+
+	hoedown_markdown_free(md);
+	hoedown_html_renderer_free(renderer);
+	hoedown_buffer_free(ib);
+	hoedown_buffer_free(ob);
+	free(samples);
+	return 0;
+}
@@ -0,0 +1,505 @@
+/* benchmark.c - throughput of the parser on generated corpora */
+
+#include "markdown.h"
+#include "html.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define DEF_TIME 0.5
+#define MAX_NESTING 16
+
+/* the extensions most renders use; --bounded adds HOEDOWN_EXT_BOUNDED */
+#define ALL_EXTENSIONS (\
+	HOEDOWN_EXT_NO_INTRA_EMPHASIS | HOEDOWN_EXT_TABLES | HOEDOWN_EXT_FENCED_CODE |\
+	HOEDOWN_EXT_AUTOLINK | HOEDOWN_EXT_STRIKETHROUGH | HOEDOWN_EXT_SUPERSCRIPT |\
+	HOEDOWN_EXT_FOOTNOTES)
+
+/*******************
+ * RANDOM DOCUMENTS *
+ *******************/
+
+static uint64_t rng;
+
+/* rnd • xorshift64*, a number below n */
+static size_t
+rnd(size_t n)
+{
+	rng ^= rng >> 12;
+	rng ^= rng << 25;
+	rng ^= rng >> 27;
+	return (size_t)((rng * 0x2545F4914F6CDD1DULL) >> 33) % n;
+}
+
+/* range • a number from lo to hi included */
+static size_t
+range(size_t lo, size_t hi)
+{
+	return lo + rnd(hi - lo + 1);
+}
+
+/* chance • true pct times out of a hundred */
+static int
+chance(size_t pct)
+{
+	return rnd(100) < pct;
+}
+
+static const char *words[] = {
+	"the", "parser", "renders", "a", "document", "with", "some", "text", "and",
+	"of", "to", "in", "is", "that", "for", "it", "as", "on", "be", "at", "by",
+	"this", "from", "or", "an", "are", "which", "buffer", "output", "input",
+	"block", "span", "list", "item", "table", "header", "cell", "quote", "code",
+	"link", "image", "reference", "footnote", "markdown", "option", "value",
+	"returns", "calls", "uses", "keeps", "sets", "reads", "writes", "handles",
+	"should", "could", "would", "version", "release", "change", "fixes", "adds",
+	"removes", "server", "client", "request", "response", "worker", "memory"
+};
+
+#define WORDS (sizeof(words) / sizeof(words[0]))
+
+static const char *
+word(void)
+{
+	return words[rnd(WORDS)];
+}
+
+/* put_words • n words of running text, markup taking pct of them */
+static void
+put_words(hoedown_buffer *ob, size_t n, size_t pct, int wrap)
+{
+	size_t i;
+
+	for (i = 0; i < n; ++i) {
+		if (i > 0)
+			hoedown_buffer_putc(ob, wrap && i % 12 == 0 ? '\n' : ' ');
+
+		if (!chance(pct)) {
+			hoedown_buffer_puts(ob, word());
+			continue;
+		}
+
+		switch (rnd(9)) {
+		case 0: hoedown_buffer_printf(ob, "*%s*", word()); break;
+		case 1: hoedown_buffer_printf(ob, "**%s %s**", word(), word()); break;
+		case 2: hoedown_buffer_printf(ob, "`%s(%s)`", word(), word()); break;
+		case 3: hoedown_buffer_printf(ob, "[%s %s](https://example.com/%s)", word(), word(), word()); break;
+		case 4: hoedown_buffer_printf(ob, "<https://example.org/%s/%u>", word(), (unsigned)rnd(1000)); break;
+		case 5: hoedown_buffer_printf(ob, "%s & %s", word(), word()); break;
+		case 6: hoedown_buffer_printf(ob, "\"%s\"", word()); break;
+		case 7: hoedown_buffer_printf(ob, "%s_%s", word(), word()); break;
+		default: hoedown_buffer_printf(ob, "~~%s~~", word()); break;
+		}
+	}
+}
+
+static void
+put_paragraph(hoedown_buffer *ob, size_t n, size_t pct)
+{
+	put_words(ob, n, pct, 1);
+	HOEDOWN_BUFPUTSL(ob, ".\n\n");
+}
+
+static void
+put_list(hoedown_buffer *ob, size_t items, size_t pct)
+{
+	size_t i;
+	int ordered = chance(30);
+
+	for (i = 0; i < items; ++i) {
+		if (ordered)
+			hoedown_buffer_printf(ob, "%u. ", (unsigned)(i + 1));
+		else
+			HOEDOWN_BUFPUTSL(ob, "* ");
+		put_words(ob, range(3, 20), pct, 0);
+		hoedown_buffer_putc(ob, '\n');
+	}
+	hoedown_buffer_putc(ob, '\n');
+}
+
+static void
+put_code(hoedown_buffer *ob, size_t lines, int fenced)
+{
+	static const char *langs[] = { "c", "perl", "sh", "json", "" };
+	size_t i;
+
+	if (fenced)
+		hoedown_buffer_printf(ob, "```%s\n", langs[rnd(5)]);
+
+	for (i = 0; i < lines; ++i) {
+		if (!fenced)
+			HOEDOWN_BUFPUTSL(ob, "    ");
+		hoedown_buffer_printf(ob, "%*s", (int)(rnd(4) * 4), "");
+		switch (rnd(4)) {
+		case 0: hoedown_buffer_printf(ob, "if (%s < %s && %s > 0) {\n", word(), word(), word()); break;
+		case 1: hoedown_buffer_printf(ob, "my $%s = <%s> || \"%s\";\n", word(), word(), word()); break;
+		case 2: hoedown_buffer_printf(ob, "%s(&%s, %u);\n", word(), word(), (unsigned)rnd(100)); break;
+		default: hoedown_buffer_printf(ob, "}\t# %s %s\n", word(), word()); break;
+		}
+	}
+
+	HOEDOWN_BUFPUTSL(ob, fenced ? "```\n\n" : "\n");
+}
+
+static void
+put_table(hoedown_buffer *ob, size_t cols, size_t rows)
+{
+	static const char *aligns[] = { "---", ":--", "--:", ":-:" };
+	size_t r, c;
+
+	for (c = 0; c < cols; ++c)
+		hoedown_buffer_printf(ob, "| %s %s ", word(), word());
+	HOEDOWN_BUFPUTSL(ob, "|\n");
+	for (c = 0; c < cols; ++c)
+		hoedown_buffer_printf(ob, "|%s", aligns[rnd(4)]);
+	HOEDOWN_BUFPUTSL(ob, "|\n");
+
+	for (r = 0; r < rows; ++r) {
+		for (c = 0; c < cols; ++c) {
+			HOEDOWN_BUFPUTSL(ob, "| ");
+			switch (rnd(4)) {
+			case 0: hoedown_buffer_printf(ob, "%u", (unsigned)rnd(100000)); break;
+			case 1: hoedown_buffer_printf(ob, "`%s`", word()); break;
+			default: put_words(ob, range(1, 4), 10, 0); break;
+			}
+			hoedown_buffer_putc(ob, ' ');
+		}
+		HOEDOWN_BUFPUTSL(ob, "|\n");
+	}
+	hoedown_buffer_putc(ob, '\n');
+}
+
+/* put_prefixed • appends block with prefix before its first line and
+ * indent before the others */
+static void
+put_prefixed(hoedown_buffer *ob, const hoedown_buffer *block, const char *prefix, const char *indent)
+{
+	size_t i = 0, end;
+
+	while (i < block->size) {
+		for (end = i; end < block->size && block->data[end] != '\n'; end++);
+		if (end > i)
+			hoedown_buffer_puts(ob, i == 0 ? prefix : indent);
+		else if (indent[0] == '>')
+			hoedown_buffer_putc(ob, '>');
+		hoedown_buffer_put(ob, block->data + i, end - i);
+		hoedown_buffer_putc(ob, '\n');
+		i = end + 1;
+	}
+}
+
+/* put_nested • lists and quotes inside each other, depth levels down */
+static void
+put_nested(hoedown_buffer *ob, size_t depth)
+{
+	size_t i, items = range(1, 4);
+	hoedown_buffer *inner;
+
+	for (i = 0; i < items; ++i) {
+		inner = hoedown_buffer_new(256);
+		put_words(inner, range(3, 15), 15, 0);
+		HOEDOWN_BUFPUTSL(inner, "\n\n");
+		if (depth > 0 && chance(60))
+			put_nested(inner, depth - 1);
+
+		if (chance(30))
+			put_prefixed(ob, inner, "> ", "> ");
+		else
+			put_prefixed(ob, inner, "* ", "    ");
+		hoedown_buffer_putc(ob, '\n');
+		hoedown_buffer_free(inner);
+	}
+}
+
+/* corpus • documents of one kind */
+struct corpus {
+	const char *name;
+	uint64_t seed;
+	size_t docs;
+	void (*generate)(hoedown_buffer *ob, size_t i);
+};
+
+/* gen_comment • a few sentences, as left under an issue */
+static void
+gen_comment(hoedown_buffer *ob, size_t i)
+{
+	size_t n = range(1, 3);
+
+	if (chance(15)) {
+		HOEDOWN_BUFPUTSL(ob, "> ");
+		put_words(ob, range(5, 20), 5, 0);
+		HOEDOWN_BUFPUTSL(ob, "\n\n");
+	}
+	while (n--)
+		put_paragraph(ob, range(5, 40), 8);
+}
+
+/* gen_readme • sections of prose, lists, code and the odd table */
+static void
+gen_readme(hoedown_buffer *ob, size_t i)
+{
+	size_t s, sections = range(8, 16);
+
+	hoedown_buffer_printf(ob, "# %s-%s\n\n", word(), word());
+	put_paragraph(ob, range(30, 80), 6);
+
+	for (s = 0; s < sections; ++s) {
+		hoedown_buffer_printf(ob, "## %s %s\n\n", word(), word());
+		put_paragraph(ob, range(20, 120), 6);
+		if (chance(50))
+			put_list(ob, range(3, 8), 10);
+		if (chance(50))
+			put_code(ob, range(4, 20), 1);
+		if (chance(40))
+			put_paragraph(ob, range(20, 80), 6);
+		if (chance(10))
+			put_table(ob, range(2, 4), range(2, 6));
+	}
+}
+
+/* gen_changelog • releases listing changes, most of them with links */
+static void
+gen_changelog(hoedown_buffer *ob, size_t i)
+{
+	size_t r, c, releases = range(30, 60), refs = 0;
+
+	HOEDOWN_BUFPUTSL(ob, "# Changes\n\n");
+	for (r = 0; r < releases; ++r) {
+		hoedown_buffer_printf(ob, "## [%u.%u.%u] - 20%02u-%02u-%02u\n\n", (unsigned)(releases - r),
+			(unsigned)rnd(10), (unsigned)rnd(20), (unsigned)range(10, 24), (unsigned)range(1, 12), (unsigned)range(1, 28));
+		for (c = range(3, 10); c > 0; --c) {
+			HOEDOWN_BUFPUTSL(ob, "- ");
+			put_words(ob, range(4, 14), 10, 0);
+			switch (rnd(4)) {
+			case 0: hoedown_buffer_printf(ob, " ([#%u](https://github.com/o/r/issues/%u))", (unsigned)rnd(5000), (unsigned)rnd(5000)); break;
+			case 1: hoedown_buffer_printf(ob, " [%s][ref-%u]", word(), (unsigned)refs++); break;
+			case 2: hoedown_buffer_printf(ob, " see www.example.com/%s", word()); break;
+			default: hoedown_buffer_printf(ob, " by [@%s](https://github.com/%s)", word(), word()); break;
+			}
+			hoedown_buffer_putc(ob, '\n');
+		}
+		hoedown_buffer_putc(ob, '\n');
+	}
+
+	for (r = 0; r < refs; ++r)
+		hoedown_buffer_printf(ob, "[ref-%u]: https://example.com/compare/%u...%u \"%s\"\n", (unsigned)r, (unsigned)r, (unsigned)(r + 1), word());
+}
+
+/* gen_spec • tables with a few lines of prose in between */
+static void
+gen_spec(hoedown_buffer *ob, size_t i)
+{
+	size_t t, tables = range(3, 8);
+
+	for (t = 0; t < tables; ++t) {
+		hoedown_buffer_printf(ob, "### %s %s\n\n", word(), word());
+		put_paragraph(ob, range(10, 40), 6);
+		put_table(ob, range(3, 8), range(10, 60));
+	}
+}
+
+/* gen_nested • lists and quotes nested deep */
+static void
+gen_nested(hoedown_buffer *ob, size_t i)
+{
+	size_t n = range(2, 5);
+
+	while (n--)
+		put_nested(ob, range(3, 7));
+}
+
+/* gen_code • code blocks with some prose around */
+static void
+gen_code(hoedown_buffer *ob, size_t i)
+{
+	size_t b, blocks = range(6, 14);
+
+	for (b = 0; b < blocks; ++b) {
+		put_paragraph(ob, range(10, 50), 20);
+		put_code(ob, range(5, 40), chance(70));
+	}
+}
+
+/* gen_pathological • a shape adversarial to the parser, repeated */
+static void
+gen_pathological(hoedown_buffer *ob, size_t i)
+{
+	static const char *units[][2] = {
+		{ "[", "" }, { "[", "]" }, { "[a](", "" }, { "*a ", "" }, { "**a ", "" },
+		{ "`", "" }, { "<a ", "" }, { "a@", "" }, { ">", "" }, { "* a\n", "" },
+		{ "|", "" }, { "~~a ", "" }
+	};
+	const char **unit = units[i % (sizeof(units) / sizeof(units[0]))];
+	size_t n, per = strlen(unit[0]) + strlen(unit[1]);
+
+	for (n = 16384 / per; n > 0; --n)
+		hoedown_buffer_puts(ob, unit[0]);
+	hoedown_buffer_puts(ob, "a\n");
+	for (n = 16384 / per; n > 0 && unit[1][0]; --n)
+		hoedown_buffer_puts(ob, unit[1]);
+}
+
+static const struct corpus corpora[] = {
+	{ "comments",		1, 2000, gen_comment },
+	{ "readmes",		2, 40, gen_readme },
+	{ "changelogs",		3, 30, gen_changelog },
+	{ "specs",			4, 30, gen_spec },
+	{ "nested",			5, 100, gen_nested },
+	{ "code",			6, 40, gen_code },
+	{ "pathological",	7, 12, gen_pathological },
+	{ NULL, 0, 0, NULL }
+};
+
+/*************
+ * BENCHMARK *
+ *************/
+
+/* generate • the documents of a corpus, the same ones on every run */
+static hoedown_buffer **
+generate(const struct corpus *c, size_t *bytes)
+{
+	hoedown_buffer **docs = calloc(c->docs, sizeof(hoedown_buffer *));
+	size_t i;
+
+	rng = c->seed * 0x9E3779B97F4A7C15ULL;
+	*bytes = 0;
+	for (i = 0; i < c->docs; ++i) {
+		docs[i] = hoedown_buffer_new(1024);
+		c->generate(docs[i], i);
+		*bytes += docs[i]->size;
+	}
+
+	return docs;
+}
+
+/* write_corpus • saves each document as dir/name-NNNN.md */
+static int
+write_corpus(const char *dir, const struct corpus *c, hoedown_buffer **docs)
+{
+	char path[1024];
+	size_t i;
+	FILE *f;
+
+	for (i = 0; i < c->docs; ++i) {
+		snprintf(path, sizeof(path), "%s/%s-%04u.md", dir, c->name, (unsigned)i);
+		f = fopen(path, "wb");
+		if (!f) {
+			perror(path);
+			return 0;
+		}
+		fwrite(docs[i]->data, 1, docs[i]->size, f);
+		fclose(f);
+	}
+
+	return 1;
+}
+
+/* render_all • renders every document once, summing up their memory */
+static void
+render_all(hoedown_markdown *md, hoedown_buffer *ob, hoedown_buffer **docs, size_t n, size_t *reallocs, size_t *allocated)
+{
+	const hoedown_render_memory *memory;
+	size_t i;
+
+	for (i = 0; i < n; ++i) {
+		ob->size = 0;
+		hoedown_markdown_render(ob, docs[i]->data, docs[i]->size, md);
+		if (reallocs) {
+			memory = hoedown_markdown_memory(md);
+			*reallocs += memory->reallocs;
+			*allocated += memory->allocated;
+		}
+	}
+}
+
+int
+main(int argc, char **argv)
+{
+	hoedown_renderer *renderer;
+	hoedown_buffer *ob;
+	const char *only = NULL, *dir = NULL;
+	double min_time = DEF_TIME;
+	unsigned int extensions = ALL_EXTENSIONS;
+	int argerr = 0, first = 1, i;
+
+	/* parsing the command line */
+	for (i = 1; i < argc; ++i) {
+		if (strncmp(argv[i], "--corpus=", 9) == 0)
+			only = argv[i] + 9;
+		else if (strncmp(argv[i], "--time=", 7) == 0)
+			min_time = strtod(argv[i] + 7, NULL);
+		else if (strncmp(argv[i], "--write=", 8) == 0)
+			dir = argv[i] + 8;
+		else if (strcmp(argv[i], "--bounded") == 0)
+			extensions |= HOEDOWN_EXT_BOUNDED;
+		else
+			argerr = 1;
+	}
+
+	if (argerr || min_time <= 0) {
+		fprintf(stderr, "Usage: %s [--corpus=NAME] [--time=SECONDS] [--bounded] [--write=DIR]\n", argv[0]);
+		return 2;
+	}
+
+	renderer = hoedown_html_renderer_new(0, 0);
+	ob = hoedown_buffer_new(64);
+
+	if (!dir)
+		printf("{\"level\": \"c\", \"extensions\": %u, \"bounded\": %d, \"corpora\": [",
+			extensions, (extensions & HOEDOWN_EXT_BOUNDED) != 0);
+
+	for (i = 0; corpora[i].name; ++i) {
+		const struct corpus *c = &corpora[i];
+		hoedown_buffer **docs;
+		hoedown_markdown *md;
+		size_t bytes, n, reallocs = 0, allocated = 0;
+		clock_t start, elapsed;
+		long rounds = 0;
+		double seconds;
+
+		if (only && strcmp(only, c->name) != 0)
+			continue;
+
+		docs = generate(c, &bytes);
+
+		if (dir) {
+			if (!write_corpus(dir, c, docs))
+				return 1;
+		} else {
+			/* a long lived parser, as in a server: the first round warms
+			 * its work buffers and tells what a render allocates after that */
+			md = hoedown_markdown_new(extensions, MAX_NESTING, renderer);
+			render_all(md, ob, docs, c->docs, NULL, NULL);
+			render_all(md, ob, docs, c->docs, &reallocs, &allocated);
+
+			start = clock();
+			do {
+				render_all(md, ob, docs, c->docs, NULL, NULL);
+				rounds++;
+				elapsed = clock() - start;
+			} while ((double)elapsed / CLOCKS_PER_SEC < min_time);
+			seconds = (double)elapsed / CLOCKS_PER_SEC;
+
+			printf("%s\n  {\"name\": \"%s\", \"seed\": %u, \"docs\": %u, \"bytes\": %u, "
+				"\"mb_per_s\": %.2f, \"ns_per_doc\": %.0f, \"reallocs_per_doc\": %.2f, \"alloc_bytes_per_doc\": %.0f}",
+				first ? "" : ",", c->name, (unsigned)c->seed, (unsigned)c->docs, (unsigned)bytes,
+				bytes * rounds / seconds / 1e6, seconds * 1e9 / (rounds * c->docs),
+				(double)reallocs / c->docs, (double)allocated / c->docs);
+			first = 0;
+			hoedown_markdown_free(md);
+		}
+
+		for (n = 0; n < c->docs; ++n)
+			hoedown_buffer_free(docs[n]);
+		free(docs);
+	}
+
+	if (!dir)
+		printf("\n]}\n");
+
+	hoedown_buffer_free(ob);
+	hoedown_html_renderer_free(renderer);
+	return 0;
+}
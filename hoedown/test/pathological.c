@@ -0,0 +1,160 @@
+/* pathological.c - time-per-byte check on adversarial inputs */
+
+#include "markdown.h"
+#include "html.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define DEF_SIZE 16384
+#define DEF_GROWTH 3.0
+#define SCALE 8
+#define MIN_TIME 0.05
+
+#define ALL_EXTENSIONS (\
+	HOEDOWN_EXT_NO_INTRA_EMPHASIS | HOEDOWN_EXT_TABLES | HOEDOWN_EXT_FENCED_CODE |\
+	HOEDOWN_EXT_AUTOLINK | HOEDOWN_EXT_STRIKETHROUGH | HOEDOWN_EXT_UNDERLINE |\
+	HOEDOWN_EXT_SPACE_HEADERS | HOEDOWN_EXT_SUPERSCRIPT | HOEDOWN_EXT_LAX_SPACING |\
+	HOEDOWN_EXT_HIGHLIGHT | HOEDOWN_EXT_FOOTNOTES | HOEDOWN_EXT_QUOTE)
+
+/* pathological_case: 'head', then 'unit' and 'close' each repeated n times
+ * around 'tail' so that the document is about the requested size */
+struct pathological_case {
+	const char *name;
+	const char *head;
+	const char *unit;
+	const char *tail;
+	const char *close;
+};
+
+static const struct pathological_case cases[] = {
+	{ "open brackets",		"", "[", "", "" },
+	{ "nested brackets",	"", "[", "a", "]" },
+	{ "inline link opens",	"", "[a](", "", "" },
+	{ "link titles",		"", "[a](b \"", "", "" },
+	{ "nested parens",		"[a](b", "(", "", "" },
+	{ "emphasis opens",		"", "*a ", "", "" },
+	{ "strong opens",		"", "**a ", "", "" },
+	{ "triple opens",		"", "***a ", "", "" },
+	{ "strikethrough opens",	"", "~~a ", "", "" },
+	{ "highlight opens",	"", "==a ", "", "" },
+	{ "underscores",		"", "_a", "", "" },
+	{ "backtick runs",		"", "`", "", "a" },
+	{ "code span opens",	"", "`a ", "", "" },
+	{ "quote opens",		"", "\"a ", "", "" },
+	{ "superscript opens",	"", "^(a ", "", "" },
+	{ "angle opens",		"", "<a ", "", "" },
+	{ "email at signs",		"", "a@", "", "" },
+	{ "entity",				"&", "a", "", "" },
+	{ "html blocks",		"", "<div>\n", "", "" },
+	{ "html comments",		"", "<!--\n\n", "", "" },
+	{ "html rules",			"", "<hr\n\n", "", "" },
+	{ "deep quotes",		"", ">", " a\n", "" },
+	{ "list items",			"", "* a\n", "", "" },
+	{ "table pipes",		"a|b\n---|---\n", "|", "\n", "" },
+	{ NULL, NULL, NULL, NULL, NULL }
+};
+
+/* build_case • fills the buffer with a case of about 'size' bytes */
+static void
+build_case(hoedown_buffer *ib, const struct pathological_case *c, size_t size)
+{
+	size_t n, i, per;
+
+	per = strlen(c->unit) + strlen(c->close);
+	n = size / per;
+
+	ib->size = 0;
+	hoedown_buffer_puts(ib, c->head);
+	for (i = 0; i < n; ++i)
+		hoedown_buffer_puts(ib, c->unit);
+	hoedown_buffer_puts(ib, c->tail);
+	for (i = 0; i < n; ++i)
+		hoedown_buffer_puts(ib, c->close);
+}
+
+/* time_render • CPU seconds per render, averaged over at least MIN_TIME */
+static double
+time_render(hoedown_markdown *markdown, hoedown_buffer *ob, const hoedown_buffer *ib)
+{
+	clock_t start = clock(), elapsed;
+	long rounds = 0;
+
+	do {
+		ob->size = 0;
+		hoedown_markdown_render(ob, ib->data, ib->size, markdown);
+		rounds++;
+		elapsed = clock() - start;
+	} while ((double)elapsed / CLOCKS_PER_SEC < MIN_TIME);
+
+	return (double)elapsed / CLOCKS_PER_SEC / rounds;
+}
+
+int
+main(int argc, char **argv)
+{
+	hoedown_buffer *ib, *ob;
+	hoedown_renderer *renderer;
+	size_t size = DEF_SIZE;
+	double max_growth = DEF_GROWTH;
+	unsigned int bounded = HOEDOWN_EXT_BOUNDED;
+	static const unsigned int extensions[] = { 0, ALL_EXTENSIONS };
+	int failures = 0, argerr = 0, i, e;
+
+	/* parsing the command line */
+	for (i = 1; i < argc; ++i) {
+		if (strncmp(argv[i], "--size=", 7) == 0)
+			size = (size_t)strtoul(argv[i] + 7, NULL, 10);
+		else if (strncmp(argv[i], "--growth=", 9) == 0)
+			max_growth = strtod(argv[i] + 9, NULL);
+		else if (strcmp(argv[i], "--unbounded") == 0)
+			bounded = 0;
+		else
+			argerr = 1;
+	}
+
+	if (argerr || !size || max_growth <= 0) {
+		fprintf(stderr, "Usage: %s [--size=BYTES] [--growth=MAX] [--unbounded]\n", argv[0]);
+		return 2;
+	}
+
+	ib = hoedown_buffer_new(size);
+	ob = hoedown_buffer_new(size);
+	renderer = hoedown_html_renderer_new(0, 0);
+
+	/* each case is timed at 'size' and SCALE times 'size': the time per
+	 * byte stays flat for a linear parser and grows SCALE times for a
+	 * quadratic one */
+	for (i = 0; cases[i].name; ++i) {
+		for (e = 0; e < 2; ++e) {
+			hoedown_markdown *markdown;
+			double small, large, growth;
+
+			markdown = hoedown_markdown_new(extensions[e] | bounded, 16, renderer);
+
+			build_case(ib, &cases[i], size);
+			small = time_render(markdown, ob, ib) / ib->size;
+
+			build_case(ib, &cases[i], size * SCALE);
+			large = time_render(markdown, ob, ib) / ib->size;
+
+			hoedown_markdown_free(markdown);
+
+			growth = small > 0 ? large / small : 0;
+			printf("%-20s %-4s %8.1f ns/byte %6.2fx%s\n", cases[i].name, e ? "all" : "none",
+				large * 1e9, growth, growth > max_growth ? "  FAIL" : "");
+
+			if (growth > max_growth)
+				failures++;
+		}
+	}
+
+	hoedown_html_renderer_free(renderer);
+	hoedown_buffer_free(ib);
+	hoedown_buffer_free(ob);
+
+	printf("%d failed.\n", failures);
+	return failures ? 1 : 0;
+}
@@ -10,6 +10,7 @@ our @EXPORT = qw(
     markdown
     markdown_toc
 );
+our @EXPORT_OK = qw(markdown_with_toc smartypants);
 
 use XSLoader;
 XSLoader::load(__PACKAGE__, $VERSION);
@@ -17,23 +18,38 @@ XSLoader::load(__PACKAGE__, $VERSION);
 sub markdown {
     my $str = shift;
     my %args = (
-        html_options    => 0,
         extensions      => 0,
         max_nesting     => 16,
-        toc_nesting_lvl => 99,
         @_,
     );
 
-    my $renderer = Text::Markdown::Hoedown::Renderer::HTML->new(
-        $args{html_options},
-        $args{toc_nesting_lvl},
-    );
+    my $renderer = _html_renderer(%args);
     my $md = Text::Markdown::Hoedown::Markdown->new(
         $args{extensions},
         $args{max_nesting},
         $renderer
     );
-    return $md->render($str);
+    $md->set_work_budget($args{work_budget}) if $args{work_budget};
+    $md->set_cache($args{cache}) if $args{cache};
+    $md->set_block_cache($args{block_cache}) if $args{block_cache};
+    return $md->render($str, $args{cancel});
+}
+
+sub _html_renderer {
+    my %args = (
+        html_options    => 0,
+        toc_nesting_lvl => 99,
+        @_,
+    );
+
+    my $renderer = Text::Markdown::Hoedown::Renderer::HTML->new(
+        $args{html_options},
+        $args{toc_nesting_lvl},
+    );
+    for my $name (keys %{$args{callbacks} || {}}) {
+        $renderer->$name($args{callbacks}{$name});
+    }
+    return $renderer;
 }
 
 sub markdown_toc {
@@ -53,9 +69,61 @@ sub markdown_toc {
         $args{max_nesting},
         $renderer,
     );
-    return $md->render($str);
+    $md->set_work_budget($args{work_budget}) if $args{work_budget};
+    $md->set_cache($args{cache}) if $args{cache};
+    return $md->render($str, $args{cancel});
+}
+
+sub markdown_with_toc {
+    my $str = shift;
+    my %args = (
+        nesting_level   => 6,
+        extensions      => 0,
+        max_nesting     => 16,
+        @_,
+    );
+
+    my $renderer = _html_renderer(%args, toc_nesting_lvl => $args{nesting_level});
+    my $md = Text::Markdown::Hoedown::Markdown->new(
+        $args{extensions},
+        $args{max_nesting},
+        $renderer,
+    );
+    $md->collect_toc(Text::Markdown::Hoedown::Renderer::HTMLTOC->new($args{nesting_level}));
+    $md->set_work_budget($args{work_budget}) if $args{work_budget};
+    $md->set_cache($args{cache}) if $args{cache};
+    $md->set_block_cache($args{block_cache}) if $args{block_cache};
+    my $html = $md->render($str, $args{cancel});
+    my $toc = $md->toc;
+    utf8::decode($toc) if utf8::is_utf8($html);
+    return ($html, $toc);
+}
+
+package Text::Markdown::Hoedown::Document;
+
+sub html {
+    my ($self, %args) = @_;
+    return $self->render(Text::Markdown::Hoedown::_html_renderer(%args));
+}
+
+sub toc {
+    my ($self, %args) = @_;
+    my $renderer = Text::Markdown::Hoedown::Renderer::HTMLTOC->new(
+        defined $args{nesting_level} ? $args{nesting_level} : 6,
+    );
+    return $self->render($renderer);
+}
+
+# the tree is rendered twice, which parses nothing again
+sub html_with_toc {
+    my ($self, %args) = @_;
+    my $nesting_level = defined $args{nesting_level} ? $args{nesting_level} : 6;
+    my $html = $self->html(%args, toc_nesting_lvl => $nesting_level);
+    return ($html, $self->toc(nesting_level => $nesting_level));
 }
 
+package Text::Markdown::Hoedown;
+
 1;
 __END__
 
@@ -122,9 +190,17 @@ Values are following:
         HOEDOWN_EXT_DISABLE_INDENTED_CODE = (1 << 9),
         HOEDOWN_EXT_HIGHLIGHT = (1 << 10),
         HOEDOWN_EXT_FOOTNOTES = (1 << 11),
-        HOEDOWN_EXT_QUOTE = (1 << 12)
+        HOEDOWN_EXT_QUOTE = (1 << 12),
+        HOEDOWN_EXT_BOUNDED = (1 << 13)
     };
 
+C<HOEDOWN_EXT_BOUNDED> is meant for untrusted input. The parser remembers
+every look-ahead scan that failed (an unclosed bracket, emphasis, code span,
+HTML block and so on) and does not repeat it, so that rendering time stays
+linear in the size of the input (times C<max_nesting>) instead of quadratic.
+The output only differs from the default in rare cases, such as emphasis
+inside a broken link that follows an unclosed emphasis of the same kind.
+
 =item html_options
 
 This is bit flag.  You can use the flags by '|' operator.
@@ -141,13 +217,70 @@ Values are following:
         HOEDOWN_HTML_HARD_WRAP = (1 << 7),
         HOEDOWN_HTML_USE_XHTML = (1 << 8),
         HOEDOWN_HTML_ESCAPE = (1 << 9),
-        HOEDOWN_HTML_PRETTIFY = (1 << 10)
+        HOEDOWN_HTML_PRETTIFY = (1 << 10),
+        HOEDOWN_HTML_SMARTYPANTS = (1 << 11)
     } hoedown_html_render_mode;
 
+C<HOEDOWN_HTML_SMARTYPANTS> turns quotes, dashes, ellipses and the like
+of the text into typographic entities while rendering: C<"it's"> becomes
+C<&ldquo;it&rsquo;s&rdquo;>. It is a buffered approximation of
+C<smartypants>, not a single pass: the text of each run is escaped
+into the output, then copied out and converted again once the renderer
+writes something else. What it saves is the second full-size buffer
+and the rescan of the markup. Code spans and blocks, HTML blocks and
+the content of inline C<< <code> >>, C<< <pre> >> and similar tags are left
+alone. Otherwise it gives what C<smartypants> gives for the plain
+render, but in four cases. A quote or a tag like
+C<< <code> >> left open closes with its block, where the second pass
+carries it on. The text of a span the renderer refuses, such as a link
+C<HOEDOWN_HTML_SAFELINK> finds unsafe or an override returning undef,
+still opens and closes quotes. Raw inline HTML running over a line break
+is left alone whole, where C<HOEDOWN_HTML_HARD_WRAP> lets the second pass
+convert it after the C<< <br> >>. And a C<&#0;> dropped at the start of a
+paragraph takes the spaces after it along when a span follows.
+
 =item max_nesting
 
 I don't know what this do.
 
+=item callbacks
+
+Hash of Perl code references that replace some callbacks of the HTML
+renderer, which stays native for the rest. Keys and signatures are the ones
+of L<Text::Markdown::Hoedown::Callbacks>.
+
+    my $html = markdown($src, callbacks => {
+        blockcode => sub {
+            my ($text, $lang) = @_;
+            highlight($text, $lang);
+        },
+    });
+
+=item work_budget
+
+Stops rendering once about this many units of work were spent; one unit is
+roughly one byte parsed at one nesting level. C<markdown> dies with
+C<Rendering stopped: work budget exceeded> then.
+
+(Default: 0, no limit)
+
+=item cancel
+
+Code reference polled while rendering. When it returns true, or dies,
+C<markdown> dies too: with C<Rendering stopped: cancelled>, or with the
+callback's own error.
+
+    my $deadline = time + 2;
+    my $html = markdown($src, cancel => sub { time > $deadline });
+
+=item cache
+
+A C<Text::Markdown::Hoedown::Cache>, see L</CACHE>.
+
+=item block_cache
+
+A C<Text::Markdown::Hoedown::BlockCache>, see L</CACHE>.
+
 =back
 
 =item C<< markdown_toc($src:Str, %opts) :Str >>
@@ -170,12 +303,274 @@ Same as above.
 
 Same as above.
 
+=item work_budget
+
+Same as above.
+
+=item cancel
+
+Same as above.
+
+=item cache
+
+Same as above.
+
 =back
 
+=item C<< my ($html, $toc) = markdown_with_toc($src:Str, %opts) >>
+
+Renders the HTML and its TOC with a single parse of the blocks. The TOC
+is the one C<markdown_toc> gives for the same C<nesting_level> (default 6),
+and headers up to that level get the ids it links to; only the text of
+the headers is parsed a second time, for their TOC entries. Takes the
+options of C<markdown>, C<toc_nesting_lvl> aside. With
+C<HOEDOWN_HTML_SKIP_HTML> or C<HOEDOWN_HTML_ESCAPE>, headers in HTML blocks,
+which then render as text, are listed too. Exported on demand.
+
+=item C<< smartypants($html:Str) :Str >>
+
+SmartyPants over HTML already rendered, as a second pass. This is the
+reference conversion, and what to use when the output must be exactly
+that of SmartyPants; C<HOEDOWN_HTML_SMARTYPANTS> approximates it while
+rendering. Exported on demand.
+
 All C<HOEDOWN_*> constants are exported by default.
 
 =back
 
+=head1 DOCUMENTS
+
+To get several renderings of one source, parse it once into a
+C<Text::Markdown::Hoedown::Document> and render that as often as needed:
+
+    my $doc  = Text::Markdown::Hoedown::Document->new($src, HOEDOWN_EXT_TABLES);
+    my $html = $doc->html(html_options => HOEDOWN_HTML_TOC);
+    my $toc  = $doc->toc(nesting_level => 3);
+
+=over 4
+
+=item C<< Text::Markdown::Hoedown::Document->new($src:Str[, $extensions:Int[, $max_nesting:Int]]) >>
+
+Parses C<$src> into a tree held in C.
+
+=item C<< $doc->html(%options) :Str >>
+
+As C<markdown>, with its C<html_options>, C<toc_nesting_lvl> and C<callbacks>
+options, but the C<SAFELINK>, C<SKIP_IMAGES>, C<SKIP_HTML> and C<ESCAPE>
+HTML options render some elements differently, as described below.
+
+=item C<< $doc->toc(%options) :Str >>
+
+Same as C<markdown_toc>, with its C<nesting_level> option.
+
+=item C<< my ($html, $toc) = $doc->html_with_toc(%options) >>
+
+Same as C<markdown_with_toc>.
+
+=item C<< $doc->render($renderer) :Str >>
+
+Renders with any renderer object, such as
+C<Text::Markdown::Hoedown::Renderer::Callback> for plain text.
+
+=item C<< $doc->serialize() :Str >>
+
+Returns the tree as a byte string, to store in a cache. The format
+depends on the byte order and on the version of this module.
+
+=item C<< Text::Markdown::Hoedown::Document->from_image($image:Str) >>
+
+Makes a document of a string from C<serialize>, without copying it: the
+tree is rendered where it lies, so a string mapped from a file (with
+L<File::Map>, for instance) is read straight from the page cache. The
+image is checked on each render, and croaks if it is not valid. A tree parsed
+with a C<max_nesting> over 1000 may be too deep to be valid.
+
+=back
+
+The tree is parsed as for the full HTML renderer. A renderer that leaves a
+callback out renders the parsed element differently from a parse of its
+own: a span it declines (C<SAFELINK> links, C<SKIP_IMAGES>) renders as its
+content instead of its markdown source, and an HTML block without
+C<blockhtml> (C<SKIP_HTML>, C<ESCAPE>) renders as escaped paragraph text.
+The TOC of a document lists the same headers as its HTML, HTML blocks
+included.
+
+=head1 CACHE
+
+A C<Text::Markdown::Hoedown::Cache> keeps the most recently rendered
+documents, up to a number of bytes, and hands a copy of the output back when
+the same source is rendered again with the same options:
+
+    my $cache = Text::Markdown::Hoedown::Cache->new(64 * 1024 * 1024);
+    my $html  = markdown($src, cache => $cache);
+
+Renders that run Perl code (C<callbacks>, the Callback and Events renderers)
+do not go through the cache.
+
+A hit stops as the render it stands for would: C<cancel> is polled once, and
+a hit whose render took more work than C<work_budget> dies as that render
+did.
+
+=over 4
+
+=item C<< Text::Markdown::Hoedown::Cache->new([$max_bytes:Int]) >>
+
+(Default: 16 MiB) The sources and outputs stored, and some overhead per
+entry, count against C<$max_bytes>.
+
+=item C<< $md->set_cache($cache) >>
+
+Makes a C<Text::Markdown::Hoedown::Markdown> render through C<$cache>; undef
+stops it.
+
+=item C<< $cache->hits >>, C<< $cache->misses >>, C<< $cache->count >>, C<< $cache->bytes >>
+
+Counters, and the number and size of the entries.
+
+=item C<< $cache->clear >>
+
+Drops all entries.
+
+=back
+
+A C<Text::Markdown::Hoedown::BlockCache> does the same for the top level
+blocks of a document, so that a new version of a long document only parses
+the blocks that changed:
+
+    my $blocks = Text::Markdown::Hoedown::BlockCache->new;
+    my $html   = markdown($src, block_cache => $blocks);
+
+A block is found by its source and by the lines that end it. Blocks that
+use reference links or footnotes, headers and HTML blocks are parsed on
+each render, as are the blocks of renders running Perl code. A block cache
+is emptied when it is used with other options than the last time, so it
+pays to keep one per set of options.
+
+=over 4
+
+=item C<< Text::Markdown::Hoedown::BlockCache->new([$max_bytes:Int]) >>
+
+(Default: 16 MiB)
+
+=item C<< $md->set_block_cache($blocks) >>
+
+=item C<< $blocks->hits >>, C<< $blocks->misses >>, C<< $blocks->count >>, C<< $blocks->bytes >>
+
+=item C<< $blocks->clear >>
+
+Same as for C<Text::Markdown::Hoedown::Cache>.
+
+=back
+
+=head1 PROFILING
+
+Built with C<HOEDOWN_STATS=1 perl Build.PL>, a Markdown object counts the
+calls, the bytes and the time of each block parser, of each inline trigger
+and of each renderer callback, Perl callbacks included. Times are CPU
+cycles on x86, nanoseconds elsewhere, and include the calls nested inside.
+Other builds leave the counting out entirely.
+
+    my $md = Text::Markdown::Hoedown::Markdown->new(0, 16,
+        Text::Markdown::Hoedown::Renderer::HTML->new(0, 99));
+    $md->render($src);
+    my $stats = $md->stats;
+    printf "%d paragraphs, %d cycles\n",
+        $stats->{blocks}{paragraph}{calls}, $stats->{blocks}{paragraph}{cycles};
+
+=over 4
+
+=item C<< $md->stats >>
+
+A hash with C<blocks>, C<spans> and C<callbacks>, each mapping the name
+of what was called at least once to its C<calls>, C<bytes> and C<cycles>.
+Block parsers and inline triggers count the bytes of source they took,
+callbacks the bytes they wrote. Undef unless the module is built with
+C<HOEDOWN_STATS>.
+
+=item C<< $md->reset_stats >>
+
+Sets the counters back to zero.
+
+=back
+
+Every build accounts for the memory of each render, to find the documents
+that need the most:
+
+    $md->render($src);
+    printf "peak %d bytes\n", $md->memory->{peak};
+
+=over 4
+
+=item C<< $md->memory >>
+
+A hash describing the last render of C<$md>: C<allocated>, the bytes
+obtained while rendering; C<peak>, the most bytes held at once, pooled
+work buffers and the output included; C<reallocs>, the growths of
+buffers, each work buffer counting once per use; C<block_bufs> and C<span_bufs>, the work buffers pooled
+afterwards; C<refs> and C<footnotes>, the definitions found. It covers the
+buffers of the parser, not the allocations of Perl callbacks. A render
+answered by a cache leaves it as it was.
+
+=back
+
+A Markdown object keeps the work buffers of its renders for the next ones,
+at the size they reached, so one huge document can leave a long lived
+object holding megabytes. Bound what it keeps:
+
+    $md->set_retention(4, 64 * 1024);
+
+=over 4
+
+=item C<< $md->set_retention($max_bufs:Int, $max_capacity:Int) >>
+
+After each render, keep at most C<$max_bufs> block and as many span
+buffers, shrinking those above C<$max_capacity> bytes. Undef lifts either
+bound, as by default.
+
+=item C<< $md->trim([$max_bufs:Int[, $max_capacity:Int]]) >>
+
+Applies these bounds once, C<0> by default: C<< $md->trim >> frees all of
+the buffers. Undef lifts a bound here too.
+
+=back
+
+The output of C<render> is held whole until it returns, and a render whose
+output would pass 16MB comes back empty. C<render_to> hands it over in pieces while
+rendering instead, so a huge table takes memory for its source and a row.
+Either dies on a source that passes 16MB once its tabs are expanded:
+
+    open my $fh, '>:utf8', 'table.html' or die;
+    $md->render_to($src, sub { print {$fh} $_[0] });
+
+=over 4
+
+=item C<< $md->render_to($src:Str, $output:CodeRef[, $cancel:CodeRef]) >>
+
+Renders like C<render>, calling C<$output> with each piece of the output,
+every few kilobytes at the end of a top level block or of a table row.
+The pieces joined are what C<render> returns. When C<$output> dies, the
+render stops and dies with its error; C<$cancel> works as for C<render>.
+It goes around the caches of C<render>. The events renderer, whose
+output is only known at the end, hands it over once.
+
+=back
+
+Builds can also optimize across the source files and from a profile of
+the benchmark corpora, see L</HACKING>. C<HOEDOWN_LTO=1 perl Build.PL>
+links with link time optimization; C<HOEDOWN_PGO=generate> builds for a
+training run and C<HOEDOWN_PGO=use> from the profile it wrote to
+C<pgo-data>, or to C<HOEDOWN_PGO_DIR>:
+
+    HOEDOWN_PGO=generate perl Build.PL && ./Build
+    perl -Mblib author/benchmark.pl --level=xs
+    ./Build clean
+    HOEDOWN_PGO=use HOEDOWN_LTO=1 perl Build.PL && ./Build
+
+C<make pgo LTO=1> does the same for the C library in C<hoedown/>. On the
+corpora of the benchmark, link time optimization gained 4% to 19%, the
+profile 4% to 37%, and both 13% to 34%, the most on changelogs and
+pathological inputs.
+
 =head1 TODO
 
 =over 4
@@ -192,6 +587,16 @@ You can pull the modifications from upstream by following command:
 
      git subtree pull --prefix=hoedown git@github.com:hoedown/hoedown.git master
 
+The bundled hoedown is not upstream's: C<hoedown_markdown_render> returns a
+C<hoedown_render_status> instead of void, and the extensions, renderers and
+tree of this module are its own.
+
+C<perl -Mblib author/benchmark.pl> reports the throughput of generated
+corpora, from short comments to pathological inputs, through the C library
+and through the XS, as JSON: MB/s, ns, buffer growths and bytes allocated
+per document, with the default extensions and again with
+HOEDOWN_EXT_BOUNDED.
+
 =head1 LICENSE
 
 Copyright (C) tokuhirom.
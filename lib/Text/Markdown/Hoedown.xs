@@ -18,6 +18,7 @@ extern "C" {
 
 #include "../../hoedown/src/markdown.h"
 #include "../../hoedown/src/html.h"
+#include "../../hoedown/src/ast.h"
 
 #define XS_STRUCT2OBJ(sv, class, obj) \
     sv = newSViv(PTR2IV(obj));  \
@@ -35,15 +36,22 @@ extern "C" {
         XPUSHs(&PL_sv_undef); \
     }
 
-#define CB_HEADER(key) \
-    SV* cb = *rcb; \
-    \
+/* an override of an HTML renderer sees, and writes after, its text with
+ * SmartyPants converted */
+#define TMH_FLUSH_TEXT(opaque) \
+    if (TMH_CALLBACKS(opaque)->native && \
+        (((hoedown_html_renderer_state*)(opaque))->flags & HOEDOWN_HTML_SMARTYPANTS)) \
+        hoedown_html_smartypants_flush(&((hoedown_html_renderer_state*)(opaque))->smartypants);
+
+#define CB_HEADER \
     ENTER; \
     SAVETMPS; \
     \
     PUSHMARK(SP);
 
-#define CB_FOOTER \
+/* calls cb, appends what it returns to ob and runs on_undef when that is
+ * undef */
+#define CB_CALL(on_undef) \
     PUTBACK; \
     \
     int count = call_sv(cb, G_SCALAR); \
@@ -58,7 +66,7 @@ extern "C" {
             hoedown_buffer_grow(ob, ob->size + l); \
             hoedown_buffer_put(ob, p, l); \
         } else {\
-            is_null = 1;\
+            on_undef;\
         } \
     } \
     \
@@ -66,8 +74,364 @@ extern "C" {
     FREETMPS; \
     LEAVE;
 
+#define CB_FOOTER CB_CALL(is_null = 1)
+
+/* for callbacks without a return value, where undef appends nothing */
+#define CB_FOOTER_VOID CB_CALL((void)0)
+
 
 #include "gen.callback.c"
+#include "events.c"
+#include "cache.c"
+
+#define TMH_NATIVE(renderer, name) \
+    (TMH_CALLBACKS((renderer)->opaque)->native ? TMH_CALLBACKS((renderer)->opaque)->native->name : NULL)
+
+/* native is copied, so that an override removed later restores its callback */
+static struct tmh_callbacks *
+tmh_callbacks_new(pTHX_ const hoedown_renderer *native)
+{
+    struct tmh_callbacks *callbacks;
+    Newxz(callbacks, 1, struct tmh_callbacks);
+    callbacks->self = callbacks;
+    if (native) {
+        hoedown_renderer *copy;
+        Newx(copy, 1, hoedown_renderer);
+        Copy(native, copy, 1, hoedown_renderer);
+        callbacks->native = copy;
+    }
+    return callbacks;
+}
+
+static void
+tmh_callbacks_free(pTHX_ struct tmh_callbacks *callbacks)
+{
+    int i;
+    for (i = 0; i < TMH_CB_COUNT; i++) {
+        SvREFCNT_dec(callbacks->cb[i]);
+    }
+    Safefree(callbacks->native);
+    Safefree(callbacks);
+}
+
+/* HTML renderers take Perl overrides through the user slot of their state */
+static hoedown_renderer *
+tmh_html_renderer(pTHX_ hoedown_renderer *renderer)
+{
+    if (!renderer) {
+        croak("Cannot create new renderer(malloc failed)");
+    }
+    ((hoedown_html_renderer_state*)renderer->opaque)->opaque = tmh_callbacks_new(aTHX_ renderer);
+    return renderer;
+}
+
+static void
+tmh_html_renderer_free(pTHX_ hoedown_renderer *renderer)
+{
+    tmh_callbacks_free(aTHX_ TMH_CALLBACKS(renderer->opaque));
+    hoedown_html_renderer_free(renderer);
+}
+
+/* stores the code ref of a callback, undef clears it; returns whether
+ * one is set. a Markdown object keeps the function pointers it was
+ * created with, so a cleared callback stays a no-op there */
+static int
+tmh_set_callback(pTHX_ hoedown_renderer *renderer, enum tmh_callback_index idx, SV *code)
+{
+    struct tmh_callbacks *callbacks = TMH_CALLBACKS(renderer->opaque);
+
+    SvREFCNT_dec(callbacks->cb[idx]);
+    callbacks->cb[idx] = SvOK(code) ? newSVsv(code) : NULL;
+
+    return callbacks->cb[idx] != NULL;
+}
+
+/* polled by hoedown_markdown_render, a callback that dies cancels too */
+static int
+tmh_cancel(void *data)
+{
+    dTHX;
+    dSP;
+    int count, cancel = 0;
+
+    ENTER;
+    SAVETMPS;
+
+    PUSHMARK(SP);
+    PUTBACK;
+
+    count = call_sv((SV*)data, G_SCALAR | G_EVAL);
+
+    SPAGAIN;
+
+    if (count == 1) {
+        SV* ret = POPs;
+        cancel = SvTRUE(ret);
+    }
+
+    PUTBACK;
+    FREETMPS;
+    LEAVE;
+
+    if (SvTRUE(ERRSV)) {
+        cancel = 1;
+    }
+
+    return cancel;
+}
+
+/* the code render_to hands the output to, and whether it is characters */
+struct tmh_output {
+    SV *code;
+    bool utf8;
+};
+
+/* called by hoedown_markdown_render with each piece of output, which always
+ * ends on a character; code that dies cancels the render */
+static int
+tmh_output(const uint8_t *data, size_t size, void *opaque)
+{
+    dTHX;
+    dSP;
+    struct tmh_output *output = opaque;
+    SV *chunk;
+
+    ENTER;
+    SAVETMPS;
+
+    PUSHMARK(SP);
+    chunk = newSVpvn((const char*)data, size);
+    if (output->utf8) {
+        SvUTF8_on(chunk);
+    }
+    mXPUSHs(chunk);
+    PUTBACK;
+
+    call_sv(output->code, G_DISCARD | G_EVAL);
+
+    FREETMPS;
+    LEAVE;
+
+    return SvTRUE(ERRSV) ? 1 : 0;
+}
+
+/* whether the renderer only appends to the output, which render_to can
+ * then hand over while rendering; the events renderer replaces it at the
+ * end with the result of its Perl call */
+static bool
+tmh_renderer_appends(pTHX_ SV *renderer_sv)
+{
+    return sv_derived_from(renderer_sv, "Text::Markdown::Hoedown::Renderer::HTML")
+        || sv_derived_from(renderer_sv, "Text::Markdown::Hoedown::Renderer::HTMLTOC")
+        || sv_derived_from(renderer_sv, "Text::Markdown::Hoedown::Renderer::Callback");
+}
+
+/* dies with the reason a render stopped */
+static void
+tmh_render_failed(pTHX_ int status)
+{
+    if (status == HOEDOWN_RENDER_BUDGET_EXCEEDED) {
+        croak("Rendering stopped: work budget exceeded");
+    } else if (status == HOEDOWN_RENDER_CANCELLED) {
+        if (SvTRUE(ERRSV)) {
+            croak(NULL);
+        }
+        croak("Rendering stopped: cancelled");
+    }
+    croak("Cannot render(malloc failed)");
+}
+
+/* a parsed document, rendered as often as needed */
+struct tmh_document {
+    hoedown_ast *ast;
+    SV *image;  /* or a serialized tree, rendered where it lies */
+    bool utf8;  /* the source was a character string */
+    hoedown_stack work;  /* work buffers of the renders, kept when one dies */
+};
+
+/* image flag: the source was a character string */
+#define TMH_IMAGE_UTF8 1
+
+/* the image of doc, NULL when its string no longer holds a valid one */
+static const uint8_t *
+tmh_document_image(pTHX_ struct tmh_document *doc)
+{
+    STRLEN len;
+    const uint8_t *image = (const uint8_t*)SvPV(doc->image, len);
+
+    return hoedown_ast_image_check(image, len) ? image : NULL;
+}
+
+/* a Markdown object: the parser, and what its cached renders need */
+struct tmh_markdown {
+    hoedown_markdown *md;
+    SV *renderer;   /* keeps the renderer state alive */
+    SV *config;     /* cache key of the configuration, NULL if the renderer runs Perl code */
+    SV *cache;      /* a Text::Markdown::Hoedown::Cache, or NULL */
+    SV *block_cache;    /* a Text::Markdown::Hoedown::BlockCache, or NULL */
+    size_t max_work;    /* the work budget, which cached renders are held to */
+    SV *toc_renderer;   /* a Renderer::HTMLTOC rendering the headers too, or NULL */
+    hoedown_buffer *toc;    /* the output of toc_renderer */
+};
+
+typedef struct tmh_markdown tmh_markdown;
+
+struct tmh_markdown_config {
+    char kind;      /* 'H' for HTML, 'T' for HTMLTOC */
+    unsigned int extensions;
+    size_t max_nesting;
+    unsigned int flags;
+    int nesting_level;
+};
+
+/* the configuration of the native HTML renderers, as a cache key */
+static SV *
+tmh_markdown_config(pTHX_ SV *renderer_sv, unsigned int extensions, size_t max_nesting)
+{
+    hoedown_renderer *renderer = XS_STATE(hoedown_renderer*, renderer_sv);
+    hoedown_html_renderer_state *state = renderer->opaque;
+    struct tmh_markdown_config config;
+
+    Zero(&config, 1, struct tmh_markdown_config);  /* padding takes part in the key */
+    if (sv_derived_from(renderer_sv, "Text::Markdown::Hoedown::Renderer::HTML")) {
+        config.kind = 'H';
+    } else if (sv_derived_from(renderer_sv, "Text::Markdown::Hoedown::Renderer::HTMLTOC")) {
+        config.kind = 'T';
+    } else {
+        return NULL;
+    }
+
+    config.extensions = extensions;
+    config.max_nesting = max_nesting;
+    config.flags = state->flags;
+    config.nesting_level = state->toc_data.nesting_level;
+    return newSVpvn((const char*)&config, sizeof(config));
+}
+
+/* whether the output of self only depends on its configuration: not when
+ * Perl code could change it */
+static bool
+tmh_markdown_native(pTHX_ tmh_markdown *self)
+{
+    hoedown_renderer *renderer;
+    struct tmh_callbacks *callbacks;
+    int i;
+
+    if (!self->config) {
+        return 0;
+    }
+
+    renderer = XS_STATE(hoedown_renderer*, self->renderer);
+    callbacks = TMH_CALLBACKS(renderer->opaque);
+    for (i = 0; i < TMH_CB_COUNT; i++) {
+        if (callbacks->cb[i]) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/* the state of an HTML renderer, NULL for the others: their opaque is
+ * not a hoedown_html_renderer_state */
+static hoedown_html_renderer_state *
+tmh_html_state(pTHX_ SV *renderer_sv)
+{
+    if (sv_derived_from(renderer_sv, "Text::Markdown::Hoedown::Renderer::HTML")
+        || sv_derived_from(renderer_sv, "Text::Markdown::Hoedown::Renderer::HTMLTOC")) {
+        hoedown_renderer *renderer = XS_STATE(hoedown_renderer*, renderer_sv);
+        return (hoedown_html_renderer_state*)renderer->opaque;
+    }
+    return NULL;
+}
+
+/* text left pending by the HTML renderer was in a buffer freed since */
+static void
+tmh_html_done(pTHX_ void *data)
+{
+    ((hoedown_html_renderer_state*)data)->smartypants.ob = NULL;
+}
+
+/* run by LEAVE at the end of a render, also when a callback died: takes
+ * off the parser what was set for the render, and ends the render left */
+static void
+tmh_render_done(pTHX_ void *data)
+{
+    tmh_markdown *self = data;
+    hoedown_html_renderer_state *state = tmh_html_state(aTHX_ self->renderer);
+
+    hoedown_markdown_abort(self->md);
+    hoedown_markdown_set_cancel(self->md, NULL, NULL);
+    hoedown_markdown_set_output(self->md, NULL, NULL);
+    hoedown_markdown_set_block_cache(self->md, NULL);
+
+    if (state) {
+        tmh_html_done(aTHX_ state);
+    }
+}
+
+static void
+tmh_buffer_free(pTHX_ void *data)
+{
+    hoedown_buffer_free(data);
+}
+
+/* frees ob and undoes the render settings of self when the scope is left */
+static void
+tmh_render_guard(pTHX_ SV *self_sv, tmh_markdown *self, hoedown_buffer *ob)
+{
+    SAVEFREESV(SvREFCNT_inc_simple_NN(SvRV(self_sv)));
+    SAVEDESTRUCTOR_X(tmh_buffer_free, ob);
+    SAVEDESTRUCTOR_X(tmh_render_done, self);
+}
+
+/* whether a render of self can go through its cache: not when Perl code
+ * could change the output, nor when the TOC is collected alongside */
+static bool
+tmh_markdown_cacheable(pTHX_ tmh_markdown *self)
+{
+    return self->cache && !self->toc_renderer && tmh_markdown_native(aTHX_ self);
+}
+
+static const char *tmh_stats_block_names[HOEDOWN_STATS_BLOCKS] = {
+    "atxheader", "htmlblock", "fencedcode", "table", "blockquote",
+    "blockcode", "list", "paragraph", "inline"
+};
+
+static const char *tmh_stats_span_names[HOEDOWN_STATS_SPANS] = {
+    "emphasis", "codespan", "linebreak", "link", "langle", "escape",
+    "entity", "autolink_url", "autolink_email", "autolink_www",
+    "superscript", "quote"
+};
+
+/* the callbacks past those Perl code can override */
+static const char *tmh_stats_container_names[] = {
+    "container_enter", "container_leave"
+};
+
+/* {name => {calls, bytes, cycles}} of the counters called at least once */
+static SV *
+tmh_stats_group(pTHX_ const struct hoedown_stats_counter *counters, size_t n, const char **names)
+{
+    HV *group = newHV();
+    size_t i;
+
+    for (i = 0; i < n; i++) {
+        HV *counter;
+        const char *name;
+
+        if (!counters[i].calls) {
+            continue;
+        }
+        name = names ? names[i] : i < TMH_CB_COUNT ?
+            tmh_callback_names[i] : tmh_stats_container_names[i - TMH_CB_COUNT];
+        counter = newHV();
+        (void)hv_stores(counter, "calls", newSVuv(counters[i].calls));
+        (void)hv_stores(counter, "bytes", newSVuv(counters[i].bytes));
+        (void)hv_stores(counter, "cycles", newSVuv(counters[i].cycles));
+        (void)hv_store(group, name, strlen(name), newRV_noinc((SV*)counter), 0);
+    }
+    return newRV_noinc((SV*)group);
+}
 
 #define TMH_CONST(name) \
     newCONSTSUB(stash, #name, newSViv(name)); \
@@ -91,6 +455,7 @@ BOOT:
     TMH_CONST(HOEDOWN_EXT_HIGHLIGHT);
     TMH_CONST(HOEDOWN_EXT_FOOTNOTES);
     TMH_CONST(HOEDOWN_EXT_QUOTE);
+    TMH_CONST(HOEDOWN_EXT_BOUNDED);
 
     TMH_CONST(HOEDOWN_HTML_SKIP_HTML);
     TMH_CONST(HOEDOWN_HTML_SKIP_STYLE);
@@ -103,11 +468,27 @@ BOOT:
     TMH_CONST(HOEDOWN_HTML_USE_XHTML);
     TMH_CONST(HOEDOWN_HTML_ESCAPE);
     TMH_CONST(HOEDOWN_HTML_PRETTIFY);
+    TMH_CONST(HOEDOWN_HTML_SMARTYPANTS);
+
+    {
+        HV* events_stash = gv_stashpv("Text::Markdown::Hoedown::Renderer::Events", GV_ADD);
+        char name[32];
+        int i, j;
+        for (i = 0; i < TMH_CB_COUNT; i++) {
+            for (j = 0; tmh_callback_names[i][j] && j < 31; j++) {
+                name[j] = toUPPER(tmh_callback_names[i][j]);
+            }
+            name[j] = '\0';
+            newCONSTSUB(events_stash, name, newSViv(i));
+        }
+        newCONSTSUB(events_stash, "EVENT_SIZE", newSViv(sizeof(hoedown_ast_node)));
+        newCONSTSUB(events_stash, "NONE", newSVuv(HOEDOWN_AST_NONE));
+    }
 
 TYPEMAP: <<HERE
 
 hoedown_renderer* T_H_RENDERER
-hoedown_markdown* T_H_MARKDOWN
+tmh_markdown* T_H_MARKDOWN
 
 OUTPUT
 
@@ -123,48 +504,375 @@ HERE
 
 PROTOTYPES: DISABLE
 
+SV*
+smartypants(SV *html_sv)
+PREINIT:
+    hoedown_buffer *ob;
+    const char *html;
+    STRLEN html_len;
+CODE:
+    html = SvPV(html_sv, html_len);
+    ob = hoedown_buffer_new(64);
+    if (!ob) {
+        croak("Cannot create new hoedown_buffer(malloc failed)");
+    }
+    hoedown_html_smartypants(ob, (const uint8_t*)html, html_len);
+    RETVAL = newSVpvn(ob->size ? (const char*)ob->data : "", ob->size);
+    if (SvUTF8(html_sv)) {
+        SvUTF8_on(RETVAL);
+    }
+    hoedown_buffer_free(ob);
+OUTPUT:
+    RETVAL
+
 MODULE = Text::Markdown::Hoedown    PACKAGE = Text::Markdown::Hoedown::Markdown
 
-hoedown_markdown *
+tmh_markdown *
 new(const char* klass, unsigned int extensions, size_t max_nesting, SV* renderer_sv)
 CODE:
     hoedown_renderer* renderer = XS_STATE(hoedown_renderer*, renderer_sv);
-    RETVAL = hoedown_markdown_new(extensions, max_nesting, renderer);
+    hoedown_markdown *md = hoedown_markdown_new(extensions, max_nesting, renderer);
+    if (!md) {
+        croak("Cannot create new markdown(malloc failed)");
+    }
+    Newxz(RETVAL, 1, tmh_markdown);
+    RETVAL->md = md;
+    RETVAL->renderer = newSVsv(renderer_sv);
+    RETVAL->config = tmh_markdown_config(aTHX_ renderer_sv, extensions, max_nesting);
+OUTPUT:
+    RETVAL
+
+void
+set_work_budget(tmh_markdown *self, size_t max_work)
+CODE:
+    hoedown_markdown_set_work_budget(self->md, max_work);
+    self->max_work = max_work;
+
+void
+set_retention(tmh_markdown *self, SV *max_bufs, SV *max_capacity)
+CODE:
+    hoedown_markdown_set_retention(self->md,
+        SvOK(max_bufs) ? SvUV(max_bufs) : HOEDOWN_RETAIN_ALL,
+        SvOK(max_capacity) ? SvUV(max_capacity) : HOEDOWN_RETAIN_ALL);
+
+void
+trim(tmh_markdown *self, SV *max_bufs = NULL, SV *max_capacity = NULL)
+CODE:
+    hoedown_markdown_trim(self->md,
+        !max_bufs ? 0 : SvOK(max_bufs) ? SvUV(max_bufs) : HOEDOWN_RETAIN_ALL,
+        !max_capacity ? 0 : SvOK(max_capacity) ? SvUV(max_capacity) : HOEDOWN_RETAIN_ALL);
+
+void
+set_cache(tmh_markdown *self, SV *cache_sv)
+CODE:
+    if (SvOK(cache_sv) && !sv_derived_from(cache_sv, "Text::Markdown::Hoedown::Cache")) {
+        croak("Not a Text::Markdown::Hoedown::Cache");
+    }
+    SvREFCNT_dec(self->cache);
+    self->cache = SvOK(cache_sv) ? newSVsv(cache_sv) : NULL;
+
+void
+collect_toc(tmh_markdown *self, SV *renderer_sv)
+PREINIT:
+    hoedown_renderer *toc = NULL;
+CODE:
+    if (SvOK(renderer_sv)) {
+        if (!sv_derived_from(renderer_sv, "Text::Markdown::Hoedown::Renderer::HTMLTOC")) {
+            croak("Not a Text::Markdown::Hoedown::Renderer::HTMLTOC");
+        }
+        if (!self->toc) {
+            self->toc = hoedown_buffer_new(64);
+            if (!self->toc) {
+                croak("Cannot create new hoedown_buffer(malloc failed)");
+            }
+        }
+        toc = XS_STATE(hoedown_renderer*, renderer_sv);
+    }
+    hoedown_markdown_set_toc(self->md, toc, self->toc);
+    SvREFCNT_dec(self->toc_renderer);
+    self->toc_renderer = toc ? newSVsv(renderer_sv) : NULL;
+
+SV*
+toc(tmh_markdown *self)
+CODE:
+    if (!self->toc_renderer) {
+        croak("TOC is not collected, see collect_toc");
+    }
+    RETVAL = newSVpvn(self->toc->size ? (const char*)self->toc->data : "", self->toc->size);
+    self->toc->size = 0;
 OUTPUT:
     RETVAL
 
+void
+set_block_cache(tmh_markdown *self, SV *cache_sv)
+CODE:
+    if (SvOK(cache_sv) && !sv_derived_from(cache_sv, "Text::Markdown::Hoedown::BlockCache")) {
+        croak("Not a Text::Markdown::Hoedown::BlockCache");
+    }
+    SvREFCNT_dec(self->block_cache);
+    self->block_cache = SvOK(cache_sv) ? newSVsv(cache_sv) : NULL;
+
 SV*
-render(hoedown_markdown *self, SV *src_sv)
+render(tmh_markdown *self, SV *src_sv, SV *cancel_sv = NULL)
 PREINIT:
     struct hoedown_buffer* ob;
+    struct tmh_cache *cache = NULL;
+    SV *hit;
     const char *src;
     STRLEN src_len;
+    size_t work;
+    int status;
 CODE:
+    /* a hit stops as the render it stands for would: cancel is polled
+     * once, as at the start of a render, and its work is held to the budget */
+    if (tmh_markdown_cacheable(aTHX_ self)) {
+        cache = XS_STATE(struct tmh_cache*, self->cache);
+        hit = tmh_cache_get(aTHX_ cache, self->config, src_sv, &work);
+        if (hit) {
+            if (cancel_sv && SvOK(cancel_sv) && tmh_cancel(cancel_sv)) {
+                tmh_render_failed(aTHX_ HOEDOWN_RENDER_CANCELLED);
+            }
+            if (self->max_work && work > self->max_work) {
+                tmh_render_failed(aTHX_ HOEDOWN_RENDER_BUDGET_EXCEEDED);
+            }
+            ST(0) = sv_2mortal(newSVsv(hit));
+            XSRETURN(1);
+        }
+    }
+
     ob = hoedown_buffer_new(64);
     if (!ob) {
         croak("Cannot create new hoedown_buffer(malloc failed)");
     }
 
+    ENTER;
+    tmh_render_guard(aTHX_ ST(0), self, ob);
+
     src = SvPV(src_sv, src_len);
-    hoedown_markdown_render(ob, src, src_len, self);
+    if (cancel_sv && SvOK(cancel_sv)) {
+        hoedown_markdown_set_cancel(self->md, tmh_cancel, cancel_sv);
+    }
+    /* headers are never taken from the blocks, so a collected TOC is complete */
+    if (self->block_cache && tmh_markdown_native(aTHX_ self)) {
+        hoedown_markdown_set_block_cache(self->md, tmh_block_cache_bind(aTHX_
+            XS_STATE(struct tmh_block_cache*, self->block_cache), self->config));
+    }
+    status = hoedown_markdown_render(ob, src, src_len, self->md);
+
+    if (status != HOEDOWN_RENDER_OK) {
+        tmh_render_failed(aTHX_ status);
+    }
 
     SV* ret = newSVpv(hoedown_buffer_cstr(ob), 0);
     if (SvUTF8(src_sv)) {
         SvUTF8_on(ret);
     }
-    hoedown_buffer_free(ob);
+    LEAVE;
+    if (cache) {
+        tmh_cache_put(aTHX_ cache, self->config, src_sv, ret, hoedown_markdown_work(self->md));
+    }
     RETVAL = ret;
 OUTPUT:
     RETVAL
 
+void
+render_to(tmh_markdown *self, SV *src_sv, SV *output_sv, SV *cancel_sv = NULL)
+PREINIT:
+    struct hoedown_buffer* ob;
+    struct tmh_output output;
+    const char *src;
+    STRLEN src_len;
+    int status;
+    bool appends;
+CODE:
+    ob = hoedown_buffer_new(64);
+    if (!ob) {
+        croak("Cannot create new hoedown_buffer(malloc failed)");
+    }
+
+    ENTER;
+    tmh_render_guard(aTHX_ ST(0), self, ob);
+
+    src = SvPV(src_sv, src_len);
+    output.code = output_sv;
+    output.utf8 = SvUTF8(src_sv) ? 1 : 0;
+    appends = tmh_renderer_appends(aTHX_ self->renderer);
+    if (cancel_sv && SvOK(cancel_sv)) {
+        hoedown_markdown_set_cancel(self->md, tmh_cancel, cancel_sv);
+    }
+    /* output points into this frame: the guard takes it off before it goes */
+    if (appends) {
+        hoedown_markdown_set_output(self->md, tmh_output, &output);
+    }
+    status = hoedown_markdown_render(ob, src, src_len, self->md);
+    hoedown_markdown_set_output(self->md, NULL, NULL);
+
+    /* the output of other renderers is only known at the end */
+    if (!appends && status == HOEDOWN_RENDER_OK && ob->size && tmh_output(ob->data, ob->size, &output)) {
+        status = HOEDOWN_RENDER_CANCELLED;
+    }
+
+    if (status != HOEDOWN_RENDER_OK) {
+        tmh_render_failed(aTHX_ status);
+    }
+    LEAVE;
+
+SV*
+stats(tmh_markdown *self)
+PREINIT:
+    const hoedown_stats *stats;
+    HV *hv;
+CODE:
+    stats = hoedown_markdown_stats(self->md);
+    if (!stats) {
+        XSRETURN_UNDEF;
+    }
+    hv = newHV();
+    (void)hv_stores(hv, "blocks", tmh_stats_group(aTHX_ stats->block, HOEDOWN_STATS_BLOCKS, tmh_stats_block_names));
+    (void)hv_stores(hv, "spans", tmh_stats_group(aTHX_ stats->span, HOEDOWN_STATS_SPANS, tmh_stats_span_names));
+    (void)hv_stores(hv, "callbacks", tmh_stats_group(aTHX_ stats->callback, HOEDOWN_STATS_CALLBACKS, NULL));
+    RETVAL = newRV_noinc((SV*)hv);
+OUTPUT:
+    RETVAL
+
+void
+reset_stats(tmh_markdown *self)
+CODE:
+    hoedown_markdown_reset_stats(self->md);
+
+SV*
+memory(tmh_markdown *self)
+PREINIT:
+    const hoedown_render_memory *memory;
+    HV *hv;
+CODE:
+    memory = hoedown_markdown_memory(self->md);
+    hv = newHV();
+    (void)hv_stores(hv, "allocated", newSVuv(memory->allocated));
+    (void)hv_stores(hv, "peak", newSVuv(memory->peak));
+    (void)hv_stores(hv, "reallocs", newSVuv(memory->reallocs));
+    (void)hv_stores(hv, "block_bufs", newSVuv(memory->block_bufs));
+    (void)hv_stores(hv, "span_bufs", newSVuv(memory->span_bufs));
+    (void)hv_stores(hv, "refs", newSVuv(memory->refs));
+    (void)hv_stores(hv, "footnotes", newSVuv(memory->footnotes));
+    RETVAL = newRV_noinc((SV*)hv);
+OUTPUT:
+    RETVAL
+
+void
+DESTROY(tmh_markdown *self)
+CODE:
+    hoedown_markdown_free(self->md);
+    SvREFCNT_dec(self->renderer);
+    SvREFCNT_dec(self->config);
+    SvREFCNT_dec(self->cache);
+    SvREFCNT_dec(self->block_cache);
+    SvREFCNT_dec(self->toc_renderer);
+    hoedown_buffer_free(self->toc);
+    Safefree(self);
+
+MODULE = Text::Markdown::Hoedown    PACKAGE = Text::Markdown::Hoedown::Cache
+
+void
+new(const char* klass, size_t max_bytes = 16 * 1024 * 1024)
+PPCODE:
+    ST(0) = sv_newmortal();
+    sv_setref_pv(ST(0), klass, (void*)tmh_cache_new(aTHX_ max_bytes));
+    XSRETURN(1);
+
+UV
+hits(SV* this)
+CODE:
+    RETVAL = (XS_STATE(struct tmh_cache*, this))->hits;
+OUTPUT:
+    RETVAL
+
+UV
+misses(SV* this)
+CODE:
+    RETVAL = (XS_STATE(struct tmh_cache*, this))->misses;
+OUTPUT:
+    RETVAL
+
+UV
+bytes(SV* this)
+CODE:
+    RETVAL = (XS_STATE(struct tmh_cache*, this))->bytes;
+OUTPUT:
+    RETVAL
+
+UV
+count(SV* this)
+CODE:
+    RETVAL = HvUSEDKEYS((XS_STATE(struct tmh_cache*, this))->index);
+OUTPUT:
+    RETVAL
+
+void
+clear(SV* this)
+CODE:
+    tmh_cache_clear(aTHX_ XS_STATE(struct tmh_cache*, this));
+
+void
+DESTROY(SV* this)
+CODE:
+    tmh_cache_free(aTHX_ XS_STATE(struct tmh_cache*, this));
+
+MODULE = Text::Markdown::Hoedown    PACKAGE = Text::Markdown::Hoedown::BlockCache
+
+void
+new(const char* klass, size_t max_bytes = 16 * 1024 * 1024)
+PPCODE:
+    ST(0) = sv_newmortal();
+    sv_setref_pv(ST(0), klass, (void*)tmh_block_cache_new(aTHX_ max_bytes));
+    XSRETURN(1);
+
+UV
+hits(SV* this)
+CODE:
+    RETVAL = (XS_STATE(struct tmh_block_cache*, this))->blocks->hits;
+OUTPUT:
+    RETVAL
+
+UV
+misses(SV* this)
+CODE:
+    RETVAL = (XS_STATE(struct tmh_block_cache*, this))->blocks->misses;
+OUTPUT:
+    RETVAL
+
+UV
+bytes(SV* this)
+CODE:
+    RETVAL = (XS_STATE(struct tmh_block_cache*, this))->blocks->bytes;
+OUTPUT:
+    RETVAL
+
+UV
+count(SV* this)
+CODE:
+    RETVAL = (XS_STATE(struct tmh_block_cache*, this))->blocks->count;
+OUTPUT:
+    RETVAL
+
+void
+clear(SV* this)
+CODE:
+    hoedown_block_cache_clear((XS_STATE(struct tmh_block_cache*, this))->blocks);
+
+void
+DESTROY(SV* this)
+CODE:
+    tmh_block_cache_free(aTHX_ XS_STATE(struct tmh_block_cache*, this));
+
 MODULE = Text::Markdown::Hoedown    PACKAGE = Text::Markdown::Hoedown::Renderer::HTML
 
 void
 new(const char* klass, unsigned int render_flags, int nesting_level)
 PPCODE:
-    hoedown_renderer * renderer = hoedown_html_renderer_new(
+    hoedown_renderer * renderer = tmh_html_renderer(aTHX_ hoedown_html_renderer_new(
         render_flags, nesting_level
-    );
+    ));
     ST(0) = sv_newmortal();
     sv_setref_pv(ST(0), "Text::Markdown::Hoedown::Renderer::HTML", (void*)renderer);
     XSRETURN(1);
@@ -173,16 +881,18 @@ void
 DESTROY(SV* this)
 CODE:
     hoedown_renderer* self = INT2PTR(hoedown_renderer*, SvROK(this) ? SvIV(SvRV(this)) : SvIV(this));
-    hoedown_html_renderer_free(self);
+    tmh_html_renderer_free(aTHX_ self);
+
+INCLUDE: gen.callback.inc
 
 MODULE = Text::Markdown::Hoedown    PACKAGE = Text::Markdown::Hoedown::Renderer::HTMLTOC
 
 void
 new(const char* klass, int nesting_level)
 PPCODE:
-    hoedown_renderer * renderer = hoedown_html_toc_renderer_new(
+    hoedown_renderer * renderer = tmh_html_renderer(aTHX_ hoedown_html_toc_renderer_new(
         nesting_level
-    );
+    ));
     ST(0) = sv_newmortal();
     sv_setref_pv(ST(0), "Text::Markdown::Hoedown::Renderer::HTMLTOC", (void*)renderer);
     XSRETURN(1);
@@ -191,7 +901,9 @@ void
 DESTROY(SV* this)
 CODE:
     hoedown_renderer* self = INT2PTR(hoedown_renderer*, SvROK(this) ? SvIV(SvRV(this)) : SvIV(this));
-    hoedown_html_renderer_free(self);
+    tmh_html_renderer_free(aTHX_ self);
+
+INCLUDE: gen.callback.inc
 
 MODULE = Text::Markdown::Hoedown    PACKAGE = Text::Markdown::Hoedown::Renderer::Callback
 
@@ -200,7 +912,7 @@ new(const char* klass)
 PPCODE:
     hoedown_renderer * renderer;
     Newxz(renderer, 1, hoedown_renderer);
-    renderer->opaque = newHV();
+    renderer->opaque = tmh_callbacks_new(aTHX_ NULL);
     ST(0) = sv_newmortal();
     sv_setref_pv(ST(0), "Text::Markdown::Hoedown::Renderer::Callback", (void*)renderer);
     XSRETURN(1);
@@ -209,8 +921,167 @@ void
 DESTROY(SV* this)
 CODE:
     hoedown_renderer* self = INT2PTR(hoedown_renderer*, SvROK(this) ? SvIV(SvRV(this)) : SvIV(this));
-    SvREFCNT_dec(self->opaque);
+    tmh_callbacks_free(aTHX_ TMH_CALLBACKS(self->opaque));
     Safefree(self);
 
 INCLUDE: gen.callback.inc
 
+
+MODULE = Text::Markdown::Hoedown    PACKAGE = Text::Markdown::Hoedown::Renderer::Events
+
+void
+new(const char* klass, SV* handler)
+PPCODE:
+    hoedown_renderer * renderer = tmh_events_renderer_new(aTHX_ handler);
+    ST(0) = sv_newmortal();
+    sv_setref_pv(ST(0), "Text::Markdown::Hoedown::Renderer::Events", (void*)renderer);
+    XSRETURN(1);
+
+void
+DESTROY(SV* this)
+CODE:
+    hoedown_renderer* self = INT2PTR(hoedown_renderer*, SvROK(this) ? SvIV(SvRV(this)) : SvIV(this));
+    tmh_events_renderer_free(aTHX_ self);
+
+MODULE = Text::Markdown::Hoedown    PACKAGE = Text::Markdown::Hoedown::Document
+
+void
+new(const char* klass, SV* src_sv, unsigned int extensions = 0, size_t max_nesting = 16)
+PPCODE:
+    struct tmh_document *doc;
+    hoedown_renderer *recorder;
+    hoedown_markdown *md;
+    const char *src;
+    STRLEN src_len;
+    int status;
+
+    Newxz(doc, 1, struct tmh_document);
+    doc->ast = hoedown_ast_new();
+    recorder = doc->ast ? hoedown_ast_renderer_new(doc->ast) : NULL;
+    md = recorder ? hoedown_markdown_new(extensions, max_nesting, recorder) : NULL;
+    if (!md || hoedown_stack_new(&doc->work, 8) < 0) {
+        if (md) {
+            hoedown_markdown_free(md);
+        }
+        hoedown_ast_renderer_free(recorder);
+        hoedown_ast_free(doc->ast);
+        Safefree(doc);
+        croak("Cannot create new document(malloc failed)");
+    }
+
+    src = SvPV(src_sv, src_len);
+    doc->utf8 = SvUTF8(src_sv) ? 1 : 0;
+    status = hoedown_ast_parse(doc->ast, (const uint8_t*)src, src_len, md);
+    hoedown_markdown_free(md);
+    hoedown_ast_renderer_free(recorder);
+
+    if (status != HOEDOWN_RENDER_OK) {
+        hoedown_ast_work_free(&doc->work);
+        hoedown_ast_free(doc->ast);
+        Safefree(doc);
+        croak("Cannot parse(malloc failed)");
+    }
+
+    ST(0) = sv_newmortal();
+    sv_setref_pv(ST(0), klass, (void*)doc);
+    XSRETURN(1);
+
+SV*
+render(SV* this, SV* renderer_sv)
+PREINIT:
+    struct tmh_document *doc;
+    hoedown_renderer *renderer;
+    hoedown_html_renderer_state *state;
+    const uint8_t *image;
+    hoedown_buffer *ob;
+CODE:
+    doc = XS_STATE(struct tmh_document*, this);
+    renderer = XS_STATE(hoedown_renderer*, renderer_sv);
+    image = doc->image ? tmh_document_image(aTHX_ doc) : NULL;
+    if (doc->image && !image) {
+        croak("Invalid document image");
+    }
+    ob = hoedown_buffer_new(64);
+    if (!ob) {
+        croak("Cannot create new hoedown_buffer(malloc failed)");
+    }
+
+    /* as tmh_render_guard: the callbacks may die, or drop the last
+     * reference to the document or the renderer */
+    ENTER;
+    SAVEFREESV(SvREFCNT_inc_simple_NN(SvRV(this)));
+    SAVEFREESV(SvREFCNT_inc_simple_NN(SvRV(renderer_sv)));
+    SAVEDESTRUCTOR_X(tmh_buffer_free, ob);
+    state = tmh_html_state(aTHX_ renderer_sv);
+    if (state) {
+        SAVEDESTRUCTOR_X(tmh_html_done, state);
+    }
+
+    if (image) {
+        hoedown_ast_render_image(ob, image, renderer, &doc->work);
+    } else {
+        hoedown_ast_render(ob, doc->ast, renderer, &doc->work);
+    }
+
+    RETVAL = newSVpvn(ob->size ? (const char*)ob->data : "", ob->size);
+    if (doc->utf8) {
+        SvUTF8_on(RETVAL);
+    }
+    LEAVE;
+OUTPUT:
+    RETVAL
+
+void
+from_image(const char* klass, SV* image_sv)
+PPCODE:
+    struct tmh_document *doc;
+
+    Newxz(doc, 1, struct tmh_document);
+    doc->image = SvREFCNT_inc_simple_NN(image_sv);
+    if (!tmh_document_image(aTHX_ doc)) {
+        SvREFCNT_dec(doc->image);
+        Safefree(doc);
+        croak("Invalid document image");
+    }
+    if (hoedown_stack_new(&doc->work, 8) < 0) {
+        SvREFCNT_dec(doc->image);
+        Safefree(doc);
+        croak("Cannot create new document(malloc failed)");
+    }
+    doc->utf8 = hoedown_ast_image_flags((const uint8_t*)SvPVX(image_sv)) & TMH_IMAGE_UTF8 ? 1 : 0;
+
+    ST(0) = sv_newmortal();
+    sv_setref_pv(ST(0), klass, (void*)doc);
+    XSRETURN(1);
+
+SV*
+serialize(SV* this)
+PREINIT:
+    struct tmh_document *doc;
+    hoedown_buffer *ob;
+CODE:
+    doc = XS_STATE(struct tmh_document*, this);
+    if (doc->image) {
+        RETVAL = newSVsv(doc->image);
+    } else {
+        ob = hoedown_buffer_new(1024);
+        if (!ob) {
+            croak("Cannot create new hoedown_buffer(malloc failed)");
+        }
+        hoedown_ast_serialize(ob, doc->ast, doc->utf8 ? TMH_IMAGE_UTF8 : 0);
+        RETVAL = newSVpvn(ob->size ? (const char*)ob->data : "", ob->size);
+        hoedown_buffer_free(ob);
+    }
+OUTPUT:
+    RETVAL
+
+void
+DESTROY(SV* this)
+CODE:
+    struct tmh_document *doc = XS_STATE(struct tmh_document*, this);
+    hoedown_ast_work_free(&doc->work);
+    hoedown_ast_free(doc->ast);
+    if (doc->image) {
+        SvREFCNT_dec(doc->image);
+    }
+    Safefree(doc);
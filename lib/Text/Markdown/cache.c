@@ -0,0 +1,234 @@
+/* cache.c - Text::Markdown::Hoedown::Cache, an LRU of rendered documents,
+ * and Text::Markdown::Hoedown::BlockCache, one of rendered blocks
+ *
+ * Entries are indexed by a 16 byte digest: a hash of the render
+ * configuration and a hash of the source. A hit compares the stored
+ * configuration and source with the requested ones before returning the
+ * stored output, so a hash collision only costs a render. An entry also
+ * keeps the work its render spent, for a hit to honour the work budget of
+ * the render it stands for.
+ *
+ * The blocks are held by hoedown, which leaves it to the caller to keep
+ * renders of different configurations apart: a block cache is emptied
+ * when it is used with another configuration than the last one.
+ */
+
+struct tmh_cache_entry {
+    struct tmh_cache_entry *prev, *next;  /* most recently used first */
+    char digest[16];
+    SV *config;
+    SV *src;
+    SV *out;
+    size_t work;    /* units of work of the render that stored it */
+    size_t size;    /* bytes accounted for the entry */
+};
+
+struct tmh_cache {
+    HV *index;      /* digest => struct tmh_cache_entry address */
+    struct tmh_cache_entry lru;  /* list head */
+    size_t max_bytes;
+    size_t bytes;
+    UV hits, misses;
+};
+
+/* fixed cost of an entry besides its strings: the entry, three SVs and
+ * the index slot, roughly */
+#define TMH_CACHE_ENTRY_COST (sizeof(struct tmh_cache_entry) + 4 * sizeof(SV) + 64)
+
+/* tmh_hash: 64 bit hash of data, eight bytes at a time */
+static U64
+tmh_hash(const char *data, STRLEN len, U64 seed)
+{
+    const U64 m = UINT64_C(0x9E3779B97F4A7C15);
+    U64 h = seed ^ (len * m), w;
+
+    while (len >= 8) {
+        memcpy(&w, data, 8);
+        h = (h ^ (w * m)) * m;
+        h ^= h >> 29;
+        data += 8;
+        len -= 8;
+    }
+
+    w = 0;
+    memcpy(&w, data, len);
+    h = (h ^ (w * m)) * m;
+    h ^= h >> 32;
+    return h;
+}
+
+static void
+tmh_cache_digest(char *digest, const char *config, STRLEN config_len, const char *src, STRLEN src_len, bool utf8)
+{
+    U64 h[2];
+
+    h[0] = tmh_hash(config, config_len, utf8);
+    h[1] = tmh_hash(src, src_len, h[0]);
+    memcpy(digest, h, sizeof(h));
+}
+
+static struct tmh_cache *
+tmh_cache_new(pTHX_ size_t max_bytes)
+{
+    struct tmh_cache *cache;
+
+    Newxz(cache, 1, struct tmh_cache);
+    cache->index = newHV();
+    cache->lru.prev = cache->lru.next = &cache->lru;
+    cache->max_bytes = max_bytes;
+    return cache;
+}
+
+static void
+tmh_cache_unlink(struct tmh_cache_entry *entry)
+{
+    entry->prev->next = entry->next;
+    entry->next->prev = entry->prev;
+}
+
+static void
+tmh_cache_link_first(struct tmh_cache *cache, struct tmh_cache_entry *entry)
+{
+    entry->prev = &cache->lru;
+    entry->next = cache->lru.next;
+    cache->lru.next->prev = entry;
+    cache->lru.next = entry;
+}
+
+static void
+tmh_cache_evict(pTHX_ struct tmh_cache *cache, struct tmh_cache_entry *entry)
+{
+    tmh_cache_unlink(entry);
+    (void)hv_delete(cache->index, entry->digest, sizeof(entry->digest), G_DISCARD);
+    cache->bytes -= entry->size;
+    SvREFCNT_dec(entry->config);
+    SvREFCNT_dec(entry->src);
+    SvREFCNT_dec(entry->out);
+    Safefree(entry);
+}
+
+static void
+tmh_cache_clear(pTHX_ struct tmh_cache *cache)
+{
+    while (cache->lru.next != &cache->lru) {
+        tmh_cache_evict(aTHX_ cache, cache->lru.next);
+    }
+}
+
+static void
+tmh_cache_free(pTHX_ struct tmh_cache *cache)
+{
+    tmh_cache_clear(aTHX_ cache);
+    SvREFCNT_dec((SV*)cache->index);
+    Safefree(cache);
+}
+
+/* the output stored for config and src and the work it took, NULL on a miss */
+static SV *
+tmh_cache_get(pTHX_ struct tmh_cache *cache, SV *config, SV *src_sv, size_t *work)
+{
+    struct tmh_cache_entry *entry;
+    char digest[16];
+    const char *src, *conf;
+    STRLEN src_len, conf_len;
+    SV **slot;
+
+    conf = SvPV(config, conf_len);
+    src = SvPV(src_sv, src_len);
+    tmh_cache_digest(digest, conf, conf_len, src, src_len, SvUTF8(src_sv));
+
+    slot = hv_fetch(cache->index, digest, sizeof(digest), 0);
+    if (slot) {
+        entry = INT2PTR(struct tmh_cache_entry*, SvIV(*slot));
+        if (SvUTF8(entry->src) == SvUTF8(src_sv) && sv_eq(entry->config, config) &&
+            SvCUR(entry->src) == src_len && memcmp(SvPVX(entry->src), src, src_len) == 0) {
+            tmh_cache_unlink(entry);
+            tmh_cache_link_first(cache, entry);
+            cache->hits++;
+            *work = entry->work;
+            return entry->out;
+        }
+    }
+
+    cache->misses++;
+    return NULL;
+}
+
+/* stores a copy of out, evicting the least recently used entries over the budget */
+static void
+tmh_cache_put(pTHX_ struct tmh_cache *cache, SV *config, SV *src_sv, SV *out, size_t work)
+{
+    struct tmh_cache_entry *entry;
+    const char *src, *conf;
+    STRLEN src_len, conf_len;
+    SV **slot;
+    size_t size;
+
+    conf = SvPV(config, conf_len);
+    src = SvPV(src_sv, src_len);
+    size = TMH_CACHE_ENTRY_COST + conf_len + src_len + SvCUR(out);
+    if (size > cache->max_bytes) {
+        return;
+    }
+
+    Newxz(entry, 1, struct tmh_cache_entry);
+    tmh_cache_digest(entry->digest, conf, conf_len, src, src_len, SvUTF8(src_sv));
+
+    /* a colliding entry makes room */
+    slot = hv_fetch(cache->index, entry->digest, sizeof(entry->digest), 0);
+    if (slot) {
+        tmh_cache_evict(aTHX_ cache, INT2PTR(struct tmh_cache_entry*, SvIV(*slot)));
+    }
+
+    while (cache->bytes + size > cache->max_bytes) {
+        tmh_cache_evict(aTHX_ cache, cache->lru.prev);
+    }
+
+    entry->config = SvREFCNT_inc_simple_NN(config);  /* never changed once built */
+    entry->src = newSVpvn_flags(src, src_len, SvUTF8(src_sv));
+    entry->out = newSVsv(out);
+    entry->work = work;
+    entry->size = size;
+    (void)hv_store(cache->index, entry->digest, sizeof(entry->digest), newSViv(PTR2IV(entry)), 0);
+    tmh_cache_link_first(cache, entry);
+    cache->bytes += size;
+}
+
+struct tmh_block_cache {
+    hoedown_block_cache *blocks;
+    SV *config;     /* of the last render, NULL before the first one */
+};
+
+static struct tmh_block_cache *
+tmh_block_cache_new(pTHX_ size_t max_bytes)
+{
+    struct tmh_block_cache *cache;
+
+    Newxz(cache, 1, struct tmh_block_cache);
+    cache->blocks = hoedown_block_cache_new(max_bytes);
+    if (!cache->blocks) {
+        Safefree(cache);
+        croak("Cannot create new hoedown_block_cache(malloc failed)");
+    }
+    return cache;
+}
+
+static void
+tmh_block_cache_free(pTHX_ struct tmh_block_cache *cache)
+{
+    hoedown_block_cache_free(cache->blocks);
+    SvREFCNT_dec(cache->config);
+    Safefree(cache);
+}
+
+/* the blocks to render config with, emptied if they were rendered with another one */
+static hoedown_block_cache *
+tmh_block_cache_bind(pTHX_ struct tmh_block_cache *cache, SV *config)
+{
+    if (!cache->config || !sv_eq(cache->config, config)) {
+        hoedown_block_cache_clear(cache->blocks);
+        SvREFCNT_dec(cache->config);
+        cache->config = SvREFCNT_inc_simple_NN(config);
+    }
+    return cache->blocks;
+}
@@ -0,0 +1,92 @@
+/* events.c - Renderer::Events, records the parse events of a document
+ * with the hoedown_ast recorder and hands its arrays to one Perl call in
+ * doc_footer.
+ *
+ * The renderer takes the callbacks of hoedown_ast_renderer_new and adds
+ * doc_header and doc_footer; the tree starts the state they share, so
+ * the recording callbacks get it as their hoedown_ast. Node types are
+ * the TMH_CB_* of the callbacks, the two added here recording theirs
+ * with hoedown_ast_leaf and hoedown_ast_finish_as.
+ */
+
+struct tmh_events {
+    hoedown_ast ast;  /* first, it is the opaque of the recording callbacks */
+    SV* handler;
+};
+
+static void
+tmh_ev_doc_header(hoedown_buffer *ob, void *opaque)
+{
+    struct tmh_events *st = (struct tmh_events*)opaque;
+
+    hoedown_ast_reset(&st->ast);
+    hoedown_ast_leaf(&st->ast, ob, TMH_CB_doc_header, 0);
+}
+
+#define PUSHPOOL(buf) \
+    mXPUSHp(buf->size ? (const char*)buf->data : "", buf->size)
+
+/* the document is the last event, its output is what the handler returns */
+static void
+tmh_ev_doc_footer(hoedown_buffer *ob, void *opaque)
+{
+    dTHX; dSP;
+    struct tmh_events *st = (struct tmh_events*)opaque;
+    SV* cb = st->handler;
+
+    hoedown_ast_finish_as(&st->ast, ob, TMH_CB_doc_footer);
+
+    CB_HEADER;
+    PUSHPOOL(st->ast.nodes);
+    PUSHPOOL(st->ast.kids);
+    PUSHPOOL(st->ast.text);
+    CB_FOOTER_VOID;
+}
+
+static hoedown_renderer *
+tmh_events_renderer_new(pTHX_ SV *handler)
+{
+    hoedown_renderer *renderer, *recorder;
+    struct tmh_events *st;
+
+    Newxz(st, 1, struct tmh_events);
+    recorder = hoedown_ast_renderer_new(&st->ast);
+    if (!recorder) {
+        Safefree(st);
+        croak("Cannot create new renderer(malloc failed)");
+    }
+
+    st->ast.nodes = hoedown_buffer_new(64 * sizeof(hoedown_ast_node));
+    st->ast.kids = hoedown_buffer_new(64 * sizeof(uint32_t));
+    st->ast.text = hoedown_buffer_new(1024);
+    if (!st->ast.nodes || !st->ast.kids || !st->ast.text) {
+        hoedown_buffer_free(st->ast.nodes);
+        hoedown_buffer_free(st->ast.kids);
+        hoedown_buffer_free(st->ast.text);
+        hoedown_ast_renderer_free(recorder);
+        Safefree(st);
+        croak("Cannot create new renderer(malloc failed)");
+    }
+    st->handler = newSVsv(handler);
+
+    Newx(renderer, 1, hoedown_renderer);
+    memcpy(renderer, recorder, sizeof(hoedown_renderer));
+    hoedown_ast_renderer_free(recorder);
+    renderer->doc_header = tmh_ev_doc_header;
+    renderer->doc_footer = tmh_ev_doc_footer;
+    renderer->opaque = st;
+    return renderer;
+}
+
+static void
+tmh_events_renderer_free(pTHX_ hoedown_renderer *renderer)
+{
+    struct tmh_events *st = (struct tmh_events*)renderer->opaque;
+
+    hoedown_buffer_free(st->ast.nodes);
+    hoedown_buffer_free(st->ast.kids);
+    hoedown_buffer_free(st->ast.text);
+    SvREFCNT_dec(st->handler);
+    Safefree(st);
+    Safefree(renderer);
+}
@@ -1,11 +1,95 @@
 
+enum tmh_callback_index {
+    TMH_CB_blockcode,
+    TMH_CB_blockquote,
+    TMH_CB_blockhtml,
+    TMH_CB_header,
+    TMH_CB_hrule,
+    TMH_CB_list,
+    TMH_CB_listitem,
+    TMH_CB_paragraph,
+    TMH_CB_table,
+    TMH_CB_table_row,
+    TMH_CB_table_cell,
+    TMH_CB_footnotes,
+    TMH_CB_footnote_def,
+    TMH_CB_autolink,
+    TMH_CB_codespan,
+    TMH_CB_double_emphasis,
+    TMH_CB_emphasis,
+    TMH_CB_underline,
+    TMH_CB_highlight,
+    TMH_CB_quote,
+    TMH_CB_image,
+    TMH_CB_linebreak,
+    TMH_CB_link,
+    TMH_CB_raw_html_tag,
+    TMH_CB_triple_emphasis,
+    TMH_CB_strikethrough,
+    TMH_CB_superscript,
+    TMH_CB_footnote_ref,
+    TMH_CB_entity,
+    TMH_CB_normal_text,
+    TMH_CB_doc_header,
+    TMH_CB_doc_footer,
+    TMH_CB_COUNT
+};
+
+static const char* tmh_callback_names[] = {
+    "blockcode",
+    "blockquote",
+    "blockhtml",
+    "header",
+    "hrule",
+    "list",
+    "listitem",
+    "paragraph",
+    "table",
+    "table_row",
+    "table_cell",
+    "footnotes",
+    "footnote_def",
+    "autolink",
+    "codespan",
+    "double_emphasis",
+    "emphasis",
+    "underline",
+    "highlight",
+    "quote",
+    "image",
+    "linebreak",
+    "link",
+    "raw_html_tag",
+    "triple_emphasis",
+    "strikethrough",
+    "superscript",
+    "footnote_ref",
+    "entity",
+    "normal_text",
+    "doc_header",
+    "doc_footer",
+};
+
+/* Perl callbacks of a renderer, an SV* code ref per callback or NULL.
+ * the renderer's opaque starts with a pointer to it: the Callback
+ * renderer's opaque is this struct, pointing to itself, and the HTML
+ * renderers keep it in hoedown_html_renderer_state.opaque */
+struct tmh_callbacks {
+    struct tmh_callbacks* self;
+    const hoedown_renderer* native;  /* callbacks to restore, or NULL */
+    SV* cb[TMH_CB_COUNT];
+};
+
+#define TMH_CALLBACKS(opaque) (*(struct tmh_callbacks**)(opaque))
+
 void tmh_cb_blockcode(hoedown_buffer *ob, const hoedown_buffer *text, const hoedown_buffer *lang, void *opaque) {
     dTHX; dSP; bool is_null = 0;
-    SV** rcb = hv_fetchs((HV*)opaque, "blockcode", 0);
+    SV* cb = TMH_CALLBACKS(opaque)->cb[TMH_CB_blockcode];
     
-    if (!rcb) { return; }
+    if (!cb) { return; }
     
-    CB_HEADER("blockcode");
+    TMH_FLUSH_TEXT(opaque);
+    CB_HEADER;
     
         PUSHBUF(text);
     
@@ -16,11 +100,12 @@ void tmh_cb_blockcode(hoedown_buffer *ob, const hoedown_buffer *text, const hoed
 }
 void tmh_cb_blockquote(hoedown_buffer *ob, const hoedown_buffer *text, void *opaque) {
     dTHX; dSP; bool is_null = 0;
-    SV** rcb = hv_fetchs((HV*)opaque, "blockquote", 0);
+    SV* cb = TMH_CALLBACKS(opaque)->cb[TMH_CB_blockquote];
     
-    if (!rcb) { return; }
+    if (!cb) { return; }
     
-    CB_HEADER("blockquote");
+    TMH_FLUSH_TEXT(opaque);
+    CB_HEADER;
     
         PUSHBUF(text);
     
@@ -29,11 +114,12 @@ void tmh_cb_blockquote(hoedown_buffer *ob, const hoedown_buffer *text, void *opa
 }
 void tmh_cb_blockhtml(hoedown_buffer *ob,const  hoedown_buffer *text, void *opaque) {
     dTHX; dSP; bool is_null = 0;
-    SV** rcb = hv_fetchs((HV*)opaque, "blockhtml", 0);
+    SV* cb = TMH_CALLBACKS(opaque)->cb[TMH_CB_blockhtml];
     
-    if (!rcb) { return; }
+    if (!cb) { return; }
     
-    CB_HEADER("blockhtml");
+    TMH_FLUSH_TEXT(opaque);
+    CB_HEADER;
     
         PUSHBUF(text);
     
@@ -42,11 +128,12 @@ void tmh_cb_blockhtml(hoedown_buffer *ob,const  hoedown_buffer *text, void *opaq
 }
 void tmh_cb_header(hoedown_buffer *ob, const hoedown_buffer *text, int level, void *opaque) {
     dTHX; dSP; bool is_null = 0;
-    SV** rcb = hv_fetchs((HV*)opaque, "header", 0);
+    SV* cb = TMH_CALLBACKS(opaque)->cb[TMH_CB_header];
     
-    if (!rcb) { return; }
+    if (!cb) { return; }
     
-    CB_HEADER("header");
+    TMH_FLUSH_TEXT(opaque);
+    CB_HEADER;
     
         PUSHBUF(text);
     
@@ -57,22 +144,24 @@ void tmh_cb_header(hoedown_buffer *ob, const hoedown_buffer *text, int level, vo
 }
 void tmh_cb_hrule(hoedown_buffer *ob, void *opaque) {
     dTHX; dSP; bool is_null = 0;
-    SV** rcb = hv_fetchs((HV*)opaque, "hrule", 0);
+    SV* cb = TMH_CALLBACKS(opaque)->cb[TMH_CB_hrule];
     
-    if (!rcb) { return; }
+    if (!cb) { return; }
     
-    CB_HEADER("hrule");
+    TMH_FLUSH_TEXT(opaque);
+    CB_HEADER;
     
     CB_FOOTER;
     
 }
 void tmh_cb_list(hoedown_buffer *ob, const hoedown_buffer *text, int flags, void *opaque) {
     dTHX; dSP; bool is_null = 0;
-    SV** rcb = hv_fetchs((HV*)opaque, "list", 0);
+    SV* cb = TMH_CALLBACKS(opaque)->cb[TMH_CB_list];
     
-    if (!rcb) { return; }
+    if (!cb) { return; }
     
-    CB_HEADER("list");
+    TMH_FLUSH_TEXT(opaque);
+    CB_HEADER;
     
         PUSHBUF(text);
     
@@ -83,11 +172,12 @@ void tmh_cb_list(hoedown_buffer *ob, const hoedown_buffer *text, int flags, void
 }
 void tmh_cb_listitem(hoedown_buffer *ob, const hoedown_buffer *text, int flags, void *opaque) {
     dTHX; dSP; bool is_null = 0;
-    SV** rcb = hv_fetchs((HV*)opaque, "listitem", 0);
+    SV* cb = TMH_CALLBACKS(opaque)->cb[TMH_CB_listitem];
     
-    if (!rcb) { return; }
+    if (!cb) { return; }
     
-    CB_HEADER("listitem");
+    TMH_FLUSH_TEXT(opaque);
+    CB_HEADER;
     
         PUSHBUF(text);
     
@@ -98,11 +188,12 @@ void tmh_cb_listitem(hoedown_buffer *ob, const hoedown_buffer *text, int flags,
 }
 void tmh_cb_paragraph(hoedown_buffer *ob, const hoedown_buffer *text, void *opaque) {
     dTHX; dSP; bool is_null = 0;
-    SV** rcb = hv_fetchs((HV*)opaque, "paragraph", 0);
+    SV* cb = TMH_CALLBACKS(opaque)->cb[TMH_CB_paragraph];
     
-    if (!rcb) { return; }
+    if (!cb) { return; }
     
-    CB_HEADER("paragraph");
+    TMH_FLUSH_TEXT(opaque);
+    CB_HEADER;
     
         PUSHBUF(text);
     
@@ -111,11 +202,12 @@ void tmh_cb_paragraph(hoedown_buffer *ob, const hoedown_buffer *text, void *opaq
 }
 void tmh_cb_table(hoedown_buffer *ob, const hoedown_buffer *header, const hoedown_buffer *body, void *opaque) {
     dTHX; dSP; bool is_null = 0;
-    SV** rcb = hv_fetchs((HV*)opaque, "table", 0);
+    SV* cb = TMH_CALLBACKS(opaque)->cb[TMH_CB_table];
     
-    if (!rcb) { return; }
+    if (!cb) { return; }
     
-    CB_HEADER("table");
+    TMH_FLUSH_TEXT(opaque);
+    CB_HEADER;
     
         PUSHBUF(header);
     
@@ -126,11 +218,12 @@ void tmh_cb_table(hoedown_buffer *ob, const hoedown_buffer *header, const hoedow
 }
 void tmh_cb_table_row(hoedown_buffer *ob, const hoedown_buffer *text, void *opaque) {
     dTHX; dSP; bool is_null = 0;
-    SV** rcb = hv_fetchs((HV*)opaque, "table_row", 0);
+    SV* cb = TMH_CALLBACKS(opaque)->cb[TMH_CB_table_row];
     
-    if (!rcb) { return; }
+    if (!cb) { return; }
     
-    CB_HEADER("table_row");
+    TMH_FLUSH_TEXT(opaque);
+    CB_HEADER;
     
         PUSHBUF(text);
     
@@ -139,11 +232,12 @@ void tmh_cb_table_row(hoedown_buffer *ob, const hoedown_buffer *text, void *opaq
 }
 void tmh_cb_table_cell(hoedown_buffer *ob, const hoedown_buffer *text, int flags, void *opaque) {
     dTHX; dSP; bool is_null = 0;
-    SV** rcb = hv_fetchs((HV*)opaque, "table_cell", 0);
+    SV* cb = TMH_CALLBACKS(opaque)->cb[TMH_CB_table_cell];
     
-    if (!rcb) { return; }
+    if (!cb) { return; }
     
-    CB_HEADER("table_cell");
+    TMH_FLUSH_TEXT(opaque);
+    CB_HEADER;
     
         PUSHBUF(text);
     
@@ -154,11 +248,12 @@ void tmh_cb_table_cell(hoedown_buffer *ob, const hoedown_buffer *text, int flags
 }
 void tmh_cb_footnotes(hoedown_buffer *ob, const hoedown_buffer *text, void *opaque) {
     dTHX; dSP; bool is_null = 0;
-    SV** rcb = hv_fetchs((HV*)opaque, "footnotes", 0);
+    SV* cb = TMH_CALLBACKS(opaque)->cb[TMH_CB_footnotes];
     
-    if (!rcb) { return; }
+    if (!cb) { return; }
     
-    CB_HEADER("footnotes");
+    TMH_FLUSH_TEXT(opaque);
+    CB_HEADER;
     
         PUSHBUF(text);
     
@@ -167,11 +262,12 @@ void tmh_cb_footnotes(hoedown_buffer *ob, const hoedown_buffer *text, void *opaq
 }
 void tmh_cb_footnote_def(hoedown_buffer *ob, const hoedown_buffer *text, unsigned int num, void *opaque) {
     dTHX; dSP; bool is_null = 0;
-    SV** rcb = hv_fetchs((HV*)opaque, "footnote_def", 0);
+    SV* cb = TMH_CALLBACKS(opaque)->cb[TMH_CB_footnote_def];
     
-    if (!rcb) { return; }
+    if (!cb) { return; }
     
-    CB_HEADER("footnote_def");
+    TMH_FLUSH_TEXT(opaque);
+    CB_HEADER;
     
         PUSHBUF(text);
     
@@ -182,11 +278,12 @@ void tmh_cb_footnote_def(hoedown_buffer *ob, const hoedown_buffer *text, unsigne
 }
 int tmh_cb_autolink(hoedown_buffer *ob, const hoedown_buffer *link, enum hoedown_autolink type, void *opaque) {
     dTHX; dSP; bool is_null = 0;
-    SV** rcb = hv_fetchs((HV*)opaque, "autolink", 0);
+    SV* cb = TMH_CALLBACKS(opaque)->cb[TMH_CB_autolink];
     
-    if (!rcb) { return 0; }
+    if (!cb) { return 0; }
     
-    CB_HEADER("autolink");
+    TMH_FLUSH_TEXT(opaque);
+    CB_HEADER;
     
         PUSHBUF(link);
     
@@ -199,11 +296,12 @@ int tmh_cb_autolink(hoedown_buffer *ob, const hoedown_buffer *link, enum hoedown
 }
 int tmh_cb_codespan(hoedown_buffer *ob, const hoedown_buffer *text, void *opaque) {
     dTHX; dSP; bool is_null = 0;
-    SV** rcb = hv_fetchs((HV*)opaque, "codespan", 0);
+    SV* cb = TMH_CALLBACKS(opaque)->cb[TMH_CB_codespan];
     
-    if (!rcb) { return 0; }
+    if (!cb) { return 0; }
     
-    CB_HEADER("codespan");
+    TMH_FLUSH_TEXT(opaque);
+    CB_HEADER;
     
         PUSHBUF(text);
     
@@ -214,11 +312,12 @@ int tmh_cb_codespan(hoedown_buffer *ob, const hoedown_buffer *text, void *opaque
 }
 int tmh_cb_double_emphasis(hoedown_buffer *ob, const hoedown_buffer *text, void *opaque) {
     dTHX; dSP; bool is_null = 0;
-    SV** rcb = hv_fetchs((HV*)opaque, "double_emphasis", 0);
+    SV* cb = TMH_CALLBACKS(opaque)->cb[TMH_CB_double_emphasis];
     
-    if (!rcb) { return 0; }
+    if (!cb) { return 0; }
     
-    CB_HEADER("double_emphasis");
+    TMH_FLUSH_TEXT(opaque);
+    CB_HEADER;
     
         PUSHBUF(text);
     
@@ -229,11 +328,12 @@ int tmh_cb_double_emphasis(hoedown_buffer *ob, const hoedown_buffer *text, void
 }
 int tmh_cb_emphasis(hoedown_buffer *ob, const hoedown_buffer *text, void *opaque) {
     dTHX; dSP; bool is_null = 0;
-    SV** rcb = hv_fetchs((HV*)opaque, "emphasis", 0);
+    SV* cb = TMH_CALLBACKS(opaque)->cb[TMH_CB_emphasis];
     
-    if (!rcb) { return 0; }
+    if (!cb) { return 0; }
     
-    CB_HEADER("emphasis");
+    TMH_FLUSH_TEXT(opaque);
+    CB_HEADER;
     
         PUSHBUF(text);
     
@@ -244,11 +344,12 @@ int tmh_cb_emphasis(hoedown_buffer *ob, const hoedown_buffer *text, void *opaque
 }
 int tmh_cb_underline(hoedown_buffer *ob, const hoedown_buffer *text, void *opaque) {
     dTHX; dSP; bool is_null = 0;
-    SV** rcb = hv_fetchs((HV*)opaque, "underline", 0);
+    SV* cb = TMH_CALLBACKS(opaque)->cb[TMH_CB_underline];
     
-    if (!rcb) { return 0; }
+    if (!cb) { return 0; }
     
-    CB_HEADER("underline");
+    TMH_FLUSH_TEXT(opaque);
+    CB_HEADER;
     
         PUSHBUF(text);
     
@@ -259,11 +360,12 @@ int tmh_cb_underline(hoedown_buffer *ob, const hoedown_buffer *text, void *opaqu
 }
 int tmh_cb_highlight(hoedown_buffer *ob, const hoedown_buffer *text, void *opaque) {
     dTHX; dSP; bool is_null = 0;
-    SV** rcb = hv_fetchs((HV*)opaque, "highlight", 0);
+    SV* cb = TMH_CALLBACKS(opaque)->cb[TMH_CB_highlight];
     
-    if (!rcb) { return 0; }
+    if (!cb) { return 0; }
     
-    CB_HEADER("highlight");
+    TMH_FLUSH_TEXT(opaque);
+    CB_HEADER;
     
         PUSHBUF(text);
     
@@ -274,11 +376,12 @@ int tmh_cb_highlight(hoedown_buffer *ob, const hoedown_buffer *text, void *opaqu
 }
 int tmh_cb_quote(hoedown_buffer *ob, const hoedown_buffer *text, void *opaque) {
     dTHX; dSP; bool is_null = 0;
-    SV** rcb = hv_fetchs((HV*)opaque, "quote", 0);
+    SV* cb = TMH_CALLBACKS(opaque)->cb[TMH_CB_quote];
     
-    if (!rcb) { return 0; }
+    if (!cb) { return 0; }
     
-    CB_HEADER("quote");
+    TMH_FLUSH_TEXT(opaque);
+    CB_HEADER;
     
         PUSHBUF(text);
     
@@ -289,11 +392,12 @@ int tmh_cb_quote(hoedown_buffer *ob, const hoedown_buffer *text, void *opaque) {
 }
 int tmh_cb_image(hoedown_buffer *ob, const hoedown_buffer *link, const hoedown_buffer *title, const hoedown_buffer *alt, void *opaque) {
     dTHX; dSP; bool is_null = 0;
-    SV** rcb = hv_fetchs((HV*)opaque, "image", 0);
+    SV* cb = TMH_CALLBACKS(opaque)->cb[TMH_CB_image];
     
-    if (!rcb) { return 0; }
+    if (!cb) { return 0; }
     
-    CB_HEADER("image");
+    TMH_FLUSH_TEXT(opaque);
+    CB_HEADER;
     
         PUSHBUF(link);
     
@@ -308,11 +412,12 @@ int tmh_cb_image(hoedown_buffer *ob, const hoedown_buffer *link, const hoedown_b
 }
 int tmh_cb_linebreak(hoedown_buffer *ob, void *opaque) {
     dTHX; dSP; bool is_null = 0;
-    SV** rcb = hv_fetchs((HV*)opaque, "linebreak", 0);
+    SV* cb = TMH_CALLBACKS(opaque)->cb[TMH_CB_linebreak];
     
-    if (!rcb) { return 0; }
+    if (!cb) { return 0; }
     
-    CB_HEADER("linebreak");
+    TMH_FLUSH_TEXT(opaque);
+    CB_HEADER;
     
     CB_FOOTER;
     
@@ -321,11 +426,12 @@ int tmh_cb_linebreak(hoedown_buffer *ob, void *opaque) {
 }
 int tmh_cb_link(hoedown_buffer *ob, const hoedown_buffer *link, const hoedown_buffer *title, const hoedown_buffer *content, void *opaque) {
     dTHX; dSP; bool is_null = 0;
-    SV** rcb = hv_fetchs((HV*)opaque, "link", 0);
+    SV* cb = TMH_CALLBACKS(opaque)->cb[TMH_CB_link];
     
-    if (!rcb) { return 0; }
+    if (!cb) { return 0; }
     
-    CB_HEADER("link");
+    TMH_FLUSH_TEXT(opaque);
+    CB_HEADER;
     
         PUSHBUF(link);
     
@@ -340,11 +446,12 @@ int tmh_cb_link(hoedown_buffer *ob, const hoedown_buffer *link, const hoedown_bu
 }
 int tmh_cb_raw_html_tag(hoedown_buffer *ob, const hoedown_buffer *tag, void *opaque) {
     dTHX; dSP; bool is_null = 0;
-    SV** rcb = hv_fetchs((HV*)opaque, "raw_html_tag", 0);
+    SV* cb = TMH_CALLBACKS(opaque)->cb[TMH_CB_raw_html_tag];
     
-    if (!rcb) { return 0; }
+    if (!cb) { return 0; }
     
-    CB_HEADER("raw_html_tag");
+    TMH_FLUSH_TEXT(opaque);
+    CB_HEADER;
     
         PUSHBUF(tag);
     
@@ -355,11 +462,12 @@ int tmh_cb_raw_html_tag(hoedown_buffer *ob, const hoedown_buffer *tag, void *opa
 }
 int tmh_cb_triple_emphasis(hoedown_buffer *ob, const hoedown_buffer *text, void *opaque) {
     dTHX; dSP; bool is_null = 0;
-    SV** rcb = hv_fetchs((HV*)opaque, "triple_emphasis", 0);
+    SV* cb = TMH_CALLBACKS(opaque)->cb[TMH_CB_triple_emphasis];
     
-    if (!rcb) { return 0; }
+    if (!cb) { return 0; }
     
-    CB_HEADER("triple_emphasis");
+    TMH_FLUSH_TEXT(opaque);
+    CB_HEADER;
     
         PUSHBUF(text);
     
@@ -370,11 +478,12 @@ int tmh_cb_triple_emphasis(hoedown_buffer *ob, const hoedown_buffer *text, void
 }
 int tmh_cb_strikethrough(hoedown_buffer *ob, const hoedown_buffer *text, void *opaque) {
     dTHX; dSP; bool is_null = 0;
-    SV** rcb = hv_fetchs((HV*)opaque, "strikethrough", 0);
+    SV* cb = TMH_CALLBACKS(opaque)->cb[TMH_CB_strikethrough];
     
-    if (!rcb) { return 0; }
+    if (!cb) { return 0; }
     
-    CB_HEADER("strikethrough");
+    TMH_FLUSH_TEXT(opaque);
+    CB_HEADER;
     
         PUSHBUF(text);
     
@@ -385,11 +494,12 @@ int tmh_cb_strikethrough(hoedown_buffer *ob, const hoedown_buffer *text, void *o
 }
 int tmh_cb_superscript(hoedown_buffer *ob, const hoedown_buffer *text, void *opaque) {
     dTHX; dSP; bool is_null = 0;
-    SV** rcb = hv_fetchs((HV*)opaque, "superscript", 0);
+    SV* cb = TMH_CALLBACKS(opaque)->cb[TMH_CB_superscript];
     
-    if (!rcb) { return 0; }
+    if (!cb) { return 0; }
     
-    CB_HEADER("superscript");
+    TMH_FLUSH_TEXT(opaque);
+    CB_HEADER;
     
         PUSHBUF(text);
     
@@ -400,11 +510,12 @@ int tmh_cb_superscript(hoedown_buffer *ob, const hoedown_buffer *text, void *opa
 }
 int tmh_cb_footnote_ref(hoedown_buffer *ob, unsigned int num, void *opaque) {
     dTHX; dSP; bool is_null = 0;
-    SV** rcb = hv_fetchs((HV*)opaque, "footnote_ref", 0);
+    SV* cb = TMH_CALLBACKS(opaque)->cb[TMH_CB_footnote_ref];
     
-    if (!rcb) { return 0; }
+    if (!cb) { return 0; }
     
-    CB_HEADER("footnote_ref");
+    TMH_FLUSH_TEXT(opaque);
+    CB_HEADER;
     
         mXPUSHu(num);
     
@@ -415,11 +526,12 @@ int tmh_cb_footnote_ref(hoedown_buffer *ob, unsigned int num, void *opaque) {
 }
 void tmh_cb_entity(hoedown_buffer *ob, const hoedown_buffer *entity, void *opaque) {
     dTHX; dSP; bool is_null = 0;
-    SV** rcb = hv_fetchs((HV*)opaque, "entity", 0);
+    SV* cb = TMH_CALLBACKS(opaque)->cb[TMH_CB_entity];
     
-    if (!rcb) { return; }
+    if (!cb) { return; }
     
-    CB_HEADER("entity");
+    TMH_FLUSH_TEXT(opaque);
+    CB_HEADER;
     
         PUSHBUF(entity);
     
@@ -428,11 +540,12 @@ void tmh_cb_entity(hoedown_buffer *ob, const hoedown_buffer *entity, void *opaqu
 }
 void tmh_cb_normal_text(hoedown_buffer *ob, const hoedown_buffer *text, void *opaque) {
     dTHX; dSP; bool is_null = 0;
-    SV** rcb = hv_fetchs((HV*)opaque, "normal_text", 0);
+    SV* cb = TMH_CALLBACKS(opaque)->cb[TMH_CB_normal_text];
     
-    if (!rcb) { return; }
+    if (!cb) { return; }
     
-    CB_HEADER("normal_text");
+    TMH_FLUSH_TEXT(opaque);
+    CB_HEADER;
     
         PUSHBUF(text);
     
@@ -441,22 +554,24 @@ void tmh_cb_normal_text(hoedown_buffer *ob, const hoedown_buffer *text, void *op
 }
 void tmh_cb_doc_header(hoedown_buffer *ob, void *opaque) {
     dTHX; dSP; bool is_null = 0;
-    SV** rcb = hv_fetchs((HV*)opaque, "doc_header", 0);
+    SV* cb = TMH_CALLBACKS(opaque)->cb[TMH_CB_doc_header];
     
-    if (!rcb) { return; }
+    if (!cb) { return; }
     
-    CB_HEADER("doc_header");
+    TMH_FLUSH_TEXT(opaque);
+    CB_HEADER;
     
     CB_FOOTER;
     
 }
 void tmh_cb_doc_footer(hoedown_buffer *ob, void *opaque) {
     dTHX; dSP; bool is_null = 0;
-    SV** rcb = hv_fetchs((HV*)opaque, "doc_footer", 0);
+    SV* cb = TMH_CALLBACKS(opaque)->cb[TMH_CB_doc_footer];
     
-    if (!rcb) { return; }
+    if (!cb) { return; }
     
-    CB_HEADER("doc_footer");
+    TMH_FLUSH_TEXT(opaque);
+    CB_HEADER;
     
     CB_FOOTER;
     
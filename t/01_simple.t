@@ -16,6 +16,16 @@ is(markdown("# foo"), qq{<h1 id="toc_0">foo</h1>\n});
 }
 
 is(markdown("http://mixi.jp", extensions => HOEDOWN_EXT_AUTOLINK), qq{<p><a href="http://mixi.jp">http://mixi.jp</a></p>\n});
+like(markdown("* a\0b\n"), qr{^<ul>\n<li>a}, 'NUL in a list item');
+is(markdown("_a_b\@c.d x\@y.https://x.y\n", extensions => HOEDOWN_EXT_AUTOLINK),
+    qq{<p><em>a</em><a href="mailto:b\@c.d">b\@c.d</a> <a href="mailto:x\@y.https">x\@y.https</a>://x.y</p>\n},
+    'autolinks leave the markup before them whole');
+is(markdown(qq{```c\nif (a < b && c) {\n\n    x = "/";\n}\n```\n}, extensions => HOEDOWN_EXT_FENCED_CODE),
+    qq{<pre><code class="c">if (a &lt; b &amp;&amp; c) {\n\n    x = &quot;/&quot;;\n}\n</code></pre>\n}, 'fenced code');
+is(markdown("```\na\n   \nb\n```\n", extensions => HOEDOWN_EXT_FENCED_CODE),
+    qq{<pre><code>a\n\nb\n</code></pre>\n}, 'lines of spaces in fenced code are empty');
+is(markdown("~~~\nopen ``` not closing\n```\nmore", extensions => HOEDOWN_EXT_FENCED_CODE),
+    qq{<pre><code>open ``` not closing\n</code></pre>\n\n<p>more</p>\n}, 'any fence closes');
 
 done_testing;
 
@@ -1,7 +1,7 @@
 use strict;
 use Test::More;
 
-use Text::Markdown::Hoedown;
+use Text::Markdown::Hoedown qw(:DEFAULT markdown_with_toc);
 
 my $src = <<'...';
 # 1
@@ -63,5 +63,77 @@ is(markdown($src, html_options => HOEDOWN_HTML_TOC), <<'...');
 <h2 id="toc_6">2.2</h2>
 ...
 
+{
+    my ($html, $toc) = markdown_with_toc($src);
+    is $html, markdown($src, toc_nesting_lvl => 6), 'one pass renders the same html';
+    is $toc, markdown_toc($src), 'and the same toc';
+
+    my $md = Text::Markdown::Hoedown::Markdown->new(0, 16,
+        Text::Markdown::Hoedown::Renderer::HTML->new(0, 6));
+    $md->collect_toc(Text::Markdown::Hoedown::Renderer::HTMLTOC->new(6));
+    $md->render("# a\n");
+    is $md->toc, qq{<ul>\n<li>\n<a href="#toc_0">a</a>\n</li>\n</ul>\n};
+    is $md->toc, '', 'taking the toc empties it';
+}
+
+{
+    my ($html, $toc) = markdown_with_toc("# a *b* &amp; `c`\n## skipped\n", nesting_level => 1);
+    is $html, qq{<h1 id="toc_0">a <em>b</em> &amp; <code>c</code></h1>\n\n<h2>skipped</h2>\n};
+    is $toc, markdown_toc("# a *b* &amp; `c`\n## skipped\n", nesting_level => 1), 'labels are escaped as by markdown_toc';
+}
+
+for my $case (
+    ["# a *b* &amp; `c` [l](u) ![i](x) <b>r</b> http://x.y \\* \"q\"\n", HOEDOWN_EXT_AUTOLINK | HOEDOWN_EXT_QUOTE],
+    ["# a\n\n> # q\n>\n> ## r\n\n## b\n"],
+    ["## x\n# a\n\n* item\n\n    # nested\n\n### c\n"],
+    ["a\n===\n\nb <x\@y.z>  \n---\n\n[l]: http://x.y\n\n# [ref][l] and [^1]\n\n[^1]: # note\n", HOEDOWN_EXT_FOOTNOTES],
+    ["<div>\n# in html\n</div>\n\n# after\n"],
+    ["# ~~s~~ ==h== ^sup\n", HOEDOWN_EXT_STRIKETHROUGH | HOEDOWN_EXT_HIGHLIGHT | HOEDOWN_EXT_SUPERSCRIPT],
+    ["# http://a.[^1]\n\n[^1]: # n\n", HOEDOWN_EXT_AUTOLINK | HOEDOWN_EXT_FOOTNOTES],
+) {
+    my ($src, $ext) = @$case;
+    for my $level (1, 2, 6) {
+        my %opts = (extensions => $ext || 0, nesting_level => $level);
+        my ($html, $toc) = markdown_with_toc($src, %opts);
+        is $toc, markdown_toc($src, %opts), "same toc at level $level for $src";
+        is $html, markdown($src, extensions => $ext || 0, toc_nesting_lvl => $level);
+    }
+}
+
+is markdown_toc("# a\n\n> ## q\n\n# b\n"),
+    qq{<ul>\n<li>\n<a href="#toc_0">a</a>\n</li>\n<li>\n<a href="#toc_2">b</a>\n</li>\n</ul>\n},
+    'a nested header only takes its id';
+is markdown_toc("<div>\n# in html\n</div>\n\n# after\n"),
+    qq{<ul>\n<li>\n<a href="#toc_0">after</a>\n</li>\n</ul>\n}, 'headers in HTML blocks are left out';
+
+{
+    my $md = Text::Markdown::Hoedown::Markdown->new(0, 16,
+        Text::Markdown::Hoedown::Renderer::HTML->new(0, 6));
+    my $toc = Text::Markdown::Hoedown::Renderer::HTMLTOC->new(6);
+    my $die = 1;
+    $toc->emphasis(sub { die "boom\n" if $die; "<i>$_[0]</i>" });
+    $md->collect_toc($toc);
+    eval { $md->render("# a\n\n## *b*\n") };
+    is $@, "boom\n", 'an override of the toc dies through the render';
+    (my $html = $md->render("# c\n\n## b\n")) =~ s/toc_\d+/toc_N/g;
+    is $html, qq{<h1 id="toc_N">c</h1>\n\n<h2 id="toc_N">b</h2>\n}, 'which renders again with its own callbacks';
+    (my $got = $md->toc) =~ s/toc_\d+/toc_N/g;
+    is $got, qq{<ul>\n<li>\n<a href="#toc_N">c</a>\n<ul>\n<li>\n<a href="#toc_N">b</a>\n</li>\n</ul>\n</li>\n</ul>\n}, 'and a TOC with no list left open';
+    $die = 0;
+    $md->render("# *d*\n");
+    ($got = $md->toc) =~ s/toc_\d+/toc_N/g;
+    is $got, qq{<ul>\n<li>\n<a href="#toc_N">&lt;i&gt;d&lt;/i&gt;</a>\n</li>\n</ul>\n}, 'the TOC uses the overrides of its renderer';
+    $md->collect_toc(undef);
+    eval { $md->toc };
+    like $@, qr/not collected/;
+}
+
+{
+    use utf8;
+    my ($html, $toc) = Text::Markdown::Hoedown::Document->new("# あ\n")->html_with_toc;
+    is $toc, qq{<ul>\n<li>\n<a href="#toc_0">あ</a>\n</li>\n</ul>\n};
+    ok utf8::is_utf8($toc);
+}
+
 done_testing;
 
@@ -113,5 +113,17 @@ _under_
 </body></html>
 ,,,
 
+subtest 'unset callbacks' => sub {
+    my $cb = Text::Markdown::Hoedown::Renderer::Callback->new();
+    $cb->paragraph(sub { "<p>$_[0]</p>\n" });
+    $cb->emphasis(sub { "<em>$_[0]</em>" });
+    $cb->emphasis(undef);
+    my $md = Text::Markdown::Hoedown::Markdown->new(0, 16, $cb);
+    is $md->render("*a* b\n"), "<p>*a* b</p>\n";
+
+    $cb->paragraph(undef);
+    is $md->render("*a* b\n"), "";
+};
+
 done_testing;
 
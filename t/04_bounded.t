@@ -0,0 +1,44 @@
+use strict;
+use Test::More;
+
+use Text::Markdown::Hoedown;
+
+ok HOEDOWN_EXT_BOUNDED;
+
+my $extensions = HOEDOWN_EXT_TABLES | HOEDOWN_EXT_FENCED_CODE | HOEDOWN_EXT_AUTOLINK
+    | HOEDOWN_EXT_STRIKETHROUGH | HOEDOWN_EXT_SUPERSCRIPT | HOEDOWN_EXT_FOOTNOTES;
+
+my $src = <<'...';
+# Title
+
+Some *emphasis*, **strong**, `code`, ~~strike~~ and ^(sup) text,
+with [a link](http://example.com/ "title"), [a reference][ref],
+an <span>inline tag</span> and http://example.com/autolink.
+
+<div>
+block html
+</div>
+
+* item [one]
+* item *two* [^1]
+
+| a | b |
+|---|---|
+| 1 | 2 |
+
+[ref]: http://example.com/ref
+[^1]: A footnote.
+...
+
+is(
+    markdown($src, extensions => $extensions | HOEDOWN_EXT_BOUNDED),
+    markdown($src, extensions => $extensions),
+    'same output on a regular document'
+);
+
+for my $src ('[' x 100000, '*a ' x 30000, '[a](' x 25000, "<div>\n" x 15000) {
+    my $html = markdown($src, extensions => $extensions | HOEDOWN_EXT_BOUNDED);
+    ok length($html), 'pathological input of ' . length($src) . ' bytes';
+}
+
+done_testing;
@@ -0,0 +1,34 @@
+use strict;
+use Test::More;
+
+use Text::Markdown::Hoedown;
+
+my $src = join "\n", map { "paragraph *$_* with [a link](http://example.com/$_)\n" } 1..2000;
+
+my $html = markdown($src, work_budget => 10 * length $src);
+like $html, qr{<em>2000</em>}, 'a large enough budget renders everything';
+
+eval { markdown($src, work_budget => 1000) };
+like $@, qr/work budget exceeded/, 'budget exceeded';
+
+my $polls = 0;
+eval { markdown($src, cancel => sub { ++$polls >= 3 }) };
+like $@, qr/cancelled/, 'cancelled';
+is $polls, 3, 'stopped at the first true value';
+
+eval { markdown($src, cancel => sub { die "timeout\n" }) };
+is $@, "timeout\n", 'error of the callback';
+
+is markdown("# foo", cancel => sub { 0 }), qq{<h1 id="toc_0">foo</h1>\n}, 'not cancelled';
+
+{
+    my $renderer = Text::Markdown::Hoedown::Renderer::HTML->new(0, 99);
+    my $md = Text::Markdown::Hoedown::Markdown->new(0, 16, $renderer);
+    $md->set_work_budget(100);
+    eval { $md->render($src) };
+    like $@, qr/work budget exceeded/, 'budget kept by the instance';
+    $md->set_work_budget(0);
+    like $md->render($src), qr{<em>2000</em>}, 'budget removed';
+}
+
+done_testing;
@@ -0,0 +1,72 @@
+use strict;
+use warnings;
+use utf8;
+use Test::More;
+use Text::Markdown::Hoedown;
+
+my $E = 'Text::Markdown::Hoedown::Renderer::Events';
+my %name = map { $E->can(uc $_)->() => $_ } qw(
+    doc_header doc_footer paragraph header emphasis link image autolink
+    normal_text linebreak codespan list listitem table table_row table_cell
+    entity blockcode
+);
+
+# renders the events back into a tree of [name, flags, [strings], [children]]
+my $calls = 0;
+my $tree;
+my $renderer = $E->new(sub {
+    my ($events, $kids, $text) = @_;
+    $calls++;
+    my @kids = unpack 'L*', $kids;
+    my @nodes;
+    for my $i (0 .. length($events) / $E->EVENT_SIZE - 1) {
+        my ($type, $flags, $first, $n, @str) = unpack 'L l L L L6', substr($events, $i * $E->EVENT_SIZE, $E->EVENT_SIZE);
+        my @s;
+        while (my ($off, $len) = splice @str, 0, 2) {
+            push @s, $off == $E->NONE ? undef : substr($text, $off, $len);
+        }
+        pop @s while @s && !defined $s[-1];
+        $nodes[$i] = [$name{$type} || $type, $flags, \@s, [ @nodes[@kids[$first .. $first + $n - 1]] ]];
+    }
+    $tree = $nodes[-1];
+    return "done";
+});
+
+sub flat {
+    my $node = shift;
+    my ($name, $flags, $s, $kids) = @$node;
+    my $body = join '', map { flat($_) } @$kids;
+    return $name eq 'normal_text' ? $s->[0] : "$name(" . join(',', (map { defined $_ ? $_ : 'undef' } @$s), ($body eq '' ? () : $body)) . ")";
+}
+
+my $md = Text::Markdown::Hoedown::Markdown->new(HOEDOWN_EXT_AUTOLINK|HOEDOWN_EXT_TABLES, 16, $renderer);
+
+is $md->render("# Title\n\nHello *world* and [a *b*](/u \"t\")!\n"), "done";
+is $calls, 1, 'one call per render';
+is $tree->[0], 'doc_footer';
+is flat($tree), 'doc_footer(doc_header()header(Title)paragraph(Hello emphasis(world) and link(/u,t,a emphasis(b))!))';
+is $tree->[3][1][1], 1, 'header level';
+
+is flat($md->render("see ![alt](/i.png) at www.example.com  \nnext\n") && $tree),
+    'doc_footer(doc_header()paragraph(see image(/i.png,undef,alt) at link(http://www.example.com,www.example.com)linebreak()next))',
+    'trimmed text';
+
+$md->render("`a\0b` &amp; x\0y\n");
+is flat($tree), "doc_footer(doc_header()paragraph(codespan(a\0b) entity(&amp;) x\0y))", 'NUL survives';
+
+$md->render("x\@y.https://x.y\n\nnext para\n");
+is flat($tree), "doc_footer(doc_header()paragraph(autolink(x\@y.https)://x.y)paragraph(next para))",
+    'an autolink does not take back the link before it';
+
+$md->render("a|b\n---|---\n1|2\n3|4\n");
+my $table = $tree->[3][1];
+is $table->[0], 'table';
+is $table->[1], 1, 'one header row';
+is scalar @{$table->[3]}, 3;
+
+$md->render("* a\n* b\n");
+is flat($tree), "doc_footer(doc_header()list(listitem(a\n)listitem(b\n)))";
+
+is $calls, 6;
+
+done_testing;
@@ -0,0 +1,84 @@
+use strict;
+use warnings;
+use utf8;
+use Test::More;
+use Text::Markdown::Hoedown;
+
+my $src = "# Title\n\n[a *b*](/u) and `c`\n\n    code\n";
+
+my $renderer = Text::Markdown::Hoedown::Renderer::HTML->new(0, 0);
+$renderer->link(sub {
+    my ($link, $title, $content) = @_;
+    qq{<a href="/out?u=$link">$content</a>};
+});
+$renderer->blockcode(sub {
+    my ($text, $lang) = @_;
+    "<pre class=\"hl\">$text</pre>\n";
+});
+my $md = Text::Markdown::Hoedown::Markdown->new(0, 16, $renderer);
+is $md->render($src), <<'...';
+<h1>Title</h1>
+
+<p><a href="/out?u=/u">a <em>b</em></a> and <code>c</code></p>
+<pre class="hl">code
+</pre>
+...
+
+$renderer->link(undef);
+$renderer->blockcode(undef);
+$md = Text::Markdown::Hoedown::Markdown->new(0, 16, $renderer);
+is $md->render($src), markdown($src, toc_nesting_lvl => 0), 'undef restores the native callback';
+
+is markdown("[a](/u)\n", callbacks => { link => sub { "<$_[0]>" } }), "<p></u></p>\n";
+
+my $skip = Text::Markdown::Hoedown::Renderer::HTML->new(HOEDOWN_HTML_SKIP_LINKS, 0);
+$skip->link(sub { 'x' });
+$skip->link(undef);
+is(Text::Markdown::Hoedown::Markdown->new(0, 16, $skip)->render("[a](/u)\n"), "<p>[a](/u)</p>\n",
+    'restores the callbacks of the render flags');
+
+my $quote = "> * a\n> * b\n>\n> c\n";
+my $nested = Text::Markdown::Hoedown::Renderer::HTML->new(0, 0);
+$nested->blockquote(sub { "<q>$_[0]</q>\n" });
+$nested->listitem(sub { "<i>$_[0]</i>" });
+is(Text::Markdown::Hoedown::Markdown->new(0, 16, $nested)->render($quote),
+    "<q><ul>\n<i>a\n</i><i>b\n</i></ul>\n\n<p>c</p>\n</q>\n",
+    'containers render in place inside an overridden one');
+$nested->blockquote(undef);
+$nested->listitem(undef);
+is(Text::Markdown::Hoedown::Markdown->new(0, 16, $nested)->render($quote),
+    markdown($quote, toc_nesting_lvl => 0), 'undef restores in-place containers');
+
+my $table = "| a | b |\n|---|--:|\n| *c* |\n";
+my $cells = Text::Markdown::Hoedown::Renderer::HTML->new(0, 0);
+my @cells;
+$cells->table_cell(sub { push @cells, $_[0]; "<c$_[1]>" . (defined $_[0] ? $_[0] : '') . "</c>" });
+is(Text::Markdown::Hoedown::Markdown->new(HOEDOWN_EXT_TABLES, 16, $cells)->render($table),
+    "<table><thead>\n<tr>\n<c4>a</c><c6>b</c></tr>\n</thead><tbody>\n<tr>\n<c0><em>c</em></c><c2></c></tr>\n</tbody></table>\n",
+    'rows render in place around overridden cells');
+is_deeply(\@cells, ['a', 'b', '<em>c</em>', undef], 'a missing cell gets undef');
+$cells->table_cell(undef);
+is(Text::Markdown::Hoedown::Markdown->new(HOEDOWN_EXT_TABLES, 16, $cells)->render($table),
+    markdown($table, extensions => HOEDOWN_EXT_TABLES, toc_nesting_lvl => 0),
+    'undef restores in-place cells');
+
+my $dying = Text::Markdown::Hoedown::Renderer::HTML->new(0, 0);
+my $die = 1;
+$dying->emphasis(sub { die "boom\n" if $die; "<i>$_[0]</i>" });
+my $again = Text::Markdown::Hoedown::Markdown->new(0, 16, $dying);
+my $long = ("para\n\n" x 2000) . "> a *b*\n";
+my $polls = 0;
+eval { $again->render($long, sub { $polls++; 0 }) };
+is $@, "boom\n", 'error of an override';
+ok $polls, 'polled before it died';
+$die = 0;
+my $seen = $polls;
+is $again->render($long), ("<p>para</p>\n\n" x 2000) . "<blockquote>\n<p>a <i>b</i></p>\n</blockquote>\n",
+    'renders again after an override died';
+is $polls, $seen, 'without the cancel hook of the render that died';
+
+my $toc = Text::Markdown::Hoedown::Renderer::HTMLTOC->new(6);
+$toc->header(sub { "<h>$_[0]</h>" });
+is(Text::Markdown::Hoedown::Markdown->new(0, 16, $toc)->render("# a\n"), "<h>a</h>");
+
+done_testing;
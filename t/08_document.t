@@ -0,0 +1,67 @@
+use strict;
+use warnings;
+use utf8;
+use Test::More;
+use Text::Markdown::Hoedown;
+
+my $src = <<'...';
+# Title
+
+> * a *b*
+> * [c](/u "t") ![i](/i.png)
+
+| x | y |
+|---|---|
+| 1 | `2` |
+
+## Sub ünïcode
+
+    code
+...
+my $ext = HOEDOWN_EXT_TABLES | HOEDOWN_EXT_FENCED_CODE;
+
+my $doc = Text::Markdown::Hoedown::Document->new($src, $ext);
+ok $doc;
+
+my $html = markdown($src, extensions => $ext, toc_nesting_lvl => 0);
+is $doc->html(toc_nesting_lvl => 0), $html;
+is $doc->html(toc_nesting_lvl => 0), $html, 'renders again';
+ok utf8::is_utf8($doc->html), 'keeps the utf8 flag of the source';
+
+is $doc->html(html_options => HOEDOWN_HTML_TOC | HOEDOWN_HTML_USE_XHTML),
+    markdown($src, extensions => $ext, html_options => HOEDOWN_HTML_TOC | HOEDOWN_HTML_USE_XHTML);
+is $doc->toc, markdown_toc($src, extensions => $ext);
+is $doc->toc(nesting_level => 1), markdown_toc($src, extensions => $ext, nesting_level => 1);
+
+is $doc->html(toc_nesting_lvl => 0, callbacks => { codespan => sub { "[$_[0]]" } }),
+    markdown($src, extensions => $ext, toc_nesting_lvl => 0, callbacks => { codespan => sub { "[$_[0]]" } });
+
+my $cb = Text::Markdown::Hoedown::Renderer::Callback->new();
+$cb->normal_text(sub { $_[0] });
+$cb->paragraph(sub { "$_[0]\n" });
+$cb->header(sub { "$_[0]\n" });
+$cb->emphasis(sub { $_[0] });
+is $doc->render($cb), "Title\nSub ünïcode\n", 'skips blocks without a callback';
+
+my $short = Text::Markdown::Hoedown::Document->new("a *b* [c](/u)\n");
+is $short->render($cb), "a b c\n", 'declined spans render their content';
+
+is(Text::Markdown::Hoedown::Document->new('')->html, '');
+
+my $deep = '> ' x 15 . "a *b* c\n";
+is(Text::Markdown::Hoedown::Document->new($deep)->html, markdown($deep), 'spans past max_nesting keep their source');
+is(Text::Markdown::Hoedown::Document->new("_y_\n", 0, 1)->html, "<p>_y_</p>\n");
+
+my $quoted = Text::Markdown::Hoedown::Document->new(qq{"a" *b* "c"\n\n> 'd' *e*\n});
+my $dying = Text::Markdown::Hoedown::Renderer::HTML->new(HOEDOWN_HTML_SMARTYPANTS, 0);
+my $die = 1;
+$dying->emphasis(sub { die "boom\n" if $die; "<i>$_[0]</i>" });
+ok !eval { $quoted->render($dying); 1 }, 'a callback dies';
+is $@, "boom\n";
+$die = 0;
+is $quoted->render($dying),
+    markdown(qq{"a" *b* "c"\n\n> 'd' *e*\n}, html_options => HOEDOWN_HTML_SMARTYPANTS,
+        toc_nesting_lvl => 0, callbacks => { emphasis => sub { "<i>$_[0]</i>" } }),
+    'renders again after a callback died';
+
+done_testing;
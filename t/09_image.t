@@ -0,0 +1,74 @@
+use strict;
+use warnings;
+use utf8;
+use Test::More;
+use Text::Markdown::Hoedown;
+
+my $src = <<'...';
+# Títle
+
+> * a *b* [c](/u "t") ![i](/i.png)
+
+| x | y |
+|---|---|
+| 1 | `2` |
+
+Text[^1].
+
+[^1]: Note.
+...
+my $ext = HOEDOWN_EXT_TABLES | HOEDOWN_EXT_FOOTNOTES;
+
+my $doc = Text::Markdown::Hoedown::Document->new($src, $ext);
+my $image = $doc->serialize;
+ok !utf8::is_utf8($image), 'images are byte strings';
+
+my $loaded = Text::Markdown::Hoedown::Document->from_image($image);
+is $loaded->html, $doc->html;
+is $loaded->html(html_options => HOEDOWN_HTML_USE_XHTML), $doc->html(html_options => HOEDOWN_HTML_USE_XHTML);
+is $loaded->toc, $doc->toc;
+ok utf8::is_utf8($loaded->html), 'keeps the utf8 flag of the source';
+is $loaded->serialize, $image, 'serializes to the same image';
+
+my $bytes = Text::Markdown::Hoedown::Document->new("a\n")->serialize;
+ok !utf8::is_utf8(Text::Markdown::Hoedown::Document->from_image($bytes)->html);
+
+for my $bad ('', 'HDAT', substr($image, 0, length($image) - 1), 'X' . substr($image, 1)) {
+    eval { Text::Markdown::Hoedown::Document->from_image($bad) };
+    like $@, qr/Invalid document image/;
+}
+
+my $copy = $image;
+$loaded = Text::Markdown::Hoedown::Document->from_image($copy);
+substr($copy, 4, 1) = "\xff";
+eval { $loaded->html };
+like $@, qr/Invalid document image/, 'checks the image again when rendering';
+
+# images of n blockquotes around a rule, each listing the one before
+# $share times; the root document lists the last one
+sub quotes_image {
+    my ($n, $share) = @_;
+    my $none = pack('L2', 0xffffffff, 0) x 3;
+    my ($nodes, $kids) = (pack('Ll L2', 4, 0, 0, 0) . $none, '');
+    for my $i (1 .. $n) {
+        $nodes .= pack('Ll L2', 1, 0, length($kids) / 4, $share) . $none;
+        $kids .= pack('L', $i - 1) x $share;
+    }
+    $nodes .= pack('Ll L2', 30, 0, length($kids) / 4, 1) . $none;
+    $kids .= pack('L', $n);
+    return pack('a4 L6', 'HDAT', 1, 0x01020304, 0, $n + 2, length($kids) / 4, 0) . $nodes . $kids;
+}
+
+like(Text::Markdown::Hoedown::Document->from_image(quotes_image(100, 1))->html,
+    qr{^(<blockquote>\n){100}<hr>\n(</blockquote>\n){100}$}, 'renders a built image');
+for my $bad ([quotes_image(2000, 1), 'too deep'], [quotes_image(40, 2), 'a node listed twice']) {
+    eval { Text::Markdown::Hoedown::Document->from_image($bad->[0]) };
+    like $@, qr/Invalid document image/, $bad->[1];
+}
+
+my $rewound = "# Title\n\nx\@y.https://x.y\n\nnext para\n";
+$doc = Text::Markdown::Hoedown::Document->new($rewound, HOEDOWN_EXT_AUTOLINK);
+is $doc->html, markdown($rewound, extensions => HOEDOWN_EXT_AUTOLINK), 'an autolink does not take back a link before it';
+is(Text::Markdown::Hoedown::Document->from_image($doc->serialize)->html, $doc->html);
+
+done_testing;
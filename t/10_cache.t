@@ -0,0 +1,81 @@
+use strict;
+use warnings;
+use utf8;
+use Test::More;
+use Text::Markdown::Hoedown;
+
+my $cache = Text::Markdown::Hoedown::Cache->new;
+my $src = "# Title\n\n*a* and `b`\n";
+
+my $html = markdown($src, cache => $cache);
+is $html, markdown($src);
+is $cache->misses, 1;
+is $cache->hits, 0;
+is $cache->count, 1;
+ok $cache->bytes > length($src) + length($html);
+
+is markdown($src, cache => $cache), $html, 'hit';
+is $cache->hits, 1;
+
+my $xhtml = markdown($src, cache => $cache, html_options => HOEDOWN_HTML_USE_XHTML);
+is $cache->misses, 2, 'the renderer configuration is part of the key';
+is markdown_toc($src, cache => $cache), markdown_toc($src);
+is markdown($src, cache => $cache, extensions => HOEDOWN_EXT_TABLES), $html;
+is $cache->misses, 4, 'so are the extensions';
+
+my $copy = markdown($src, cache => $cache);
+$copy .= 'changed';
+is markdown($src, cache => $cache), $html, 'hits return a copy';
+
+{
+    my $chars = markdown("# ü\n", cache => $cache);
+    ok utf8::is_utf8($chars);
+    my $bytes = "# \xc3\xbc\n";
+    ok !utf8::is_utf8(markdown($bytes, cache => $cache)), 'the utf8 flag is part of the key';
+    ok utf8::is_utf8(markdown("# ü\n", cache => $cache));
+}
+
+my $hits = $cache->hits;
+markdown($src, cache => $cache, callbacks => { emphasis => sub { "<i>$_[0]</i>" } });
+markdown($src, cache => $cache, callbacks => { emphasis => sub { "<i>$_[0]</i>" } });
+is $cache->hits, $hits, 'Perl callbacks bypass the cache';
+
+my $misses = $cache->misses;
+my $cb = Text::Markdown::Hoedown::Renderer::Callback->new;
+$cb->paragraph(sub { "p" });
+my $md = Text::Markdown::Hoedown::Markdown->new(0, 16, $cb);
+$md->set_cache($cache);
+$md->render($src) for 1 .. 2;
+is $cache->misses + $cache->hits, $misses + $hits, 'so do Callback renderers';
+
+my $small = Text::Markdown::Hoedown::Cache->new(600);
+markdown("$_\n", cache => $small) for qw(a b c d e f g h);
+ok $small->bytes <= 600, 'keeps to its budget';
+ok $small->count < 8;
+markdown("h\n", cache => $small);
+is $small->hits, 1, 'keeps the most recent';
+markdown("a\n", cache => $small);
+is $small->hits, 1, 'evicts the least recent';
+
+markdown("x" x 1000, cache => $small);
+ok $small->bytes <= 600, 'skips outputs over the budget';
+
+{
+    my $long = "word " x 2000 . "\n";
+    my $out = markdown($long, cache => $cache);
+    $hits = $cache->hits;
+    eval { markdown($long, cache => $cache, work_budget => 100) };
+    like $@, qr/work budget exceeded/, 'a hit is held to the work budget';
+    is markdown($long, cache => $cache, work_budget => 1_000_000), $out, 'and returned within it';
+    eval { markdown($long, cache => $cache, cancel => sub { 1 }) };
+    like $@, qr/cancelled/, 'a hit polls cancel';
+    eval { markdown($long, cache => $cache, cancel => sub { die "late\n" }) };
+    is $@, "late\n";
+    is $cache->hits, $hits + 4;
+}
+
+$cache->clear;
+is $cache->count, 0;
+is $cache->bytes, 0;
+
+done_testing;
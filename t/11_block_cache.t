@@ -0,0 +1,79 @@
+use strict;
+use warnings;
+use utf8;
+use Test::More;
+use Text::Markdown::Hoedown qw(:DEFAULT markdown_with_toc);
+
+my $blocks = Text::Markdown::Hoedown::BlockCache->new;
+my $ext = HOEDOWN_EXT_TABLES | HOEDOWN_EXT_FENCED_CODE;
+my @parts = (
+    "# Title\n",
+    "A paragraph with *emphasis*\nand `code`.\n",
+    "* one\n* two\n\n  more of two\n",
+    "> quoted\n> text\n",
+    "| x | y |\n|---|---|\n| 1 | 2 |\n",
+    "```perl\nmy \$x;\n```\n",
+    "    indented\n",
+    "See [the docs][docs].\n",
+    "[docs]: /docs\n",
+);
+my $src = join "\n", @parts;
+
+is markdown($src, extensions => $ext, block_cache => $blocks), markdown($src, extensions => $ext);
+is $blocks->hits, 0;
+ok $blocks->count >= 5;
+ok $blocks->bytes > 0;
+
+is markdown($src, extensions => $ext, block_cache => $blocks), markdown($src, extensions => $ext), 'renders again';
+ok $blocks->hits >= 5, 'from the cache';
+
+my @edits = (
+    [ 2 => "* one\n* two\n\n  more of two\n* three\n" ],
+    [ 1 => "A paragraph with *emphasis*\n" ],
+    [ 3 => "> quoted\n\nnot quoted\n" ],
+    [ 6 => "    indented\n---\n" ],
+    [ 8 => "[docs]: /other\n" ],
+    [ 2 => "* one\n* two\n\n  more of two\n\n1. ordered\n" ],
+    [ 1 => "A paragraph\n===\n" ],
+);
+for my $edit (@edits) {
+    my @copy = @parts;
+    $copy[$edit->[0]] = $edit->[1];
+    my $changed = join "\n", @copy;
+    my $hits = $blocks->hits;
+    is markdown($changed, extensions => $ext, block_cache => $blocks), markdown($changed, extensions => $ext),
+        "edit of part $edit->[0]";
+    ok $blocks->hits > $hits, 'reuses the blocks left alone';
+}
+
+is markdown("intro\n\n$src", extensions => $ext, block_cache => $blocks), markdown("intro\n\n$src", extensions => $ext),
+    'blocks moved down';
+
+{
+    my $count = $blocks->count;
+    my $xhtml = markdown("$src\n---\n", extensions => $ext, html_options => HOEDOWN_HTML_USE_XHTML, block_cache => $blocks);
+    is $xhtml, markdown("$src\n---\n", extensions => $ext, html_options => HOEDOWN_HTML_USE_XHTML), 'other options';
+    ok $blocks->count < $count, 'empty the cache';
+    my ($html, $list) = markdown_with_toc($src, extensions => $ext, block_cache => $blocks);
+    my ($expected, $expected_list) = markdown_with_toc($src, extensions => $ext);
+    is $html, $expected;
+    is $list, $expected_list, 'headers are always parsed';
+}
+
+{
+    my $hits = $blocks->hits;
+    my %callbacks = (codespan => sub { "[$_[0]]" });
+    markdown($src, extensions => $ext, callbacks => \%callbacks, block_cache => $blocks) for 1 .. 2;
+    is $blocks->hits, $hits, 'Perl callbacks bypass the cache';
+}
+
+my $small = Text::Markdown::Hoedown::BlockCache->new(1000);
+markdown(join("\n", map { "paragraph number $_\n" } 1 .. 50), block_cache => $small);
+ok $small->bytes <= 1000, 'keeps to its budget';
+ok $small->count < 50;
+
+$blocks->clear;
+is $blocks->count, 0;
+is $blocks->bytes, 0;
+
+done_testing;
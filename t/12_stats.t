@@ -0,0 +1,43 @@
+use strict;
+use warnings;
+use utf8;
+use Test::More;
+use Text::Markdown::Hoedown;
+
+my $md = Text::Markdown::Hoedown::Markdown->new(HOEDOWN_EXT_TABLES, 16,
+    Text::Markdown::Hoedown::Renderer::HTML->new(0, 99));
+
+plan skip_all => 'built without HOEDOWN_STATS' unless defined $md->stats;
+
+my $src = "# Title\n\nSome *emphasis* and `code`.\n\n* one\n* two\n\n| a |\n|---|\n| 1 |\n";
+my $html = $md->render($src);
+my $stats = $md->stats;
+
+is $stats->{blocks}{atxheader}{calls}, 1;
+is $stats->{blocks}{list}{calls}, 1;
+is $stats->{blocks}{table}{bytes}, length "| a |\n|---|\n| 1 |\n", 'counts tries that failed';
+ok $stats->{blocks}{paragraph}{calls} >= 1;
+is $stats->{blocks}{paragraph}{bytes}, length "Some *emphasis* and `code`.\n\n";
+is $stats->{spans}{emphasis}{calls}, 1;
+is $stats->{spans}{codespan}{calls}, 1;
+ok !exists $stats->{spans}{link}, 'leaves out what was not called';
+is $stats->{callbacks}{header}{calls}, 1;
+is $stats->{callbacks}{header}{bytes}, index($html, "\n") + 1;
+ok $stats->{callbacks}{normal_text}{calls} >= 4;
+ok $stats->{blocks}{inline}{cycles} > 0;
+
+$md->render($src);
+is $md->stats->{blocks}{atxheader}{calls}, 2, 'adds up across renders';
+
+$md->reset_stats;
+is_deeply $md->stats, { blocks => {}, spans => {}, callbacks => {} };
+
+{
+    my $renderer = Text::Markdown::Hoedown::Renderer::HTML->new(0, 99);
+    $renderer->emphasis(sub { "<i>$_[0]</i>" });
+    my $perl = Text::Markdown::Hoedown::Markdown->new(0, 16, $renderer);
+    is $perl->render("*a*\n"), "<p><i>a</i></p>\n";
+    is $perl->stats->{callbacks}{emphasis}{bytes}, length "<i>a</i>", 'times Perl callbacks';
+}
+
+done_testing;
@@ -0,0 +1,34 @@
+use strict;
+use warnings;
+use utf8;
+use Test::More;
+use Text::Markdown::Hoedown;
+
+my $md = Text::Markdown::Hoedown::Markdown->new(HOEDOWN_EXT_FOOTNOTES, 16,
+    Text::Markdown::Hoedown::Renderer::HTML->new(0, 99));
+
+is_deeply [ sort keys %{$md->memory} ],
+    [ qw(allocated block_bufs footnotes peak reallocs refs span_bufs) ];
+is $md->memory->{peak}, 0, 'nothing rendered yet';
+
+my $src = "See [a][] and [b][][^1].\n\n> * quoted\n\n[a]: /a\n[b]: /b \"B\"\n[^1]: A note.\n";
+my $html = $md->render($src);
+my $memory = $md->memory;
+is $memory->{refs}, 2;
+is $memory->{footnotes}, 1;
+ok $memory->{allocated} > length $html;
+ok $memory->{peak} >= length $html, 'the output is held at the end';
+ok $memory->{reallocs} > 0;
+ok $memory->{block_bufs} >= 1;
+ok $memory->{span_bufs} >= 1;
+
+$md->render($src);
+ok $md->memory->{allocated} < $memory->{allocated}, 'reuses its work buffers';
+is $md->memory->{peak}, $memory->{peak};
+
+my $big = join "\n", map { "paragraph *$_*\n" } 1 .. 2000;
+$md->render($big);
+ok $md->memory->{peak} > 2 * length $big, 'grows with the document';
+is $md->memory->{refs}, 0;
+
+done_testing;
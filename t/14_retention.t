@@ -0,0 +1,44 @@
+use strict;
+use warnings;
+use utf8;
+use Test::More;
+use Text::Markdown::Hoedown;
+
+my $big = ("word *x* " x 20000) . "\n\n[a *" . ("link " x 5000) . "*](/x)\n";
+my $small = "*a*\n";
+
+my $md = Text::Markdown::Hoedown::Markdown->new(0, 16,
+    Text::Markdown::Hoedown::Renderer::HTML->new(0, 99));
+my $html = $md->render($big);
+my $span_bufs = $md->memory->{span_bufs};
+ok $span_bufs > 1;
+$md->render($small);
+my $kept = $md->memory->{peak};
+ok $kept > length $big, 'keeps the buffers of the large render';
+
+$md->trim;
+$md->render($small);
+ok $md->memory->{peak} < 4096, 'trim frees them';
+
+$md->set_retention(1, 1024);
+is $md->render($big), $html;
+is $md->memory->{span_bufs}, 1;
+$md->render($small);
+ok $md->memory->{peak} < 4096, 'bounded after each render';
+
+$md->set_retention(undef, undef);
+$md->render($big);
+is $md->memory->{span_bufs}, $span_bufs, 'unbounded again';
+$md->trim(1, undef);
+$md->render($small);
+is $md->memory->{span_bufs}, 1;
+ok $md->memory->{peak} > length $big, 'keeps the first buffer whole';
+
+$md->render($big);
+$md->trim(undef, 512);
+$md->render($small);
+ok $md->memory->{peak} < 4096;
+is $md->memory->{span_bufs}, $span_bufs, 'keeps the buffers, shrunk';
+is $md->render($big), $html;
+
+done_testing;
@@ -0,0 +1,56 @@
+use strict;
+use warnings;
+use utf8;
+use Test::More;
+use Text::Markdown::Hoedown qw(:DEFAULT smartypants);
+
+sub fused { markdown($_[0], html_options => HOEDOWN_HTML_SMARTYPANTS) }
+
+is fused(qq{"It's" -- 'fine'... (c) 1/2\n}),
+    "<p>&ldquo;It&rsquo;s&rdquo; &ndash; &lsquo;fine&rsquo;&hellip; &copy; &frac12;</p>\n";
+is smartypants(markdown(qq{"It's" -- 'fine'... (c) 1/2\n})), fused(qq{"It's" -- 'fine'... (c) 1/2\n}),
+    'the buffered render gives what two passes give';
+
+is fused("Use `\"don't\"` <code>it's</code> *\"emph\"* & <b>x</b>\n"),
+    "<p>Use <code>&quot;don&#39;t&quot;</code> <code>it&#39;s</code> <em>&ldquo;emph&rdquo;</em> &amp; <b>x</b></p>\n",
+    'code and raw code are left alone, tags and escapes kept';
+is fused("    \"code\" -- block\n"), "<pre><code>&quot;code&quot; -- block\n</code></pre>\n";
+is fused("\"open\n\n\"next\"\n"), "<p>&ldquo;open</p>\n\n<p>&ldquo;next&rdquo;</p>\n",
+    'a quote left open closes with its block';
+is fused("``quoted'' and 5 < 6\n"), "<p>&ldquo;quoted&rdquo; and 5 &lt; 6</p>\n",
+    'backticks of a code span that did not close';
+is markdown("\"It's\"\n"), "<p>&quot;It&#39;s&quot;</p>\n", 'off by default';
+
+for my $case (
+    [qq{1/2"\n}], [qq{<f=">\n}], [qq{\\<f=">\n}], [qq{"'"\n}, HOEDOWN_EXT_QUOTE],
+    [qq{&#0;x\n}], [qq{x &#0; y\n}], [qq{3/4<e>\n}, 0, HOEDOWN_HTML_SKIP_HTML],
+    [qq{3/4<e>ths\n}, 0, HOEDOWN_HTML_SKIP_HTML], [qq{it&#39;s &quot;1/2&quot;\n}],
+    [qq{a-\\-b '\\`x\n}], [qq{<code>a</code>`b`"c"\n}], [qq{www.x.com/'s--\n}, HOEDOWN_EXT_AUTOLINK],
+    [qq{x...y\@z.com\n}, HOEDOWN_EXT_AUTOLINK], [qq{"q"b\@c.d and 1/2http://x.y\n}, HOEDOWN_EXT_AUTOLINK],
+    [qq{*a* x--b\@c.d* 3/4\n}, HOEDOWN_EXT_AUTOLINK],
+) {
+    my ($src, $ext, $html) = @$case;
+    my %opts = (extensions => $ext || 0);
+    is markdown($src, %opts, html_options => ($html || 0) | HOEDOWN_HTML_SMARTYPANTS),
+        smartypants(markdown($src, %opts, html_options => $html || 0)), "buffered is two passes for $src";
+}
+is fused("&#0;\n"), "<p></p>\n", 'a paragraph left empty is still written';
+is markdown("<code>bx.y/z _<div><br> (c) \@\n~~~\@~~ ]<br>\n[id]: http://l.com ",
+        extensions => HOEDOWN_EXT_QUOTE, html_options => HOEDOWN_HTML_SMARTYPANTS),
+    "<p><code>bx.y/z _<div><br> (c) \@\n~~~\@~~ ]<br></p>\n", 'a skipped tag left open with autolink chars before it';
+is fused("<code>a\n\n&lt;!-- c --&gt;\n"), "<p><code>a</p>\n\n<p>&lt;!&ndash; c &ndash;&gt;</p>\n",
+    'a skipped tag left open closes with its block';
+is markdown("a--b\@c.d\n", extensions => HOEDOWN_EXT_AUTOLINK, html_options => HOEDOWN_HTML_SMARTYPANTS),
+    qq{<p><a href="mailto:a--b\@c.d">a&ndash;b\@c.d</a></p>\n}, 'an autolink takes in text before it as in the source';
+is smartypants("a\\"), "a\\", 'a backslash at the end is kept';
+
+my $md = Text::Markdown::Hoedown::Markdown->new(0, 16,
+    Text::Markdown::Hoedown::Renderer::HTML->new(HOEDOWN_HTML_SMARTYPANTS, 0));
+$md->render("\"open\n");
+is $md->render("it\"s\n"), "<p>it&quot;s</p>\n", 'each render starts with no quote open';
+
+my $utf8 = smartypants("<p>\"café\"</p>");
+ok utf8::is_utf8($utf8);
+is $utf8, "<p>&ldquo;café&rdquo;</p>";
+
+done_testing;
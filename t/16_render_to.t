@@ -0,0 +1,70 @@
+use strict;
+use warnings;
+use utf8;
+use Test::More;
+use Text::Markdown::Hoedown;
+
+my $md = Text::Markdown::Hoedown::Markdown->new(HOEDOWN_EXT_TABLES, 16,
+    Text::Markdown::Hoedown::Renderer::HTML->new(0, 0));
+
+my $table = join '', "| n | name | note |\n|--:|------|:----:|\n",
+    map { "| $_ | row *$_* | ünïcode |\n" } 1 .. 5000;
+my $html = $md->render($table);
+my $peak = $md->memory->{peak};
+
+my @chunks;
+$md->render_to($table, sub { push @chunks, $_[0] });
+is join('', @chunks), $html, 'same output in pieces';
+ok @chunks > 10, 'the rows of a table go out while it renders';
+ok utf8::is_utf8($chunks[0]), 'pieces of a character string are characters';
+ok $md->memory->{peak} < $peak / 2, 'holds less than the whole output';
+
+my $src = join "\n", map { "paragraph *$_*\n" } 1 .. 5000;
+my $out = '';
+$md->render_to($src, sub { $out .= $_[0] });
+is $out, $md->render($src), 'top level blocks go out too';
+
+@chunks = ();
+eval { $md->render_to($src, sub { push @chunks, $_[0]; die "full\n" }) };
+is $@, "full\n", 'error of the output code';
+is scalar @chunks, 1, 'stopped at the first error';
+
+eval { $md->render_to($src, sub { }, sub { 1 }) };
+like $@, qr/cancelled/, 'cancelled';
+
+my $dying = Text::Markdown::Hoedown::Renderer::HTML->new(0, 0);
+my $die = 1;
+$dying->emphasis(sub { die "boom\n" if $die; "<i>$_[0]</i>" });
+my $again = Text::Markdown::Hoedown::Markdown->new(0, 16, $dying);
+@chunks = ();
+eval { $again->render_to($src, sub { push @chunks, $_[0] }) };
+is $@, "boom\n", 'error of an override';
+$die = 0;
+my $sent = @chunks;
+is $again->render("a *b*\n"), "<p>a <i>b</i></p>\n", 'renders again after an override died';
+is scalar @chunks, $sent, 'without the output code of the render that died';
+
+my $huge = "| a |\n|---|\n" . ("| cell |\n" x (2 * 1024 * 1024 + 1));
+eval { $md->render_to($huge, sub { }) };
+like $@, qr/Cannot render/, 'a source past 16MB dies';
+my $tabs = "\ta\n" x (4 * 1024 * 1024 - 1);
+ok length($tabs) < 16 * 1024 * 1024;
+eval { $md->render_to($tabs, sub { }) };
+like $@, qr/Cannot render/, 'so does one its tabs take past 16MB';
+is $md->render("a *b*\n"), "<p>a <em>b</em></p>\n", 'renders again after';
+
+my $events = Text::Markdown::Hoedown::Markdown->new(0, 16,
+    Text::Markdown::Hoedown::Renderer::Events->new(sub { length($_[0]) . " bytes of events\n" }));
+@chunks = ();
+$events->render_to($src, sub { push @chunks, $_[0] });
+is_deeply \@chunks, [$events->render($src)], 'the result of the events renderer, once';
+
+my $cb = Text::Markdown::Hoedown::Renderer::Callback->new();
+$cb->paragraph(sub { "[$_[0]]" });
+my $callback = Text::Markdown::Hoedown::Markdown->new(0, 16, $cb);
+@chunks = ();
+$callback->render_to($src, sub { push @chunks, $_[0] });
+is join('', @chunks), $callback->render($src), 'callbacks append to the output';
+ok @chunks > 1;
+
+done_testing;